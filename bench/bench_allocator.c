@@ -0,0 +1,139 @@
+// bench/bench_allocator.c
+// Microbenchmark del asignador de direcciones: compara la búsqueda First Fit
+// lineal sobre lease_table (implementación anterior de assign_ip) con el
+// bitmap jerárquico de server/ip_allocator.c para pools de 256, 64k y 1M.
+//
+// Escenarios, medidos igual para ambos métodos:
+//   fill:  pool ocupado hasta quedar 'window' direcciones libres al final y se
+//          asignan esas últimas (el caso de una tormenta de DISCOVER con la
+//          parte baja del pool en uso).
+//   churn: pool al 90 %, se libera una dirección aleatoria y se asigna otra.
+// La salida es una línea "clave=valor" por escenario y tamaño.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ip_allocator.h"
+
+// Registro con el mismo tamaño que el lease_record textual anterior
+typedef struct {
+    char ip[16];
+    char mac_address[18];
+    time_t lease_start;
+    time_t lease_duration;
+    int assigned;
+    int conflicted;
+    char subnet_mask[16];
+    char default_gateway[16];
+    char dns_server[16];
+} scan_record;
+
+static double elapsed_ns(const struct timespec* start, const struct timespec* end) {
+    return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+static long scan_take_first(scan_record* table, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        if (!table[i].assigned && table[i].conflicted == 0) {
+            table[i].assigned = 1;
+            return (long)i;
+        }
+    }
+    return -1;
+}
+
+// Generador xorshift para elegir qué dirección liberar
+static unsigned long long rng_state = 88172645463325252ULL;
+static size_t next_random(size_t bound) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (size_t)(rng_state % bound);
+}
+
+static void bench_fill(size_t size, size_t window) {
+    struct timespec start, end;
+    volatile long sink = 0;
+
+    scan_record* table = calloc(size, sizeof(scan_record));
+    for (size_t i = 0; i < size - window; ++i) {
+        table[i].assigned = 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i = 0; i < window; ++i) {
+        sink += scan_take_first(table, size);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double scan_ns = elapsed_ns(&start, &end) / window;
+    free(table);
+
+    ip_allocator allocator;
+    ip_allocator_init(&allocator, size);
+    for (size_t i = 0; i < size - window; ++i) {
+        ip_allocator_take(&allocator, i);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i = 0; i < window; ++i) {
+        sink += ip_allocator_take_first(&allocator);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double bitmap_ns = elapsed_ns(&start, &end) / window;
+    ip_allocator_destroy(&allocator);
+
+    printf("scenario=fill size=%zu ops=%zu scan_ns_per_op=%.1f bitmap_ns_per_op=%.1f speedup=%.1f\n",
+           size, window, scan_ns, bitmap_ns, scan_ns / bitmap_ns);
+}
+
+static void bench_churn(size_t size, size_t operations, size_t scan_operations) {
+    struct timespec start, end;
+    volatile long sink = 0;
+    size_t used = size - size / 10;
+
+    scan_record* table = calloc(size, sizeof(scan_record));
+    rng_state = 88172645463325252ULL;
+    for (size_t i = 0; i < used; ++i) {
+        table[next_random(size)].assigned = 1;
+    }
+    rng_state = 88172645463325252ULL;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i = 0; i < scan_operations; ++i) {
+        table[next_random(size)].assigned = 0;
+        sink += scan_take_first(table, size);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double scan_ns = elapsed_ns(&start, &end) / scan_operations;
+    free(table);
+
+    ip_allocator allocator;
+    ip_allocator_init(&allocator, size);
+    rng_state = 88172645463325252ULL;
+    for (size_t i = 0; i < used; ++i) {
+        ip_allocator_take(&allocator, next_random(size));
+    }
+    rng_state = 88172645463325252ULL;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i = 0; i < operations; ++i) {
+        ip_allocator_free(&allocator, next_random(size));
+        sink += ip_allocator_take_first(&allocator);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double bitmap_ns = elapsed_ns(&start, &end) / operations;
+    ip_allocator_destroy(&allocator);
+
+    printf("scenario=churn size=%zu ops=%zu scan_ns_per_op=%.1f bitmap_ns_per_op=%.1f speedup=%.1f\n",
+           size, operations, scan_ns, bitmap_ns, scan_ns / bitmap_ns);
+}
+
+int main(void) {
+    const size_t sizes[] = {256, 65536, 1048576};
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+        // La búsqueda lineal en pools grandes es tan lenta que se mide con menos operaciones
+        size_t window = sizes[i] < 1024 ? sizes[i] : 1024;
+        size_t scan_operations = sizes[i] < 65536 ? 100000 : 1000;
+        bench_fill(sizes[i], window);
+        bench_churn(sizes[i], 100000, scan_operations);
+    }
+    return EXIT_SUCCESS;
+}
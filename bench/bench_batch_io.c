@@ -0,0 +1,233 @@
+// bench/bench_batch_io.c
+// Paquetes por segundo del bucle de E/S del servidor sobre loopback:
+// recvfrom/sendto por paquete frente a recvmmsg/sendmmsg por lotes.
+// Varios hilos generadores envían DHCPDISCOVER sin parar (con sendmmsg, para que no
+// sean el cuello de botella) y el hilo "servidor" recibe, valida cada mensaje
+// con dhcp_parse, construye un DHCPOFFER en un buffer propio por slot y lo
+// devuelve a un socket sumidero. Se cuentan los mensajes atendidos durante
+// un tiempo fijo por cada tamaño de lote. No requiere privilegios: todos los
+// sockets usan puertos efímeros. La salida es una línea "clave=valor" por prueba.
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "dhcp_wire.h"
+
+#define MAX_BATCH 64
+#define RUN_SECONDS 2.0
+#define SENDER_BATCH 32
+#define SENDER_THREADS 3  // Varios generadores para que siempre haya datagramas en cola
+
+static const int batch_sizes[] = {1, 8, 32, 64};
+
+static atomic_int running;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Socket UDP en 127.0.0.1 con puerto efímero; devuelve la dirección asignada
+static int open_loopback_socket(struct sockaddr_in* address) {
+    int udp_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (udp_socket < 0) {
+        perror("socket");
+        exit(EXIT_FAILURE);
+    }
+    memset(address, 0, sizeof(*address));
+    address->sin_family = AF_INET;
+    address->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(*address);
+    if (bind(udp_socket, (struct sockaddr*)address, sizeof(*address)) < 0 ||
+        getsockname(udp_socket, (struct sockaddr*)address, &length) < 0) {
+        perror("bind");
+        exit(EXIT_FAILURE);
+    }
+    return udp_socket;
+}
+
+typedef struct {
+    int udp_socket;
+    struct sockaddr_in server_addr;
+} sender_args;
+
+static void* sender_loop(void* arg) {
+    sender_args* args = (sender_args*)arg;
+    uint8_t packets[SENDER_BATCH][DHCP_MAX_PACKET_SIZE];
+    struct mmsghdr messages[SENDER_BATCH];
+    struct iovec vectors[SENDER_BATCH];
+    memset(messages, 0, sizeof(messages));
+
+    for (int i = 0; i < SENDER_BATCH; ++i) {
+        const uint8_t mac[6] = {0x02, 0x00, 0x00, 0x00, 0x00, (uint8_t)i};
+        dhcp_builder builder;
+        dhcp_builder_init_request(&builder, packets[i], sizeof(packets[i]), DHCPDISCOVER, 0x1000u + (uint32_t)i, mac);
+        vectors[i].iov_base = packets[i];
+        vectors[i].iov_len = dhcp_finish(&builder);
+        messages[i].msg_hdr.msg_name = &args->server_addr;
+        messages[i].msg_hdr.msg_namelen = sizeof(args->server_addr);
+        messages[i].msg_hdr.msg_iov = &vectors[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    while (atomic_load(&running)) {
+        sendmmsg(args->udp_socket, messages, SENDER_BATCH, 0);
+    }
+    return NULL;
+}
+
+// Lo que hace un worker por mensaje: validar y construir la respuesta
+static size_t build_offer(const uint8_t* request, size_t length, uint8_t* reply) {
+    dhcp_packet_view view;
+    if (dhcp_parse(request, length, &view) != 0 || view.message_type != DHCPDISCOVER) {
+        return 0;
+    }
+    dhcp_builder builder;
+    dhcp_builder_init_reply(&builder, reply, DHCP_MAX_PACKET_SIZE, &view, DHCPOFFER, 0x0a000000u | (view.xid & 0xffff));
+    dhcp_add_option_u32(&builder, DHCP_OPT_SERVER_ID, 0x7f000001);
+    dhcp_add_option_u32(&builder, DHCP_OPT_LEASE_TIME, 3600);
+    dhcp_add_option_u32(&builder, DHCP_OPT_SUBNET_MASK, 0xffffff00);
+    dhcp_add_option_u32(&builder, DHCP_OPT_ROUTER, 0x0a0000fe);
+    dhcp_add_option_u32(&builder, DHCP_OPT_DNS_SERVER, 0x08080808);
+    return dhcp_finish(&builder);
+}
+
+typedef struct {
+    unsigned long received;
+    unsigned long replied;
+    unsigned long syscalls;
+} io_counters;
+
+static void serve_per_packet(int udp_socket, const struct sockaddr_in* sink, io_counters* counters) {
+    uint8_t request[DHCP_MAX_PACKET_SIZE];
+    uint8_t reply[DHCP_MAX_PACKET_SIZE];
+    while (atomic_load(&running)) {
+        ssize_t length = recvfrom(udp_socket, request, sizeof(request), 0, NULL, NULL);
+        counters->syscalls++;
+        if (length <= 0) {
+            continue;  // Tiempo de espera agotado: volver a mirar la bandera
+        }
+        counters->received++;
+        size_t reply_length = build_offer(request, (size_t)length, reply);
+        if (reply_length > 0) {
+            sendto(udp_socket, reply, reply_length, 0, (const struct sockaddr*)sink, sizeof(*sink));
+            counters->syscalls++;
+            counters->replied++;
+        }
+    }
+}
+
+static void serve_batched(int udp_socket, const struct sockaddr_in* sink, int batch, io_counters* counters) {
+    static uint8_t requests[MAX_BATCH][DHCP_MAX_PACKET_SIZE];
+    static uint8_t replies[MAX_BATCH][DHCP_MAX_PACKET_SIZE];
+    struct mmsghdr in[MAX_BATCH], out[MAX_BATCH];
+    struct iovec in_vectors[MAX_BATCH], out_vectors[MAX_BATCH];
+
+    while (atomic_load(&running)) {
+        memset(in, 0, (size_t)batch * sizeof(in[0]));
+        for (int i = 0; i < batch; ++i) {
+            in_vectors[i].iov_base = requests[i];
+            in_vectors[i].iov_len = DHCP_MAX_PACKET_SIZE;
+            in[i].msg_hdr.msg_iov = &in_vectors[i];
+            in[i].msg_hdr.msg_iovlen = 1;
+        }
+        int received = recvmmsg(udp_socket, in, (unsigned int)batch, MSG_WAITFORONE, NULL);
+        counters->syscalls++;
+        if (received <= 0) {
+            continue;
+        }
+        counters->received += (unsigned long)received;
+
+        int pending = 0;
+        for (int i = 0; i < received; ++i) {
+            size_t reply_length = build_offer(requests[i], in[i].msg_len, replies[pending]);
+            if (reply_length == 0) {
+                continue;
+            }
+            out_vectors[pending].iov_base = replies[pending];
+            out_vectors[pending].iov_len = reply_length;
+            memset(&out[pending], 0, sizeof(out[pending]));
+            out[pending].msg_hdr.msg_name = (void*)sink;
+            out[pending].msg_hdr.msg_namelen = sizeof(*sink);
+            out[pending].msg_hdr.msg_iov = &out_vectors[pending];
+            out[pending].msg_hdr.msg_iovlen = 1;
+            pending++;
+        }
+        int sent = 0;
+        while (sent < pending) {
+            int result = sendmmsg(udp_socket, out + sent, (unsigned int)(pending - sent), 0);
+            counters->syscalls++;
+            if (result < 0 && errno != EINTR) {
+                break;
+            }
+            sent += result > 0 ? result : 0;
+        }
+        counters->replied += (unsigned long)sent;
+    }
+}
+
+// Detiene la prueba tras RUN_SECONDS
+static void* timer_loop(void* arg) {
+    (void)arg;
+    struct timespec duration = {(time_t)RUN_SECONDS, (long)((RUN_SECONDS - (time_t)RUN_SECONDS) * 1e9)};
+    nanosleep(&duration, NULL);
+    atomic_store(&running, 0);
+    return NULL;
+}
+
+static void run_mode(int batch) {
+    struct sockaddr_in server_addr, sender_addr, sink_addr;
+    int server_socket = open_loopback_socket(&server_addr);
+    int sender_socket = open_loopback_socket(&sender_addr);
+    int sink_socket = open_loopback_socket(&sink_addr);
+
+    // Despertar periódicamente para ver si terminó la prueba
+    struct timeval timeout = {0, 100000};
+    setsockopt(server_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    io_counters counters = {0, 0, 0};
+    atomic_store(&running, 1);
+    sender_args args = {sender_socket, server_addr};
+    pthread_t senders[SENDER_THREADS], timer;
+    for (int i = 0; i < SENDER_THREADS; ++i) {
+        pthread_create(&senders[i], NULL, sender_loop, &args);
+    }
+    pthread_create(&timer, NULL, timer_loop, NULL);
+
+    double start = now_seconds();
+    if (batch == 1) {
+        serve_per_packet(server_socket, &sink_addr, &counters);
+    } else {
+        serve_batched(server_socket, &sink_addr, batch, &counters);
+    }
+    double elapsed = now_seconds() - start;
+
+    pthread_join(timer, NULL);
+    for (int i = 0; i < SENDER_THREADS; ++i) {
+        pthread_join(senders[i], NULL);
+    }
+    close(server_socket);
+    close(sender_socket);
+    close(sink_socket);
+
+    printf("test=%s batch=%d received=%lu replied=%lu syscalls=%lu packets_per_syscall=%.2f kpps=%.1f\n",
+           batch == 1 ? "per_packet" : "batched", batch, counters.received, counters.replied, counters.syscalls,
+           counters.syscalls ? (double)(counters.received + counters.replied) / counters.syscalls : 0.0,
+           counters.replied / elapsed / 1e3);
+}
+
+int main(void) {
+    for (size_t i = 0; i < sizeof(batch_sizes) / sizeof(batch_sizes[0]); ++i) {
+        run_mode(batch_sizes[i]);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,199 @@
+// bench/bench_lease_shards.c
+// Benchmark de escalabilidad de la tabla de leases: N hilos ejecutan
+// transacciones DISCOVER -> REQUEST -> RELEASE (offer_ip, renew_assigned_lease
+// y release_ip) contra un pool de 64k direcciones, con 1 shard (equivalente
+// al mutex global anterior) y con 32 shards, para 1 a 32 hilos.
+// Cada hilo usa su propio conjunto de MAC. La salida es una línea
+// "clave=valor" por combinación.
+// Al final, varios hilos piden a la vez dirección para las mismas MAC en un
+// pool pequeño (con leases desbordados y direcciones recordadas en otros
+// shards) y se comprueba que cada MAC quede con un solo lease.
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "lease_table.h"
+
+#define POOL_ADDRESSES 65536
+#define MACS_PER_THREAD 256
+#define RUN_SECONDS 0.5
+
+#define SAME_MAC_ADDRESSES 64   // Pool pequeño: los shards de afinidad se llenan
+#define SAME_MAC_SHARDS 4
+#define SAME_MAC_CLIENTS 48
+#define SAME_MAC_ROUNDS 200
+#define SAME_MAC_THREADS 8
+
+// La tabla de leases registra cada operación; en el benchmark no se escribe el log
+void log_message(const char* level, const char* message) {
+    (void)level;
+    (void)message;
+}
+
+static atomic_int stop = 0;
+
+typedef struct {
+    int id;
+    unsigned long transactions;
+    unsigned long failures;
+} worker_args;
+
+static pthread_barrier_t round_barrier;
+static _Atomic uint32_t same_mac_ips[SAME_MAC_CLIENTS];
+static atomic_ulong same_mac_failures = 0;
+
+static void client_mac(unsigned int client, uint8_t mac[6]) {
+    mac[0] = 0x02;
+    mac[1] = 0x00;
+    mac[2] = (client >> 24) & 0xff;
+    mac[3] = (client >> 16) & 0xff;
+    mac[4] = (client >> 8) & 0xff;
+    mac[5] = client & 0xff;
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void* worker(void* arg) {
+    worker_args* args = (worker_args*)arg;
+    uint8_t mac[6];
+    lease_record lease;
+
+    for (unsigned long i = 0; !atomic_load_explicit(&stop, memory_order_relaxed); ++i) {
+        client_mac(args->id * MACS_PER_THREAD + (i % MACS_PER_THREAD), mac);
+
+        if (offer_ip(0, mac, 30, &lease) != 0) {
+            args->failures++;
+            continue;
+        }
+        if (renew_assigned_lease(0, lease.ip, mac, 3600, &lease) != 0) {
+            args->failures++;
+        }
+        release_ip(lease.ip, mac);
+        args->transactions++;
+    }
+    return NULL;
+}
+
+static void run(int threads, uint32_t shards) {
+    if (generate_ip_pool("10.0.0.0", "10.0.255.255", POOL_ADDRESSES, shards) < 0) {
+        fprintf(stderr, "No se pudo generar el pool\n");
+        exit(EXIT_FAILURE);
+    }
+
+    pthread_t ids[32];
+    worker_args args[32];
+    atomic_store(&stop, 0);
+    double start = now_seconds();
+    for (int i = 0; i < threads; ++i) {
+        args[i] = (worker_args){i, 0, 0};
+        pthread_create(&ids[i], NULL, worker, &args[i]);
+    }
+    struct timespec run_time = {0, (long)(RUN_SECONDS * 1e9)};
+    nanosleep(&run_time, NULL);
+    atomic_store(&stop, 1);
+
+    unsigned long transactions = 0, failures = 0;
+    for (int i = 0; i < threads; ++i) {
+        pthread_join(ids[i], NULL);
+        transactions += args[i].transactions;
+        failures += args[i].failures;
+    }
+    double elapsed = now_seconds() - start;
+
+    printf("threads=%d shards=%u transactions=%lu failures=%lu tps=%.0f\n",
+           threads, lease_shard_count(), transactions, failures, transactions / elapsed);
+    fflush(stdout);
+    destroy_ip_pool();
+}
+
+// Cada hilo recorre las mismas MAC en distinto orden, de modo que varias
+// solicitudes de una MAC coinciden en el tiempo
+static void* same_mac_worker(void* arg) {
+    int id = *(int*)arg;
+    uint8_t mac[6];
+    lease_record lease;
+
+    for (int round = 0; round < SAME_MAC_ROUNDS; ++round) {
+        pthread_barrier_wait(&round_barrier);
+        for (unsigned int i = 0; i < SAME_MAC_CLIENTS; ++i) {
+            unsigned int client = (i + (unsigned int)id * 7) % SAME_MAC_CLIENTS;
+            client_mac(client, mac);
+            if (assign_ip(0, mac, 3600, &lease) != 0) {
+                atomic_fetch_add(&same_mac_failures, 1);
+                continue;
+            }
+            atomic_store(&same_mac_ips[client], lease.ip);
+        }
+        pthread_barrier_wait(&round_barrier);
+    }
+    return NULL;
+}
+
+// Tras cada ronda las direcciones ocupadas deben ser una por MAC; se liberan
+// todas (quedan en el historial) para que la ronda siguiente las reutilice
+static void run_same_mac(void) {
+    if (generate_ip_pool("10.1.0.0", "10.1.0.255", SAME_MAC_ADDRESSES, SAME_MAC_SHARDS) < 0) {
+        fprintf(stderr, "No se pudo generar el pool\n");
+        exit(EXIT_FAILURE);
+    }
+
+    pthread_t ids[SAME_MAC_THREADS];
+    int thread_ids[SAME_MAC_THREADS];
+    pthread_barrier_init(&round_barrier, NULL, SAME_MAC_THREADS + 1);
+    for (int i = 0; i < SAME_MAC_THREADS; ++i) {
+        thread_ids[i] = i;
+        pthread_create(&ids[i], NULL, same_mac_worker, &thread_ids[i]);
+    }
+
+    unsigned long duplicates = 0;
+    uint8_t mac[6];
+    for (int round = 0; round < SAME_MAC_ROUNDS; ++round) {
+        pthread_barrier_wait(&round_barrier);
+        pthread_barrier_wait(&round_barrier);
+
+        uint32_t size, available;
+        lease_pool_usage(0, &size, &available);
+        if (size - available > SAME_MAC_CLIENTS) {
+            duplicates += size - available - SAME_MAC_CLIENTS;
+        }
+        for (unsigned int client = 0; client < SAME_MAC_CLIENTS; ++client) {
+            client_mac(client, mac);
+            release_ip(atomic_load(&same_mac_ips[client]), mac);
+        }
+        lease_pool_usage(0, &size, &available);
+        if (available != size) {
+            // Los leases duplicados no se pueden liberar por MAC: empezar de nuevo
+            destroy_ip_pool();
+            generate_ip_pool("10.1.0.0", "10.1.0.255", SAME_MAC_ADDRESSES, SAME_MAC_SHARDS);
+        }
+    }
+    for (int i = 0; i < SAME_MAC_THREADS; ++i) {
+        pthread_join(ids[i], NULL);
+    }
+    pthread_barrier_destroy(&round_barrier);
+
+    printf("same_mac threads=%d shards=%u rounds=%d failures=%lu duplicates=%lu\n", SAME_MAC_THREADS,
+           lease_shard_count(), SAME_MAC_ROUNDS, atomic_load(&same_mac_failures), duplicates);
+    fflush(stdout);
+    destroy_ip_pool();
+}
+
+int main(void) {
+    const int thread_counts[] = {1, 2, 4, 8, 16, 32};
+    const uint32_t shard_counts[] = {1, 32};
+
+    set_lease_console_output(0);
+    for (size_t s = 0; s < sizeof(shard_counts) / sizeof(shard_counts[0]); ++s) {
+        for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); ++t) {
+            run(thread_counts[t], shard_counts[s]);
+        }
+    }
+    run_same_mac();
+    return EXIT_SUCCESS;
+}
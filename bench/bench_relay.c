@@ -0,0 +1,247 @@
+// bench/bench_relay.c
+// Paquetes por segundo del bucle de reenvío del relay sobre loopback, con el
+// registro por paquete en cada modo: ninguno (solo contadores), binario
+// (traza en segundo plano) y texto (printf + log por paquete, como antes).
+// Un hilo cliente mantiene una ventana de DHCPDISCOVER en vuelo, cada uno con
+// xid y MAC propios; un hilo "servidor" responde cada uno con un DHCPACK, que
+// cierra la transacción. El relay corre con relay_run en su propio hilo. Se
+// cuentan los intercambios completos durante un tiempo fijo; cada uno son dos
+// paquetes reenviados. No requiere privilegios: todos los sockets usan
+// puertos efímeros. La salida es una línea "clave=valor" por modo.
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "dhcp_log.h"
+#include "dhcp_wire.h"
+#include "relay_forward.h"
+#include "relay_metrics.h"
+#include "relay_trace.h"
+
+#define RUN_SECONDS 2.0
+#define WINDOW 64                 // Solicitudes en vuelo del cliente
+#define RECEIVE_TIMEOUT_US 20000  // Sin respuesta en este tiempo se repone la ventana
+#define MAX_TRANSACTIONS 16384
+#define LOG_FILE "bench/bench_relay.log"
+#define TRACE_FILE "bench/bench_relay.trace"
+
+static const relay_log_mode modes[] = {RELAY_LOG_NONE, RELAY_LOG_BINARY, RELAY_LOG_TEXT};
+static const char* mode_names[] = {"ninguno", "binario", "texto"};
+
+static atomic_int running;
+static volatile sig_atomic_t relay_stop;
+static volatile sig_atomic_t relay_report_requested;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Socket UDP bloqueante en 127.0.0.1 con puerto efímero y espera de recepción acotada
+static int open_loopback_socket(struct sockaddr_in* address) {
+    int udp_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (udp_socket < 0) {
+        perror("socket");
+        exit(EXIT_FAILURE);
+    }
+    memset(address, 0, sizeof(*address));
+    address->sin_family = AF_INET;
+    address->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(*address);
+    if (bind(udp_socket, (struct sockaddr*)address, sizeof(*address)) < 0 ||
+        getsockname(udp_socket, (struct sockaddr*)address, &length) < 0) {
+        perror("bind");
+        exit(EXIT_FAILURE);
+    }
+    struct timeval timeout = {0, RECEIVE_TIMEOUT_US};
+    setsockopt(udp_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return udp_socket;
+}
+
+// Puerto asignado a un socket del relay (enlazado a INADDR_ANY)
+static uint16_t socket_port(int udp_socket) {
+    struct sockaddr_in address;
+    socklen_t length = sizeof(address);
+    getsockname(udp_socket, (struct sockaddr*)&address, &length);
+    return address.sin_port;
+}
+
+// Responde cada solicitud con un DHCPACK a la dirección de origen (el socket del relay)
+static void* server_loop(void* arg) {
+    int udp_socket = *(int*)arg;
+    uint8_t request[1024], reply[DHCP_MAX_PACKET_SIZE];
+    while (atomic_load_explicit(&running, memory_order_relaxed)) {
+        struct sockaddr_in source;
+        socklen_t source_len = sizeof(source);
+        ssize_t n = recvfrom(udp_socket, request, sizeof(request), 0, (struct sockaddr*)&source, &source_len);
+        dhcp_packet_view packet;
+        if (n <= 0 || dhcp_parse(request, (size_t)n, &packet) != 0) {
+            continue;
+        }
+        dhcp_builder builder;
+        dhcp_builder_init_reply(&builder, reply, sizeof(reply), &packet, DHCPACK, 0xc0a8010a);
+        dhcp_add_option_u32(&builder, DHCP_OPT_SERVER_ID, 0x7f000001);
+        size_t length = dhcp_finish(&builder);
+        sendto(udp_socket, reply, length, 0, (struct sockaddr*)&source, source_len);
+    }
+    return NULL;
+}
+
+typedef struct {
+    int udp_socket;
+    struct sockaddr_in relay_addr;
+    uint32_t next_xid;
+    unsigned long completed;
+} client_state;
+
+static void send_discover(client_state* client) {
+    uint32_t id = client->next_xid++;
+    uint8_t mac[6] = {0x02, 0x00, (uint8_t)(id >> 24), (uint8_t)(id >> 16), (uint8_t)(id >> 8), (uint8_t)id};
+    uint8_t buffer[DHCP_MAX_PACKET_SIZE];
+    dhcp_builder builder;
+    dhcp_builder_init_request(&builder, buffer, sizeof(buffer), DHCPDISCOVER, id, mac);
+    size_t length = dhcp_finish(&builder);
+    sendto(client->udp_socket, buffer, length, 0, (struct sockaddr*)&client->relay_addr, sizeof(client->relay_addr));
+}
+
+// Repone una solicitud por cada respuesta; si la ventana se vacía (pérdidas), la vuelve a llenar
+static void* client_loop(void* arg) {
+    client_state* client = arg;
+    uint8_t buffer[1024];
+    for (int i = 0; i < WINDOW; ++i) {
+        send_discover(client);
+    }
+    while (atomic_load_explicit(&running, memory_order_relaxed)) {
+        ssize_t n = recv(client->udp_socket, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            client->completed++;
+            send_discover(client);
+        } else {
+            for (int i = 0; i < WINDOW; ++i) {
+                send_discover(client);
+            }
+        }
+    }
+    return NULL;
+}
+
+// CPU consumida por el hilo del relay: con pocos núcleos el cliente y el
+// servidor de prueba limitan los paquetes por segundo, y este es el costo propio
+static double relay_cpu_seconds;
+
+static void* relay_loop(void* arg) {
+    relay_run(arg, &relay_stop, &relay_report_requested);
+    struct timespec cpu;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu);
+    relay_cpu_seconds = cpu.tv_sec + cpu.tv_nsec / 1e9;
+    return NULL;
+}
+
+int main(void) {
+    dhcp_log_init(LOG_FILE, 1);
+
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); ++m) {
+        relay_context relay;
+        memset(&relay, 0, sizeof(relay));
+        relay.log_mode = modes[m];
+        dhcp_subnet_table_init(&relay.client_subnets);
+        dhcp_subnet_table_add(&relay.client_subnets, 0, 0, 0);  // Aceptar clientes de cualquier dirección
+        if (transaction_table_init(&relay.transactions, MAX_TRANSACTIONS) != 0) {
+            fprintf(stderr, "No se pudo crear la tabla de transacciones\n");
+            return EXIT_FAILURE;
+        }
+        relay.client_socket = relay_open_socket(0, 0);
+        relay.server_socket = relay_open_socket(0, 0);
+        if (relay.client_socket < 0 || relay.server_socket < 0) {
+            return EXIT_FAILURE;
+        }
+
+        struct sockaddr_in server_addr;
+        int server_socket = open_loopback_socket(&server_addr);
+        char upstream[32];
+        snprintf(upstream, sizeof(upstream), "127.0.0.1:%u", ntohs(server_addr.sin_port));
+        upstream_add(&relay.upstreams, upstream);
+
+        client_state client;
+        memset(&client, 0, sizeof(client));
+        client.udp_socket = open_loopback_socket(&client.relay_addr);
+        client.relay_addr.sin_port = socket_port(relay.client_socket);
+        client.next_xid = (uint32_t)m << 24;
+
+        if (relay.log_mode == RELAY_LOG_BINARY && relay_trace_open(TRACE_FILE) != 0) {
+            perror("No se pudo abrir la traza");
+            return EXIT_FAILURE;
+        }
+        // En modo texto la consola va a /dev/null: se mide el formateo, no la terminal
+        fflush(stdout);
+        int saved_stdout = dup(STDOUT_FILENO);
+        if (relay.log_mode == RELAY_LOG_TEXT) {
+            int null_fd = open("/dev/null", O_WRONLY);
+            dup2(null_fd, STDOUT_FILENO);
+            close(null_fd);
+        }
+
+        // Los contadores se acumulan entre modos: se mide la diferencia
+        if (m == 0 && relay_metrics_init(&relay.upstreams) != 0) {
+            fprintf(stderr, "No se pudieron crear los contadores de métricas\n");
+            return EXIT_FAILURE;
+        }
+        relay_counters before, after;
+        relay_get_counters(&before);
+
+        relay_stop = 0;
+        relay_report_requested = 0;
+        atomic_store(&running, 1);
+        pthread_t relay_thread, server_thread, client_thread;
+        pthread_create(&relay_thread, NULL, relay_loop, &relay);
+        pthread_create(&server_thread, NULL, server_loop, &server_socket);
+        double start = now_seconds();
+        pthread_create(&client_thread, NULL, client_loop, &client);
+
+        struct timespec pause = {0, 50 * 1000000L};
+        while (now_seconds() - start < RUN_SECONDS) {
+            nanosleep(&pause, NULL);
+        }
+        atomic_store(&running, 0);
+        double elapsed = now_seconds() - start;
+        pthread_join(client_thread, NULL);
+        pthread_join(server_thread, NULL);
+        relay_stop = 1;  // El relay lo ve al volver de epoll_wait (como mucho 1 s)
+        pthread_join(relay_thread, NULL);
+        unsigned long completed = client.completed;
+
+        fflush(stdout);
+        dup2(saved_stdout, STDOUT_FILENO);
+        close(saved_stdout);
+        relay_trace_close();  // Vuelca los registros pendientes antes de contarlos
+        relay_trace_stats trace;
+        relay_trace_get_stats(&trace);
+
+        relay_get_counters(&after);
+        unsigned long forwarded = after.requests_forwarded - before.requests_forwarded +
+                                  after.replies_forwarded - before.replies_forwarded;
+        printf("test=relay mode=%s exchanges=%lu forwarded=%lu dropped=%lu trace_records=%lu trace_dropped=%lu "
+               "relay_cpu_ns_per_packet=%.0f kpps=%.1f\n",
+               mode_names[m], completed, forwarded,
+               after.table_full - before.table_full + after.send_errors - before.send_errors,
+               relay.log_mode == RELAY_LOG_BINARY ? trace.written : 0,
+               relay.log_mode == RELAY_LOG_BINARY ? trace.dropped : 0,
+               forwarded > 0 ? relay_cpu_seconds * 1e9 / forwarded : 0.0, completed * 2 / elapsed / 1000.0);
+
+        close(client.udp_socket);
+        close(server_socket);
+        close(relay.client_socket);
+        close(relay.server_socket);
+        transaction_table_destroy(&relay.transactions);
+        dhcp_subnet_table_destroy(&relay.client_subnets);
+    }
+    return 0;
+}
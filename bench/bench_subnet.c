@@ -0,0 +1,81 @@
+// bench/bench_subnet.c
+// Búsquedas por segundo del selector de subredes (common/dhcp_subnet.c) con
+// 16 a 65536 subredes /24 consecutivas, como las VLAN de un relay. Cada
+// búsqueda usa un giaddr al azar dentro de las subredes, así que el acceso a
+// la tabla no se queda en la caché por repetición. Comprueba además que cada
+// dirección resuelve a su propia subred. La salida es una línea "clave=valor"
+// por tamaño.
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "dhcp_subnet.h"
+
+#define LOOKUPS 20000000
+#define BASE_NETWORK 0x0a000000u  // 10.0.0.0
+
+static const uint32_t sizes[] = {16, 256, 4096, 65536};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// xorshift64: rápido y reproducible
+static uint64_t rng_state = 0x9e3779b97f4a7c15ull;
+
+static uint32_t next_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)(rng_state >> 32);
+}
+
+int main(void) {
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        uint32_t count = sizes[s];
+        dhcp_subnet_table table;
+        dhcp_subnet_table_init(&table);
+        // Se añaden en orden inverso para que la construcción tenga que ordenarlas
+        for (uint32_t i = count; i-- > 0;) {
+            if (dhcp_subnet_table_add(&table, BASE_NETWORK + (i << 8), 24, i) != 0) {
+                fprintf(stderr, "No se pudo añadir la subred %u\n", i);
+                return EXIT_FAILURE;
+            }
+        }
+        if (dhcp_subnet_table_build(&table) != 0) {
+            fprintf(stderr, "Subredes solapadas\n");
+            return EXIT_FAILURE;
+        }
+
+        unsigned long errors = 0;
+        uint32_t checksum = 0;
+        double start = now_seconds();
+        for (unsigned long n = 0; n < LOOKUPS; ++n) {
+            uint32_t address = BASE_NETWORK + next_random() % (count << 8);
+            uint32_t value;
+            if (dhcp_subnet_lookup(&table, address, &value) != 0 || value != (address - BASE_NETWORK) >> 8) {
+                errors++;
+                continue;
+            }
+            checksum += value;
+        }
+        double elapsed = now_seconds() - start;
+
+        // Una dirección fuera de todas las subredes no debe encontrarse
+        uint32_t ignored;
+        if (dhcp_subnet_lookup(&table, BASE_NETWORK - 1, &ignored) == 0 ||
+            dhcp_subnet_lookup(&table, BASE_NETWORK + (count << 8), &ignored) == 0) {
+            errors++;
+        }
+
+        printf("test=subnet subnets=%u lookups=%d errors=%lu ns_per_lookup=%.1f mlookups_per_s=%.1f checksum=%u\n",
+               count, LOOKUPS, errors, elapsed * 1e9 / LOOKUPS, LOOKUPS / elapsed / 1e6, checksum);
+        dhcp_subnet_table_destroy(&table);
+        if (errors != 0) {
+            return EXIT_FAILURE;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,181 @@
+// bench/bench_wire.c
+// Benchmark del codec DHCP binario (common/dhcp_wire.c):
+//  - fuzz: muta mensajes válidos (bytes al azar, longitudes de opción,
+//    truncados) y comprueba que el parser nunca acepta una opción fuera del
+//    buffer y que el recorrido de opciones termina dentro de la vista.
+//  - throughput: mensajes por segundo de dhcp_parse sobre un DHCPREQUEST
+//    típico y de la construcción de un DHCPACK completo.
+// Cada mensaje mutado se copia a un buffer de su tamaño exacto en el heap,
+// así que una lectura fuera de rango la detecta AddressSanitizer si se
+// compila con -fsanitize=address. La salida es una línea "clave=valor" por prueba.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "dhcp_wire.h"
+
+#define FUZZ_ITERATIONS 2000000
+#define THROUGHPUT_ITERATIONS 10000000
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// xorshift64: rápido y reproducible
+static uint64_t rng_state = 0x9e3779b97f4a7c15ull;
+
+static uint32_t next_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)(rng_state >> 32);
+}
+
+// DHCPREQUEST como el que envía un cliente en SELECTING
+static size_t build_request(uint8_t* buffer, size_t capacity) {
+    const uint8_t mac[6] = {0x02, 0x00, 0x00, 0x12, 0x34, 0x56};
+    const uint8_t parameters[] = {DHCP_OPT_SUBNET_MASK, DHCP_OPT_ROUTER, DHCP_OPT_DNS_SERVER, DHCP_OPT_LEASE_TIME};
+    dhcp_builder builder;
+    dhcp_builder_init_request(&builder, buffer, capacity, DHCPREQUEST, 0xdeadbeef, mac);
+    dhcp_add_option_u32(&builder, DHCP_OPT_REQUESTED_IP, 0x0a000001);
+    dhcp_add_option_u32(&builder, DHCP_OPT_SERVER_ID, 0xc0a80202);
+    dhcp_add_option(&builder, DHCP_OPT_PARAMETER_LIST, sizeof(parameters), parameters);
+    return dhcp_finish(&builder);
+}
+
+// Comprueba los invariantes de una vista aceptada por el parser
+static int view_is_consistent(const dhcp_packet_view* view) {
+    const uint8_t* end = view->packet + view->length;
+    if (view->options + view->options_length > end) {
+        return 0;
+    }
+    dhcp_option_iter iter;
+    uint8_t code, length;
+    const uint8_t* data;
+    dhcp_option_iter_init(&iter, view);
+    while (dhcp_option_next(&iter, &code, &length, &data)) {
+        if (data + length > view->options + view->options_length) {
+            return 0;
+        }
+    }
+    if (view->message != NULL && view->message + view->message_length > end) {
+        return 0;
+    }
+    return 1;
+}
+
+static void run_fuzz(void) {
+    // DHCPDECLINE con una opción 56 para que las mutaciones también caigan sobre datos de longitud variable
+    const uint8_t mac[6] = {0x02, 0x00, 0x00, 0x12, 0x34, 0x56};
+    const char reason[] = "Dirección en uso";
+    uint8_t valid[DHCP_MAX_PACKET_SIZE];
+    dhcp_builder builder;
+    dhcp_builder_init_request(&builder, valid, sizeof(valid), DHCPDECLINE, 0xdeadbeef, mac);
+    dhcp_add_option_u32(&builder, DHCP_OPT_REQUESTED_IP, 0x0a000001);
+    dhcp_add_option(&builder, DHCP_OPT_MESSAGE, sizeof(reason) - 1, reason);
+    dhcp_add_option_u32(&builder, DHCP_OPT_SERVER_ID, 0xc0a80202);
+    size_t valid_length = dhcp_finish(&builder);
+
+    unsigned long accepted = 0, rejected = 0, violations = 0;
+    double start = now_seconds();
+    for (unsigned long i = 0; i < FUZZ_ITERATIONS; ++i) {
+        uint8_t mutated[DHCP_MAX_PACKET_SIZE];
+        memcpy(mutated, valid, valid_length);
+        size_t length = valid_length;
+
+        // Entre 1 y 8 mutaciones: bytes al azar, longitudes de opción o END/PAD
+        int mutations = 1 + next_random() % 8;
+        for (int m = 0; m < mutations; ++m) {
+            uint32_t choice = next_random() % 3;
+            if (choice == 0) {
+                mutated[next_random() % length] = (uint8_t)next_random();
+            } else if (choice == 1) {
+                // Longitud de opción arbitraria justo tras la magic cookie
+                mutated[DHCP_OPTIONS_OFFSET + 1 + (next_random() % 32)] = (uint8_t)next_random();
+            } else {
+                mutated[DHCP_OPTIONS_OFFSET + (next_random() % 40)] = DHCP_OPT_END - (next_random() % 2);
+            }
+        }
+        // Uno de cada cuatro mensajes se trunca en cualquier punto
+        if (next_random() % 4 == 0) {
+            length = next_random() % (length + 1);
+        }
+
+        // Copia del tamaño exacto: cualquier lectura de más se sale de la reserva
+        uint8_t* packet = malloc(length ? length : 1);
+        memcpy(packet, mutated, length);
+        dhcp_packet_view view;
+        if (dhcp_parse(packet, length, &view) == 0) {
+            accepted++;
+            if (!view_is_consistent(&view)) {
+                violations++;
+            }
+        } else {
+            rejected++;
+        }
+        free(packet);
+    }
+    double elapsed = now_seconds() - start;
+
+    printf("test=fuzz iterations=%d accepted=%lu rejected=%lu violations=%lu seconds=%.2f\n",
+           FUZZ_ITERATIONS, accepted, rejected, violations, elapsed);
+    if (violations > 0) {
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void run_parse_throughput(void) {
+    uint8_t packet[DHCP_MAX_PACKET_SIZE];
+    size_t length = build_request(packet, sizeof(packet));
+    dhcp_packet_view view;
+    unsigned long checksum = 0;
+
+    double start = now_seconds();
+    for (unsigned long i = 0; i < THROUGHPUT_ITERATIONS; ++i) {
+        packet[7] = (uint8_t)i;  // Cambiar el xid para que el compilador no reutilice el resultado
+        if (dhcp_parse(packet, length, &view) == 0) {
+            checksum += view.xid + view.message_type + (view.requested_ip ? view.requested_ip[3] : 0);
+        }
+    }
+    double elapsed = now_seconds() - start;
+
+    printf("test=parse iterations=%d bytes=%zu mpps=%.2f ns_per_packet=%.1f checksum=%lu\n",
+           THROUGHPUT_ITERATIONS, length, THROUGHPUT_ITERATIONS / elapsed / 1e6,
+           elapsed * 1e9 / THROUGHPUT_ITERATIONS, checksum);
+}
+
+static void run_build_throughput(void) {
+    uint8_t request[DHCP_MAX_PACKET_SIZE];
+    size_t request_length = build_request(request, sizeof(request));
+    dhcp_packet_view view;
+    dhcp_parse(request, request_length, &view);
+
+    uint8_t reply[DHCP_MAX_PACKET_SIZE];
+    unsigned long checksum = 0;
+    double start = now_seconds();
+    for (unsigned long i = 0; i < THROUGHPUT_ITERATIONS; ++i) {
+        dhcp_builder builder;
+        dhcp_builder_init_reply(&builder, reply, sizeof(reply), &view, DHCPACK, 0x0a000000u + (uint32_t)(i & 0xffff));
+        dhcp_add_option_u32(&builder, DHCP_OPT_SERVER_ID, 0xc0a80202);
+        dhcp_add_option_u32(&builder, DHCP_OPT_LEASE_TIME, 3600);
+        dhcp_add_option_u32(&builder, DHCP_OPT_SUBNET_MASK, 0xffffff00);
+        dhcp_add_option_u32(&builder, DHCP_OPT_ROUTER, 0xc0a80201);
+        dhcp_add_option_u32(&builder, DHCP_OPT_DNS_SERVER, 0x08080808);
+        checksum += dhcp_finish(&builder) + reply[19];
+    }
+    double elapsed = now_seconds() - start;
+
+    printf("test=build iterations=%d mpps=%.2f ns_per_packet=%.1f checksum=%lu\n",
+           THROUGHPUT_ITERATIONS, THROUGHPUT_ITERATIONS / elapsed / 1e6,
+           elapsed * 1e9 / THROUGHPUT_ITERATIONS, checksum);
+}
+
+int main(void) {
+    run_fuzz();
+    run_parse_throughput();
+    run_build_throughput();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,143 @@
+#!/bin/bash
+# bench/run_bench.sh (make bench)
+# Pruebas de extremo a extremo en loopback: levanta el servidor (y el relay en
+# el escenario que lo usa) en puertos sin privilegios, lanza el generador de
+# carga y guarda una línea "clave=valor" por escenario. Cada escenario arranca
+# un servidor nuevo sin persistencia. Los logs de los procesos quedan en un
+# directorio temporal, así que no se tocan los del repositorio.
+#
+# Escenarios:
+#   arranque_en_frio  los clientes, sin lease, piden dirección uno tras otro
+#   renovaciones      tras un calentamiento, los clientes renuevan su lease
+#   pool_agotado      más clientes que direcciones: el servidor responde NAK
+#   relay             mezcla de mensajes a través del relay
+#
+# Variables de entorno (con sus valores por defecto):
+#   BENCH_SERVER_PORT=16767 BENCH_RELAY_PORT=16768 BENCH_CLIENTS=100000
+#   BENCH_THREADS=4 BENCH_RATE=20000 BENCH_RELAY_RATE=BENCH_RATE/4
+#   BENCH_SECONDS=5 BENCH_OUTPUT=bench/bench_results.txt
+#
+# El relay duplica los paquetes por intercambio, de ahí su tasa menor; en
+# una máquina con pocas CPU las tres partes compiten por ellas.
+set -u
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+SERVER="$ROOT/server/server"
+RELAY="$ROOT/relay/relay"
+LOAD="$ROOT/client/load_generator"
+
+SERVER_PORT=${BENCH_SERVER_PORT:-16767}
+RELAY_PORT=${BENCH_RELAY_PORT:-16768}
+CLIENTS=${BENCH_CLIENTS:-100000}
+THREADS=${BENCH_THREADS:-4}
+RATE=${BENCH_RATE:-20000}
+RELAY_RATE=${BENCH_RELAY_RATE:-$((RATE / 4))}
+SECONDS_PER_RUN=${BENCH_SECONDS:-5}
+OUTPUT=${BENCH_OUTPUT:-$ROOT/bench/bench_results.txt}
+
+for program in "$SERVER" "$RELAY" "$LOAD"; do
+    if [ ! -x "$program" ]; then
+        echo "Falta $program: ejecuta make antes" >&2
+        exit 1
+    fi
+done
+
+WORK=$(mktemp -d)
+mkdir -p "$WORK/server" "$WORK/relay"
+SERVER_PID=""
+RELAY_PID=""
+
+stop_processes() {
+    for pid in $RELAY_PID $SERVER_PID; do
+        kill -TERM "$pid" 2>/dev/null
+        wait "$pid" 2>/dev/null
+    done
+    SERVER_PID=""
+    RELAY_PID=""
+}
+
+cleanup() {
+    stop_processes
+    rm -rf "$WORK"
+}
+trap cleanup EXIT
+trap 'exit 1' INT TERM
+
+# Red local 10.0.0.0/8 para los clientes directos y 127.0.0.0/8 para los que
+# llegan por el relay (giaddr 127.0.0.1)
+cat > "$WORK/bench.conf" <<EOF
+SUBNET_MASK=255.0.0.0
+DEFAULT_GATEWAY=10.0.0.1
+DNS_SERVER=10.0.0.2
+SERVER_ID=127.0.0.1
+LEASE_TIME=3600
+
+[SUBNET 127.0.0.0/8]
+RANGE=127.1.0.1-127.4.255.254
+DEFAULT_GATEWAY=127.0.0.1
+EOF
+
+# start_server <IP inicio> <IP fin>
+start_server() {
+    (cd "$WORK" && exec "$SERVER" -j none -P "$SERVER_PORT" "$1" "$2" bench.conf > /dev/null 2> server/stderr.txt) &
+    SERVER_PID=$!
+    sleep 0.5
+    if ! kill -0 "$SERVER_PID" 2>/dev/null; then
+        echo "El servidor no arrancó:" >&2
+        cat "$WORK/server/stderr.txt" >&2
+        exit 1
+    fi
+}
+
+start_relay() {
+    (cd "$WORK" && exec "$RELAY" -s "127.0.0.1:$SERVER_PORT" -c 127.0.0.1/8 -p "$RELAY_PORT" -L ninguno \
+        > relay/stdout.txt 2>&1) &
+    RELAY_PID=$!
+    sleep 0.5
+    if ! kill -0 "$RELAY_PID" 2>/dev/null; then
+        echo "El relay no arrancó:" >&2
+        cat "$WORK/relay/stdout.txt" >&2
+        exit 1
+    fi
+}
+
+COMMIT=$(git -C "$ROOT" rev-parse --short HEAD 2>/dev/null || echo desconocido)
+DATE=$(date -u +%Y-%m-%dT%H:%M:%SZ)
+: > "$OUTPUT"
+
+# run_scenario <nombre> <puerto destino> <argumentos del generador...>
+run_scenario() {
+    local name=$1 port=$2
+    shift 2
+    echo "== Escenario $name ==" >&2
+    local result
+    result=$("$LOAD" -s 127.0.0.1 -p "$port" -t "$THREADS" "$@" | grep '^test=load')
+    if [ -z "$result" ]; then
+        echo "El generador de carga falló en el escenario $name" >&2
+        exit 1
+    fi
+    local line="scenario=$name commit=$COMMIT date=$DATE ${result#test=load }"
+    echo "$line"
+    echo "$line" >> "$OUTPUT"
+}
+
+start_server 10.0.0.10 10.3.255.250
+run_scenario arranque_en_frio "$SERVER_PORT" -c "$CLIENTS" -r "$RATE" -d "$SECONDS_PER_RUN" -o -m 100:0:0:0
+stop_processes
+
+# El calentamiento deja con lease a casi todos los clientes antes de medir
+start_server 10.0.0.10 10.3.255.250
+run_scenario renovaciones "$SERVER_PORT" -c "$((CLIENTS / 10))" -r "$RATE" -a 3 -d "$SECONDS_PER_RUN" -m 0:100:0:0
+stop_processes
+
+# Unas 1000 direcciones para 20 veces más clientes
+start_server 10.0.0.10 10.0.3.255
+run_scenario pool_agotado "$SERVER_PORT" -c 20000 -r "$RATE" -d "$SECONDS_PER_RUN" -m 100:0:0:0
+stop_processes
+
+start_server 10.0.0.10 10.3.255.250
+start_relay
+run_scenario relay "$RELAY_PORT" -c "$CLIENTS" -r "$RELAY_RATE" -d "$SECONDS_PER_RUN" -m 70:20:5:5
+stop_processes
+
+echo "Resultados en $OUTPUT" >&2
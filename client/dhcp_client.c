@@ -8,6 +8,9 @@
 #include <time.h>
 #include <sys/time.h>  // Agregar este include
 
+#include "dhcp_log.h"
+#include "dhcp_wire.h"
+
 #define BUFFER_SIZE 1024
 #define CLIENT_LOG_FILE "./client/dhcp_client.log"
 // Valores para el algoritmo exponential backoff
@@ -18,6 +21,9 @@
 // Variable global para detener la renovación cuando se presiona Enter
 int stop_renewal = 0;
 
+// Identificador del servidor que hizo la oferta (opción 54), 0 si no lo envió
+uint32_t server_identifier = 0;
+
 // Estructura para pasar parámetros a la función del hilo de renovación
 typedef struct {
     int udp_socket;
@@ -29,19 +35,9 @@ typedef struct {
 
 //Funcion para generar un mensaje de log
 void log_message(const char* level, const char* message, const char* ip, const char* mac) {
-    FILE* log_file = fopen(CLIENT_LOG_FILE, "a");
-    if (log_file == NULL) {
-        perror("No se pudo abrir el archivo de log del cliente");
-        return;
-    }
-
-    time_t now = time(NULL);
-    struct tm* time_info = localtime(&now);
-    char time_str[20];
-    strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", time_info);
-
-    fprintf(log_file, "[%s] %s: %s | IP: %s | MAC: %s\n", time_str, level, message, ip, mac);
-    fclose(log_file);
+    dhcp_log_level log_level = DHCP_LOG_INFO;
+    dhcp_log_parse_level(level, &log_level);
+    dhcp_log(log_level, "%s | IP: %s | MAC: %s", message, ip, mac);
 }
 
 // Función para generar una dirección MAC aleatoria (simulando diferentes clientes)
@@ -52,13 +48,54 @@ void generate_random_mac(char* mac) {
              rand() % 256, rand() % 256);
 }
 
+// Convierte una IPv4 en orden de host a texto (buffer de al menos 16 bytes)
+const char* format_address(uint32_t address, char* buffer) {
+    struct in_addr addr = {htonl(address)};
+    return inet_ntop(AF_INET, &addr, buffer, INET_ADDRSTRLEN);
+}
+
+// Construye y envía un mensaje DHCP del cliente. 'current_ip' va en ciaddr
+// (NULL o "" si todavía no tiene dirección).
+int send_dhcp_message(int udp_socket, struct sockaddr_in* server_addr, uint8_t message_type,
+                      uint32_t xid, const char* mac_address, const char* current_ip) {
+    uint8_t mac[6];
+    if (dhcp_parse_mac(mac_address, mac) != 0) {
+        return -1;
+    }
+
+    uint8_t message[BUFFER_SIZE];
+    dhcp_builder builder;
+    dhcp_builder_init_request(&builder, message, sizeof(message), message_type, xid, mac);
+    struct in_addr addr;
+    if (current_ip != NULL && inet_pton(AF_INET, current_ip, &addr) == 1) {
+        dhcp_set_ciaddr(&builder, ntohl(addr.s_addr));
+    }
+    if (message_type == DHCPRELEASE && server_identifier != 0) {
+        dhcp_add_option_u32(&builder, DHCP_OPT_SERVER_ID, server_identifier);
+    }
+    size_t length = dhcp_finish(&builder);
+
+    return sendto(udp_socket, message, length, 0, (struct sockaddr *)server_addr, sizeof(*server_addr)) < 0 ? -1 : 0;
+}
+
+// Espera la respuesta del servidor a la transacción 'xid' y la deja en 'reply'
+// (que apunta a 'buffer'). Retorna el tipo de mensaje, o -1 si no llegó una
+// respuesta válida antes del tiempo de espera del socket.
+int receive_dhcp_reply(int udp_socket, struct sockaddr_in* server_addr, uint32_t xid,
+                       uint8_t* buffer, size_t size, dhcp_packet_view* reply) {
+    socklen_t server_addr_len = sizeof(*server_addr);
+    int bytes_received = recvfrom(udp_socket, buffer, size, 0,
+                                  (struct sockaddr *)server_addr, &server_addr_len);
+    if (bytes_received <= 0 || dhcp_parse(buffer, (size_t)bytes_received, reply) != 0 ||
+        reply->op != BOOTREPLY || reply->xid != xid) {
+        return -1;
+    }
+    return reply->message_type;
+}
+
 // Función para enviar DHCPRELEASE al servidor
 void send_dhcp_release(int udp_socket, struct sockaddr_in* server_addr, const char* assigned_ip, const char* mac_address) {
-    char release_message[BUFFER_SIZE];
-    snprintf(release_message, BUFFER_SIZE, "DHCPRELEASE: IP=%s; MAC %s", assigned_ip, mac_address);
-
-    if (sendto(udp_socket, release_message, strlen(release_message) + 1, 0,
-               (struct sockaddr *)server_addr, sizeof(*server_addr)) < 0) {
+    if (send_dhcp_message(udp_socket, server_addr, DHCPRELEASE, (uint32_t)rand(), mac_address, assigned_ip) < 0) {
         perror("No se pudo enviar el mensaje DHCPRELEASE");
         log_message("ERROR", "No se pudo enviar el mensaje DHCPRELEASE", assigned_ip, mac_address);
     } else {
@@ -71,11 +108,8 @@ void send_dhcp_release(int udp_socket, struct sockaddr_in* server_addr, const ch
 
 // Solicitar renovación del lease
 void renew_lease(int udp_socket, struct sockaddr_in* server_addr, char* assigned_ip, const char* mac_address) {
-    char request_message[BUFFER_SIZE];
-    snprintf(request_message, BUFFER_SIZE, "DHCPREQUEST: IP=%s; MAC %s", assigned_ip, mac_address);
-
-    if (sendto(udp_socket, request_message, strlen(request_message) + 1, 0,
-               (struct sockaddr *)server_addr, sizeof(*server_addr)) < 0) {
+    uint32_t xid = (uint32_t)rand();
+    if (send_dhcp_message(udp_socket, server_addr, DHCPREQUEST, xid, mac_address, assigned_ip) < 0) {
         perror("No se pudo enviar el mensaje DHCPREQUEST para renovación");
         log_message("ERROR", "No se pudo enviar el mensaje DHCPREQUEST para renovación", assigned_ip, mac_address);
     } else {
@@ -83,38 +117,29 @@ void renew_lease(int udp_socket, struct sockaddr_in* server_addr, char* assigned
         printf("Solicitando renovación para IP: %s\n", assigned_ip);
         log_message("INFO", "Solicitando renovación de lease", assigned_ip, mac_address);
 
-        // Recibir confirmación del servidor (DHCPACK)
-        char buffer[BUFFER_SIZE];
-        socklen_t server_addr_len = sizeof(*server_addr);
-
         // Establecer tiempo de espera para recvfrom
         struct timeval tv;
         tv.tv_sec = 5;  // Tiempo de espera de 5 segundos
         tv.tv_usec = 0;
         setsockopt(udp_socket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof(tv));
 
-        int bytes_received = recvfrom(udp_socket, buffer, BUFFER_SIZE - 1, 0,
-                                      (struct sockaddr *)server_addr, &server_addr_len);
-        if (bytes_received > 0 && strstr(buffer, "DHCPACK")) {
-            buffer[bytes_received] = '\0'; // Asegurar que el buffer es un string válido
-
-            // Parsear el mensaje DHCPACK
-            char subnet_mask[16];
-            char default_gateway[16];
-            char dns_server[16];
-            long lease_time;
-
-            int parsed_fields = sscanf(buffer,
-                "DHCPACK: IP=%15[^;]; MASK=%15[^;]; GATEWAY=%15[^;]; DNS=%15[^;]; LEASE=%ld",
-                assigned_ip, subnet_mask, default_gateway, dns_server, &lease_time);
-
-            if (parsed_fields == 5) {
+        // Recibir confirmación del servidor (DHCPACK)
+        uint8_t buffer[BUFFER_SIZE];
+        dhcp_packet_view reply;
+        if (receive_dhcp_reply(udp_socket, server_addr, xid, buffer, sizeof(buffer), &reply) == DHCPACK) {
+            // Leer los parámetros de red del DHCPACK
+            dhcp_lease_info info;
+            if (dhcp_read_lease_info(&reply, &info) == 0) {
+                char subnet_mask[16];
+                char default_gateway[16];
+                char dns_server[16];
+                format_address(info.address, assigned_ip);
                 printf("Renovación exitosa:\n");
                 printf("IP Asignada: %s\n", assigned_ip);
-                printf("Máscara de Subred: %s\n", subnet_mask);
-                printf("Puerta de Enlace Predeterminada: %s\n", default_gateway);
-                printf("Servidor DNS: %s\n", dns_server);
-                printf("Duración del Lease: %ld segundos\n", lease_time);
+                printf("Máscara de Subred: %s\n", format_address(info.subnet_mask, subnet_mask));
+                printf("Puerta de Enlace Predeterminada: %s\n", format_address(info.router, default_gateway));
+                printf("Servidor DNS: %s\n", format_address(info.dns_server, dns_server));
+                printf("Duración del Lease: %u segundos\n", info.lease_time);
                 printf("------------------------\n");
                 log_message("INFO", "Renovación de lease exitosa", assigned_ip, mac_address);
             } else {
@@ -156,12 +181,9 @@ void* listen_for_enter(void* arg) {
 }
 
 int main() {
-    FILE* log_file = fopen(CLIENT_LOG_FILE, "w");
-    if (log_file != NULL) {
-        fclose(log_file);
-    }
+    dhcp_log_init(CLIENT_LOG_FILE, 1);  // Truncar el log de la ejecución anterior
 
-    char buffer[BUFFER_SIZE];
+    uint8_t buffer[BUFFER_SIZE];
     struct sockaddr_in server_addr, client_addr;
     char mac_address[18];
     char assigned_ip[16] = ""; 
@@ -217,10 +239,8 @@ int main() {
     // Bucle de reintentos con exponential backoff
     while (1) {
         // Enviar mensaje DHCPDISCOVER al servidor mediante broadcast
-        char discover_message[BUFFER_SIZE];
-        snprintf(discover_message, BUFFER_SIZE, "DHCPDISCOVER: MAC %s Solicitud de configuración", mac_address);
-        if (sendto(udp_socket, discover_message, strlen(discover_message) + 1, 0,
-                   (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
+        uint32_t xid = (uint32_t)rand();
+        if (send_dhcp_message(udp_socket, &server_addr, DHCPDISCOVER, xid, mac_address, NULL) < 0) {
             perror("No se pudo enviar el mensaje DHCPDISCOVER");
             log_message("ERROR", "No se pudo enviar el mensaje DHCPDISCOVER", assigned_ip, mac_address);
             close(udp_socket);
@@ -239,14 +259,13 @@ int main() {
         setsockopt(udp_socket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof(tv));
 
         // Recibir respuesta del servidor
-        socklen_t server_addr_len = sizeof(server_addr);
-        int bytes_received = recvfrom(udp_socket, buffer, BUFFER_SIZE - 1, 0,
-                                      (struct sockaddr *)&server_addr, &server_addr_len);
-
-        if (bytes_received > 0) {
-            buffer[bytes_received] = '\0';
-            if (strstr(buffer, "DHCPNOIP")) {
-                printf("DHCPNOIP: El servidor DHCP informó que no hay direcciones IP disponibles.\n");
+        dhcp_packet_view reply;
+        int reply_type = receive_dhcp_reply(udp_socket, &server_addr, xid, buffer, sizeof(buffer), &reply);
+
+        if (reply_type >= 0) {
+            if (reply_type == DHCPNAK) {
+                // El servidor responde con DHCPNAK cuando no le quedan direcciones
+                printf("DHCPNAK: %.*s\n", reply.message_length, reply.message ? (const char*)reply.message : "");
                 log_message("INFO", "El servidor DHCP informó que no hay direcciones IP disponibles", assigned_ip, mac_address);
 
                 // Incrementar el tiempo total de espera
@@ -273,9 +292,9 @@ int main() {
                 sleep(wait_time);
 
                 continue;  // Reintentar enviar DHCPDISCOVER
-            } else if  (strstr(buffer, "DHCPOFFER")) {
+            } else if (reply_type == DHCPOFFER) {
                 printf("\n---- Oferta Recibida ----\n");
-                printf("Oferta del servidor DHCP: %s\n", buffer);
+                printf("Oferta del servidor DHCP: %s (%zu bytes)\n", dhcp_message_name(reply_type), reply.length);
                 printf("--------------------------\n");
                 log_message("INFO", "Oferta del servidor DHCP recibida", assigned_ip, mac_address);
 
@@ -285,12 +304,16 @@ int main() {
                 char dns_server[16];
                 long lease_time;
 
-                // Parsear el mensaje DHCPOFFER
-                int parsed_fields = sscanf(buffer,
-                    "DHCPOFFER: IP=%15[^;]; MASK=%15[^;]; GATEWAY=%15[^;]; DNS=%15[^;]; LEASE=%ld",
-                    assigned_ip, subnet_mask, default_gateway, dns_server, &lease_time);
+                // Leer los parámetros de red del DHCPOFFER
+                dhcp_lease_info info;
+                if (dhcp_read_lease_info(&reply, &info) == 0) {
+                    format_address(info.address, assigned_ip);
+                    format_address(info.subnet_mask, subnet_mask);
+                    format_address(info.router, default_gateway);
+                    format_address(info.dns_server, dns_server);
+                    lease_time = info.lease_time;
+                    server_identifier = info.server_id;
 
-                if (parsed_fields == 5) {
                     printf("\n---- Información Recibida ----\n");
                     printf("IP Asignada: %s\n", assigned_ip);
                     printf("Máscara de Subred: %s\n", subnet_mask);
@@ -327,7 +350,7 @@ int main() {
                     return EXIT_FAILURE;
                 }
             } else {
-                printf("Mensaje desconocido del servidor: %s\n", buffer);
+                printf("Mensaje desconocido del servidor: %s\n", dhcp_message_name(reply_type));
                 log_message("ERROR", "Mensaje desconocido del servidor", assigned_ip, mac_address);
                 // Podemos decidir si reintentar o salir
                 close(udp_socket);
@@ -7,6 +7,9 @@
 #include <time.h>
 #include <pthread.h>  // Añadido para multithreading
 
+#include "dhcp_log.h"
+#include "dhcp_wire.h"
+
 #define BUFFER_SIZE 1024
 #define CLIENTMULTI_LOG_FILE "client/dhcp_client_multithread.log"
 
@@ -22,31 +25,52 @@ void generate_random_mac(char* mac) {
 }
 
 void log_message(const char* level, const char* message, const char* ip, const char* mac) {
-    FILE* log_file = fopen(CLIENTMULTI_LOG_FILE, "a");
-    if (log_file == NULL) {
-        perror("No se pudo abrir el archivo de log del cliente");
-        return;
-    }
+    dhcp_log_level log_level = DHCP_LOG_INFO;
+    dhcp_log_parse_level(level, &log_level);
+    dhcp_log(log_level, "%s | IP: %s | MAC: %s", message, ip, mac);
+}
 
-    time_t now = time(NULL);
-    struct tm* time_info = localtime(&now);
-    char time_str[20];
-    strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", time_info);
+// Convierte una IPv4 en orden de host a texto (buffer de al menos 16 bytes)
+const char* format_address(uint32_t address, char* buffer) {
+    struct in_addr addr = {htonl(address)};
+    return inet_ntop(AF_INET, &addr, buffer, INET_ADDRSTRLEN);
+}
 
-    fprintf(log_file, "[%s] %s: %s | IP: %s | MAC: %s\n", time_str, level, message, ip, mac);
-    fclose(log_file);
+// Imprime la configuración recibida en un DHCPOFFER o DHCPACK
+void print_lease_info(const dhcp_lease_info* info) {
+    char address[INET_ADDRSTRLEN];
+    printf("IP Asignada: %s\n", format_address(info->address, address));
+    printf("Máscara de Subred: %s\n", format_address(info->subnet_mask, address));
+    printf("Puerta de Enlace Predeterminada: %s\n", format_address(info->router, address));
+    printf("Servidor DNS: %s\n", format_address(info->dns_server, address));
+    printf("Duración del Lease: %u segundos\n", info->lease_time);
+}
+
+// Espera la respuesta a la transacción 'xid'. Retorna el tipo de mensaje o -1.
+int receive_dhcp_reply(int udp_socket, uint32_t xid, uint8_t* buffer, size_t size, dhcp_packet_view* reply) {
+    struct sockaddr_in recv_addr;
+    socklen_t recv_addr_len = sizeof(recv_addr);
+    int bytes_received = recvfrom(udp_socket, buffer, size, 0,
+                                  (struct sockaddr *)&recv_addr, &recv_addr_len);
+    if (bytes_received <= 0 || dhcp_parse(buffer, (size_t)bytes_received, reply) != 0 ||
+        reply->op != BOOTREPLY || reply->xid != xid) {
+        return -1;
+    }
+    return reply->message_type;
 }
 
 // Función que simula un cliente DHCP
 void* simulate_client(void* arg) {
     (void)arg;  // Para evitar el warning de parámetro sin usar
 
-    char buffer[BUFFER_SIZE];
+    uint8_t buffer[BUFFER_SIZE];
     struct sockaddr_in server_addr;
     char mac_address[18];
+    uint8_t mac[6];
 
     // Generar una dirección MAC aleatoria
     generate_random_mac(mac_address);
+    dhcp_parse_mac(mac_address, mac);
     printf("MAC Address del cliente: %s\n", mac_address);
     log_message("INFO", "Cliente iniciado", "N/A", mac_address);
 
@@ -73,13 +97,17 @@ void* simulate_client(void* arg) {
     server_addr.sin_port = htons(67);  // Puerto DHCP del servidor
     server_addr.sin_addr.s_addr = htonl(INADDR_BROADCAST);  // Dirección de broadcast
 
-    // Manejo de reintentos para el mensaje DHCPDISCOVER
+    // Manejo de reintentos para el mensaje DHCPDISCOVER. Las retransmisiones
+    // conservan el xid, así el servidor las reconoce y reenvía su respuesta.
     int retries = 0;
+    uint32_t xid = (uint32_t)rand();
     while (retries < MAX_RETRIES) {
         // Enviar mensaje DHCPDISCOVER al servidor mediante broadcast
-        char discover_message[BUFFER_SIZE];
-        snprintf(discover_message, BUFFER_SIZE, "DHCPDISCOVER: MAC %s Solicitud de configuración", mac_address);
-        if (sendto(udp_socket, discover_message, strlen(discover_message) + 1, 0,
+        uint8_t message[BUFFER_SIZE];
+        dhcp_builder builder;
+        dhcp_builder_init_request(&builder, message, sizeof(message), DHCPDISCOVER, xid, mac);
+        size_t length = dhcp_finish(&builder);
+        if (sendto(udp_socket, message, length, 0,
                    (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
             perror("No se pudo enviar el mensaje DHCPDISCOVER");
             log_message("ERROR", "No se pudo enviar el mensaje DHCPDISCOVER", "N/A", mac_address);
@@ -91,35 +119,18 @@ void* simulate_client(void* arg) {
         log_message("INFO", "Mensaje DHCPDISCOVER enviado", "N/A", mac_address);
 
         // Recibir oferta del servidor (DHCPOFFER)
-        struct sockaddr_in recv_addr;
-        socklen_t recv_addr_len = sizeof(recv_addr);
-        int bytes_received = recvfrom(udp_socket, buffer, BUFFER_SIZE - 1, 0,
-                                      (struct sockaddr *)&recv_addr, &recv_addr_len);
-
-        if (bytes_received > 0 && strstr(buffer, "DHCPOFFER")) {
-            buffer[bytes_received] = '\0'; // Asegurar que el buffer es un string válido
-            printf("Oferta recibida del servidor DHCP: %s\n", buffer);
+        dhcp_packet_view reply;
+        if (receive_dhcp_reply(udp_socket, xid, buffer, sizeof(buffer), &reply) == DHCPOFFER) {
+            printf("Oferta recibida del servidor DHCP (%zu bytes)\n", reply.length);
             log_message("INFO", "Oferta recibida del servidor DHCP", "N/A", mac_address);
 
-            // Variables para almacenar la información
+            // Leer los parámetros de red del DHCPOFFER
+            dhcp_lease_info info;
             char assigned_ip[16];
-            char subnet_mask[16];
-            char default_gateway[16];
-            char dns_server[16];
-            long lease_time;
-
-            // Parsear el mensaje DHCPOFFER
-            int parsed_fields = sscanf(buffer,
-                "DHCPOFFER: IP=%15[^;]; MASK=%15[^;]; GATEWAY=%15[^;]; DNS=%15[^;]; LEASE=%ld",
-                assigned_ip, subnet_mask, default_gateway, dns_server, &lease_time);
-
-            if (parsed_fields == 5) {
+            if (dhcp_read_lease_info(&reply, &info) == 0) {
+                format_address(info.address, assigned_ip);
                 printf("Información recibida:\n");
-                printf("IP Asignada: %s\n", assigned_ip);
-                printf("Máscara de Subred: %s\n", subnet_mask);
-                printf("Puerta de Enlace Predeterminada: %s\n", default_gateway);
-                printf("Servidor DNS: %s\n", dns_server);
-                printf("Duración del Lease: %ld segundos\n", lease_time);
+                print_lease_info(&info);
                 log_message("INFO", "Información recibida del servidor DHCP", assigned_ip, mac_address);
             } else {
                 printf("No se pudo parsear correctamente la oferta del servidor.\n");
@@ -129,9 +140,13 @@ void* simulate_client(void* arg) {
             }
 
             // Enviar mensaje DHCPREQUEST al servidor para solicitar la IP ofrecida
-            char request_message[BUFFER_SIZE];
-            snprintf(request_message, BUFFER_SIZE, "DHCPREQUEST: IP=%s; MAC %s", assigned_ip, mac_address);
-            if (sendto(udp_socket, request_message, strlen(request_message) + 1, 0,
+            dhcp_builder_init_request(&builder, message, sizeof(message), DHCPREQUEST, xid, mac);
+            dhcp_add_option_u32(&builder, DHCP_OPT_REQUESTED_IP, info.address);
+            if (info.server_id != 0) {
+                dhcp_add_option_u32(&builder, DHCP_OPT_SERVER_ID, info.server_id);
+            }
+            length = dhcp_finish(&builder);
+            if (sendto(udp_socket, message, length, 0,
                        (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
                 perror("No se pudo enviar el mensaje DHCPREQUEST");
                 log_message("ERROR", "No se pudo enviar el mensaje DHCPREQUEST", assigned_ip, mac_address);
@@ -143,23 +158,12 @@ void* simulate_client(void* arg) {
             log_message("INFO", "Mensaje DHCPREQUEST enviado", assigned_ip, mac_address);
 
             // Recibir confirmación del servidor (DHCPACK)
-            bytes_received = recvfrom(udp_socket, buffer, BUFFER_SIZE - 1, 0,
-                                      (struct sockaddr *)&recv_addr, &recv_addr_len);
-            if (bytes_received > 0 && strstr(buffer, "DHCPACK")) {
-                buffer[bytes_received] = '\0'; // Asegurar que el buffer es un string válido
-
-                // Parsear el mensaje DHCPACK
-                parsed_fields = sscanf(buffer,
-                    "DHCPACK: IP=%15[^;]; MASK=%15[^;]; GATEWAY=%15[^;]; DNS=%15[^;]; LEASE=%ld",
-                    assigned_ip, subnet_mask, default_gateway, dns_server, &lease_time);
-
-                if (parsed_fields == 5) {
+            if (receive_dhcp_reply(udp_socket, xid, buffer, sizeof(buffer), &reply) == DHCPACK) {
+                // Leer los parámetros de red del DHCPACK
+                if (dhcp_read_lease_info(&reply, &info) == 0) {
+                    format_address(info.address, assigned_ip);
                     printf("Confirmación recibida del servidor DHCP:\n");
-                    printf("IP Asignada: %s\n", assigned_ip);
-                    printf("Máscara de Subred: %s\n", subnet_mask);
-                    printf("Puerta de Enlace Predeterminada: %s\n", default_gateway);
-                    printf("Servidor DNS: %s\n", dns_server);
-                    printf("Duración del Lease: %ld segundos\n", lease_time);
+                    print_lease_info(&info);
                     log_message("INFO", "Confirmación recibida del servidor DHCP", assigned_ip, mac_address);
                 } else {
                     printf("No se pudo parsear correctamente la confirmación del servidor.\n");
@@ -190,10 +194,7 @@ void* simulate_client(void* arg) {
 
 int main() {
 
-    FILE* log_file = fopen(CLIENTMULTI_LOG_FILE, "w");
-    if (log_file != NULL) {
-        fclose(log_file);
-    }
+    dhcp_log_init(CLIENTMULTI_LOG_FILE, 1);  // Truncar el log de la ejecución anterior
     pthread_t clients[NUM_CLIENTS];
 
     // Crear múltiples hilos para simular varios clientes
@@ -0,0 +1,696 @@
+// client/dhcp_load_generator.c
+// Generador de carga DHCP de lazo abierto. Simula muchos clientes (100000 por
+// defecto, cada uno con su MAC) desde unos pocos hilos; cada hilo tiene un
+// socket UDP no bloqueante y atiende una parte de las MAC. Las transacciones
+// nuevas llegan a intervalos fijos según la tasa pedida, sin esperar a que
+// terminen las anteriores, así que una respuesta lenta no frena la carga.
+//
+// En cada llegada se elige una MAC (al azar, o en orden con -o para que cada
+// cliente arranque una vez antes de repetir) y una operación según la mezcla
+// (-m): DISCOVER (intercambio completo DISCOVER/OFFER/REQUEST/ACK), REQUEST
+// (renovación con ciaddr), RELEASE o DECLINE. Las tres últimas requieren un
+// lease; una MAC sin lease hace un DISCOVER. Las latencias se miden desde el
+// instante programado de la llegada, de modo que un retraso del propio
+// generador también cuenta. Con -a las llegadas de los primeros segundos
+// (calentamiento, p. ej. para que los clientes obtengan lease antes de medir
+// renovaciones) no se cuentan. Al terminar se escriben el caudal y los
+// percentiles p50/p99/p99.9 de DISCOVER->ACK y de las renovaciones, en texto
+// y en una línea "clave=valor".
+#define _GNU_SOURCE  // ppoll/recvmmsg
+#include <arpa/inet.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "dhcp_wire.h"
+
+#define DEFAULT_CLIENTS 100000
+#define DEFAULT_THREADS 4
+#define DEFAULT_RATE 10000           // Transacciones nuevas por segundo entre todos los hilos
+#define DEFAULT_SECONDS 10
+#define DEFAULT_TIMEOUT_MS 1000      // Sin respuesta en este tiempo la transacción se da por perdida
+#define MAX_LOAD_CLIENTS (1u << 24)  // Las MAC llevan el índice del cliente en 32 bits
+#define MAX_LOAD_THREADS 64
+#define RECEIVE_BATCH 64             // Datagramas por recvmmsg
+#define SCAN_INTERVAL_NS 20000000ull // Cada cuánto se buscan transacciones vencidas
+#define BUSY_PROBES 8                // Clientes que se prueban si el elegido tiene una transacción en curso
+#define SOCKET_BUFFER_BYTES (4 << 20)
+
+// Histograma log-lineal en microsegundos: 16 cubetas por potencia de 2
+// (error < 6.25 %), hasta 2^26 us (~67 s)
+#define LATENCY_SUB_BITS 4
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BITS)
+#define LATENCY_MAX_EXPONENT 26
+#define LATENCY_BUCKETS ((LATENCY_MAX_EXPONENT - LATENCY_SUB_BITS + 2) * LATENCY_SUB_BUCKETS)
+
+// Operaciones de la mezcla (-m discover:request:release:decline)
+enum {
+    OP_DISCOVER,
+    OP_RENEW,
+    OP_RELEASE,
+    OP_DECLINE,
+    OP_COUNT
+};
+
+typedef enum {
+    CLIENT_IDLE,        // Sin lease
+    CLIENT_BOUND,       // Con lease, sin transacción en curso
+    CLIENT_SELECTING,   // DISCOVER enviado, espera OFFER
+    CLIENT_REQUESTING,  // REQUEST de la oferta enviado, espera ACK
+    CLIENT_RENEWING     // REQUEST de renovación enviado, espera ACK
+} client_state;
+
+typedef struct {
+    uint64_t started_ns;   // Instante programado de la transacción en curso
+    uint64_t deadline_ns;
+    uint32_t address;      // IP del lease (orden de host), 0 sin lease
+    uint32_t server_id;    // Servidor que concedió el lease
+    uint32_t xid;
+    uint8_t state;
+} simulated_client;
+
+typedef struct {
+    unsigned long operations[OP_COUNT];  // Transacciones iniciadas por tipo
+    unsigned long packets_sent;
+    unsigned long send_errors;
+    unsigned long replies;
+    unsigned long offers;
+    unsigned long acks;
+    unsigned long naks;
+    unsigned long stale_replies;  // xid o estado que no corresponden (p. ej. tras un timeout)
+    unsigned long malformed;
+    unsigned long timeouts;
+    unsigned long busy_skipped;   // Llegadas sin cliente libre entre BUSY_PROBES
+    uint64_t max_lag_ns;          // Mayor retraso del generador respecto al instante programado
+    unsigned long handshake[LATENCY_BUCKETS];  // DISCOVER -> ACK
+    unsigned long renewal[LATENCY_BUCKETS];    // REQUEST (renovación) -> ACK
+} load_stats;
+
+typedef struct {
+    int index;
+    int udp_socket;
+    uint32_t first_client;
+    uint32_t client_count;
+    simulated_client* clients;
+    uint64_t interval_ns;  // Separación entre llegadas de este hilo
+    uint64_t start_ns;
+    uint64_t measure_ns;   // Fin del calentamiento: aquí se ponen a cero las estadísticas
+    uint64_t end_ns;
+    uint64_t rng;
+    uint32_t next_client;  // Con -o, siguiente cliente en orden
+    int measuring;
+    unsigned int in_flight;
+    load_stats stats;
+} load_thread;
+
+// Parámetros comunes a todos los hilos
+static struct sockaddr_in server_addr;
+static struct sockaddr_in local_addr;
+static uint32_t mac_prefix = 0x024c;  // Dos primeros bytes de las MAC simuladas (administradas localmente)
+static unsigned int mix[OP_COUNT] = {70, 20, 5, 5};
+static unsigned int mix_total = 100;
+static uint64_t timeout_ns = DEFAULT_TIMEOUT_MS * 1000000ull;
+static int in_order = 0;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// xorshift64 por hilo: rand() comparte estado entre hilos
+static uint32_t next_random(load_thread* thread) {
+    thread->rng ^= thread->rng << 13;
+    thread->rng ^= thread->rng >> 7;
+    thread->rng ^= thread->rng << 17;
+    return (uint32_t)(thread->rng >> 32);
+}
+
+static int latency_bucket(uint64_t micros) {
+    if (micros < LATENCY_SUB_BUCKETS) {
+        return (int)micros;
+    }
+    int exponent = 63 - __builtin_clzll(micros);
+    if (exponent > LATENCY_MAX_EXPONENT) {
+        return LATENCY_BUCKETS - 1;
+    }
+    int sub = (int)(micros >> (exponent - LATENCY_SUB_BITS)) & (LATENCY_SUB_BUCKETS - 1);
+    return (exponent - LATENCY_SUB_BITS + 1) * LATENCY_SUB_BUCKETS + sub;
+}
+
+// Límite superior (exclusivo) de la cubeta en microsegundos
+static uint64_t bucket_limit(int bucket) {
+    if (bucket < LATENCY_SUB_BUCKETS) {
+        return (uint64_t)bucket + 1;
+    }
+    int exponent = bucket / LATENCY_SUB_BUCKETS + LATENCY_SUB_BITS - 1;
+    uint64_t sub = (uint64_t)(bucket % LATENCY_SUB_BUCKETS);
+    return (LATENCY_SUB_BUCKETS + sub + 1) << (exponent - LATENCY_SUB_BITS);
+}
+
+static void record_latency(unsigned long* histogram, uint64_t started_ns, uint64_t now) {
+    histogram[latency_bucket(now > started_ns ? (now - started_ns) / 1000 : 0)]++;
+}
+
+static unsigned long histogram_total(const unsigned long* histogram) {
+    unsigned long total = 0;
+    for (int bucket = 0; bucket < LATENCY_BUCKETS; ++bucket) {
+        total += histogram[bucket];
+    }
+    return total;
+}
+
+static uint64_t latency_percentile(const unsigned long* histogram, double percentile) {
+    unsigned long total = histogram_total(histogram);
+    if (total == 0) {
+        return 0;
+    }
+    unsigned long target = (unsigned long)(total * percentile);
+    unsigned long seen = 0;
+    for (int bucket = 0; bucket < LATENCY_BUCKETS; ++bucket) {
+        seen += histogram[bucket];
+        if (seen > target) {
+            return bucket_limit(bucket);
+        }
+    }
+    return bucket_limit(LATENCY_BUCKETS - 1);
+}
+
+// MAC del cliente: prefijo de 2 bytes + índice global en 4 bytes
+static void client_mac(uint32_t index, uint8_t mac[6]) {
+    mac[0] = (uint8_t)(mac_prefix >> 8);
+    mac[1] = (uint8_t)mac_prefix;
+    mac[2] = (uint8_t)(index >> 24);
+    mac[3] = (uint8_t)(index >> 16);
+    mac[4] = (uint8_t)(index >> 8);
+    mac[5] = (uint8_t)index;
+}
+
+static int mac_to_index(const uint8_t* chaddr, uint32_t* index) {
+    if (((uint32_t)chaddr[0] << 8 | chaddr[1]) != mac_prefix) {
+        return -1;
+    }
+    *index = (uint32_t)chaddr[2] << 24 | (uint32_t)chaddr[3] << 16 | (uint32_t)chaddr[4] << 8 | chaddr[5];
+    return 0;
+}
+
+static void send_message(load_thread* thread, const uint8_t* message, size_t length) {
+    if (sendto(thread->udp_socket, message, length, MSG_DONTWAIT, (const struct sockaddr*)&server_addr,
+               sizeof(server_addr)) < 0) {
+        thread->stats.send_errors++;
+        return;
+    }
+    thread->stats.packets_sent++;
+}
+
+// Envía el mensaje 'type' del cliente con las direcciones que correspondan al tipo
+static void send_client_message(load_thread* thread, uint32_t index, uint8_t type, uint32_t requested) {
+    simulated_client* client = &thread->clients[index - thread->first_client];
+    uint8_t mac[6];
+    client_mac(index, mac);
+    uint8_t message[DHCP_MAX_PACKET_SIZE];
+    dhcp_builder builder;
+    dhcp_builder_init_request(&builder, message, sizeof(message), type, client->xid, mac);
+    switch (type) {
+        case DHCPREQUEST:
+            if (requested != 0) {
+                // SELECTING: la IP ofrecida en la opción 50 y el servidor elegido
+                dhcp_add_option_u32(&builder, DHCP_OPT_REQUESTED_IP, requested);
+                if (client->server_id != 0) {
+                    dhcp_add_option_u32(&builder, DHCP_OPT_SERVER_ID, client->server_id);
+                }
+            } else {
+                // Renovación: la IP actual va en ciaddr
+                dhcp_set_ciaddr(&builder, client->address);
+            }
+            break;
+        case DHCPRELEASE:
+            dhcp_set_ciaddr(&builder, client->address);
+            dhcp_add_option_u32(&builder, DHCP_OPT_SERVER_ID, client->server_id);
+            break;
+        case DHCPDECLINE:
+            dhcp_add_option_u32(&builder, DHCP_OPT_REQUESTED_IP, client->address);
+            dhcp_add_option_u32(&builder, DHCP_OPT_SERVER_ID, client->server_id);
+            break;
+        default:
+            break;
+    }
+    size_t length = dhcp_finish(&builder);
+    if (length != 0) {
+        send_message(thread, message, length);
+    }
+}
+
+static int pick_operation(load_thread* thread) {
+    unsigned int roll = next_random(thread) % mix_total;
+    for (int op = 0; op < OP_COUNT; ++op) {
+        if (roll < mix[op]) {
+            return op;
+        }
+        roll -= mix[op];
+    }
+    return OP_DISCOVER;
+}
+
+// Una llegada programada en 'scheduled': elige cliente y operación y envía el primer mensaje
+static void start_transaction(load_thread* thread, uint64_t scheduled) {
+    uint32_t offset = in_order ? thread->next_client++ % thread->client_count : next_random(thread) % thread->client_count;
+    simulated_client* client = NULL;
+    for (int probe = 0; probe < BUSY_PROBES; ++probe) {
+        simulated_client* candidate = &thread->clients[(offset + (uint32_t)probe) % thread->client_count];
+        if (candidate->state == CLIENT_IDLE || candidate->state == CLIENT_BOUND) {
+            client = candidate;
+            break;
+        }
+    }
+    if (client == NULL) {
+        thread->stats.busy_skipped++;
+        return;
+    }
+    uint32_t index = thread->first_client + (uint32_t)(client - thread->clients);
+
+    int op = client->address != 0 ? pick_operation(thread) : OP_DISCOVER;
+    thread->stats.operations[op]++;
+    client->xid = next_random(thread);
+    client->started_ns = scheduled;
+    client->deadline_ns = scheduled + timeout_ns;
+    switch (op) {
+        case OP_DISCOVER:
+            client->state = CLIENT_SELECTING;
+            thread->in_flight++;
+            send_client_message(thread, index, DHCPDISCOVER, 0);
+            break;
+        case OP_RENEW:
+            client->state = CLIENT_RENEWING;
+            thread->in_flight++;
+            send_client_message(thread, index, DHCPREQUEST, 0);
+            break;
+        case OP_RELEASE:
+        case OP_DECLINE:
+            // Sin respuesta: el cliente queda sin lease en cuanto envía el mensaje
+            send_client_message(thread, index, op == OP_RELEASE ? DHCPRELEASE : DHCPDECLINE, 0);
+            client->address = 0;
+            client->state = CLIENT_IDLE;
+            break;
+    }
+}
+
+static void finish_transaction(load_thread* thread, simulated_client* client, uint32_t address) {
+    client->address = address;
+    client->state = address != 0 ? CLIENT_BOUND : CLIENT_IDLE;
+    thread->in_flight--;
+}
+
+static void handle_reply(load_thread* thread, const uint8_t* buffer, size_t length, uint64_t now) {
+    dhcp_packet_view reply;
+    uint32_t index;
+    if (dhcp_parse(buffer, length, &reply) != 0 || reply.op != BOOTREPLY || mac_to_index(reply.chaddr, &index) != 0 ||
+        index - thread->first_client >= thread->client_count) {
+        thread->stats.malformed++;
+        return;
+    }
+    thread->stats.replies++;
+    simulated_client* client = &thread->clients[index - thread->first_client];
+    if (reply.xid != client->xid) {
+        thread->stats.stale_replies++;
+        return;
+    }
+
+    if (reply.message_type == DHCPNAK) {
+        if (client->state == CLIENT_SELECTING || client->state == CLIENT_REQUESTING ||
+            client->state == CLIENT_RENEWING) {
+            thread->stats.naks++;
+            finish_transaction(thread, client, 0);
+        } else {
+            thread->stats.stale_replies++;
+        }
+        return;
+    }
+
+    if (client->state == CLIENT_SELECTING && reply.message_type == DHCPOFFER) {
+        thread->stats.offers++;
+        dhcp_lease_info info;
+        if (dhcp_read_lease_info(&reply, &info) != 0) {
+            thread->stats.malformed++;
+            finish_transaction(thread, client, client->address);
+            return;
+        }
+        client->server_id = info.server_id;
+        client->state = CLIENT_REQUESTING;
+        send_client_message(thread, index, DHCPREQUEST, info.address);
+    } else if (client->state == CLIENT_REQUESTING && reply.message_type == DHCPACK) {
+        thread->stats.acks++;
+        record_latency(thread->stats.handshake, client->started_ns, now);
+        finish_transaction(thread, client, reply.yiaddr);
+    } else if (client->state == CLIENT_RENEWING && reply.message_type == DHCPACK) {
+        thread->stats.acks++;
+        record_latency(thread->stats.renewal, client->started_ns, now);
+        finish_transaction(thread, client, reply.yiaddr);
+    } else {
+        thread->stats.stale_replies++;
+    }
+}
+
+static void receive_replies(load_thread* thread) {
+    static __thread uint8_t buffers[RECEIVE_BATCH][DHCP_MAX_PACKET_SIZE];
+    struct mmsghdr messages[RECEIVE_BATCH];
+    struct iovec vectors[RECEIVE_BATCH];
+    for (;;) {
+        for (int i = 0; i < RECEIVE_BATCH; ++i) {
+            vectors[i].iov_base = buffers[i];
+            vectors[i].iov_len = sizeof(buffers[i]);
+            memset(&messages[i], 0, sizeof(messages[i]));
+            messages[i].msg_hdr.msg_iov = &vectors[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+        int received = recvmmsg(thread->udp_socket, messages, RECEIVE_BATCH, MSG_DONTWAIT, NULL);
+        if (received <= 0) {
+            return;  // EAGAIN: no queda nada en el socket
+        }
+        uint64_t now = now_ns();
+        for (int i = 0; i < received; ++i) {
+            handle_reply(thread, buffers[i], messages[i].msg_len, now);
+        }
+        if (received < RECEIVE_BATCH) {
+            return;
+        }
+    }
+}
+
+// Da por perdidas las transacciones cuyo plazo venció
+static void expire_transactions(load_thread* thread, uint64_t now) {
+    for (uint32_t i = 0; i < thread->client_count && thread->in_flight > 0; ++i) {
+        simulated_client* client = &thread->clients[i];
+        if (client->state >= CLIENT_SELECTING && client->deadline_ns <= now) {
+            thread->stats.timeouts++;
+            // Una renovación perdida conserva el lease; un intercambio perdido no deja ninguno nuevo
+            finish_transaction(thread, client, client->address);
+        }
+    }
+}
+
+static void* load_loop(void* arg) {
+    load_thread* thread = (load_thread*)arg;
+    uint64_t next_arrival = thread->start_ns;
+    uint64_t next_scan = thread->start_ns + SCAN_INTERVAL_NS;
+    uint64_t drain_end = thread->end_ns + timeout_ns;
+    struct pollfd descriptor = {thread->udp_socket, POLLIN, 0};
+
+    for (;;) {
+        uint64_t now = now_ns();
+        if (!thread->measuring && now >= thread->measure_ns) {
+            memset(&thread->stats, 0, sizeof(thread->stats));
+            thread->measuring = 1;
+        }
+        // Todas las llegadas cuyo instante ya pasó, aunque el hilo vaya atrasado
+        while (next_arrival <= now && next_arrival < thread->end_ns) {
+            uint64_t lag = now - next_arrival;
+            if (lag > thread->stats.max_lag_ns) {
+                thread->stats.max_lag_ns = lag;
+            }
+            start_transaction(thread, next_arrival);
+            next_arrival += thread->interval_ns;
+        }
+        if (now >= next_scan) {
+            expire_transactions(thread, now);
+            next_scan = now + SCAN_INTERVAL_NS;
+        }
+        if ((next_arrival >= thread->end_ns && thread->in_flight == 0) || now >= drain_end) {
+            break;
+        }
+        receive_replies(thread);
+
+        // Dormir hasta el siguiente evento programado o hasta que llegue una respuesta
+        uint64_t wake = next_scan;
+        if (next_arrival < thread->end_ns && next_arrival < wake) {
+            wake = next_arrival;
+        }
+        now = now_ns();
+        if (wake > now) {
+            uint64_t wait = wake - now;
+            struct timespec timeout = {(time_t)(wait / 1000000000ull), (long)(wait % 1000000000ull)};
+            if (ppoll(&descriptor, 1, &timeout, NULL) > 0) {
+                receive_replies(thread);
+            }
+        }
+    }
+    return NULL;
+}
+
+static int open_client_socket(void) {
+    int udp_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (udp_socket < 0) {
+        perror("No se pudo crear el socket");
+        return -1;
+    }
+    int buffer_size = SOCKET_BUFFER_BYTES;
+    setsockopt(udp_socket, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+    setsockopt(udp_socket, SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
+    int enable = 1;
+    setsockopt(udp_socket, SOL_SOCKET, SO_BROADCAST, &enable, sizeof(enable));
+    // Puerto efímero: no hacen falta privilegios
+    if (bind(udp_socket, (struct sockaddr*)&local_addr, sizeof(local_addr)) < 0) {
+        perror("No se pudo enlazar el socket");
+        close(udp_socket);
+        return -1;
+    }
+    return udp_socket;
+}
+
+// "70:20:5:5" -> pesos de discover, request, release y decline
+static int parse_mix(const char* text) {
+    unsigned int weights[OP_COUNT];
+    char extra;
+    if (sscanf(text, "%u:%u:%u:%u%c", &weights[0], &weights[1], &weights[2], &weights[3], &extra) != 4) {
+        return -1;
+    }
+    unsigned long total = 0;
+    for (int op = 0; op < OP_COUNT; ++op) {
+        total += weights[op];
+    }
+    if (total == 0 || total > 1000000) {
+        return -1;
+    }
+    memcpy(mix, weights, sizeof(mix));
+    mix_total = (unsigned int)total;
+    return 0;
+}
+
+static void add_stats(load_stats* total, const load_stats* stats) {
+    for (int op = 0; op < OP_COUNT; ++op) {
+        total->operations[op] += stats->operations[op];
+    }
+    total->packets_sent += stats->packets_sent;
+    total->send_errors += stats->send_errors;
+    total->replies += stats->replies;
+    total->offers += stats->offers;
+    total->acks += stats->acks;
+    total->naks += stats->naks;
+    total->stale_replies += stats->stale_replies;
+    total->malformed += stats->malformed;
+    total->timeouts += stats->timeouts;
+    total->busy_skipped += stats->busy_skipped;
+    if (stats->max_lag_ns > total->max_lag_ns) {
+        total->max_lag_ns = stats->max_lag_ns;
+    }
+    for (int bucket = 0; bucket < LATENCY_BUCKETS; ++bucket) {
+        total->handshake[bucket] += stats->handshake[bucket];
+        total->renewal[bucket] += stats->renewal[bucket];
+    }
+}
+
+static void print_usage(const char* program) {
+    printf("Uso: %s [-s IP_servidor] [-p puerto] [-l IP_local] [-c clientes] [-t hilos] [-r transacciones/s] "
+           "[-d segundos] [-a calentamiento_s] [-o] [-m discover:request:release:decline] [-w espera_ms]\n", program);
+}
+
+int main(int argc, char* argv[]) {
+    const char* server_ip = "127.0.0.1";
+    const char* local_ip = "0.0.0.0";
+    long server_port = DHCP_SERVER_PORT;
+    long clients = DEFAULT_CLIENTS;
+    long threads = DEFAULT_THREADS;
+    double rate = DEFAULT_RATE;
+    double seconds = DEFAULT_SECONDS;
+    double warmup = 0;
+    long timeout_ms = DEFAULT_TIMEOUT_MS;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:p:l:c:t:r:d:a:om:w:")) != -1) {
+        switch (opt) {
+            case 's':
+                server_ip = optarg;
+                break;
+            case 'p':
+                server_port = atol(optarg);
+                break;
+            case 'l':
+                local_ip = optarg;
+                break;
+            case 'c':
+                clients = atol(optarg);
+                break;
+            case 't':
+                threads = atol(optarg);
+                break;
+            case 'r':
+                rate = atof(optarg);
+                break;
+            case 'd':
+                seconds = atof(optarg);
+                break;
+            case 'a':
+                warmup = atof(optarg);
+                break;
+            case 'o':
+                in_order = 1;
+                break;
+            case 'm':
+                if (parse_mix(optarg) != 0) {
+                    printf("Mezcla inválida: se esperaban cuatro pesos discover:request:release:decline.\n");
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'w':
+                timeout_ms = atol(optarg);
+                break;
+            default:
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (optind != argc) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (threads < 1 || threads > MAX_LOAD_THREADS) {
+        printf("El número de hilos debe estar entre 1 y %d.\n", MAX_LOAD_THREADS);
+        return EXIT_FAILURE;
+    }
+    if (clients < threads || clients > (long)MAX_LOAD_CLIENTS) {
+        printf("El número de clientes debe estar entre el número de hilos y %u.\n", MAX_LOAD_CLIENTS);
+        return EXIT_FAILURE;
+    }
+    if (rate <= 0 || seconds <= 0 || warmup < 0 || timeout_ms <= 0 || server_port < 1 || server_port > 65535) {
+        printf("La tasa, la duración, la espera y el puerto deben ser positivos.\n");
+        return EXIT_FAILURE;
+    }
+    timeout_ns = (uint64_t)timeout_ms * 1000000ull;
+
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons((uint16_t)server_port);
+    memset(&local_addr, 0, sizeof(local_addr));
+    local_addr.sin_family = AF_INET;
+    if (inet_pton(AF_INET, server_ip, &server_addr.sin_addr) != 1 ||
+        inet_pton(AF_INET, local_ip, &local_addr.sin_addr) != 1) {
+        printf("Las direcciones del servidor y local deben ser IPv4 válidas.\n");
+        return EXIT_FAILURE;
+    }
+
+    simulated_client* states = calloc((size_t)clients, sizeof(simulated_client));
+    load_thread* workers = calloc((size_t)threads, sizeof(load_thread));
+    if (states == NULL || workers == NULL) {
+        printf("No hay memoria para %ld clientes.\n", clients);
+        return EXIT_FAILURE;
+    }
+
+    printf("Generador de carga: %ld clientes, %ld hilos, %.0f transacciones/s durante %.1f s (+%.1f s de calentamiento) contra %s:%ld\n",
+           clients, threads, rate, seconds, warmup, server_ip, server_port);
+    printf("Mezcla: discover=%u request=%u release=%u decline=%u\n", mix[OP_DISCOVER], mix[OP_RENEW],
+           mix[OP_RELEASE], mix[OP_DECLINE]);
+
+    // Todos los hilos empiezan en el mismo instante, algo después de crearlos
+    uint64_t start = now_ns() + 50000000ull;
+    uint64_t measure = start + (uint64_t)(warmup * 1e9);
+    uint64_t end = measure + (uint64_t)(seconds * 1e9);
+    for (long t = 0; t < threads; ++t) {
+        load_thread* thread = &workers[t];
+        thread->index = (int)t;
+        thread->first_client = (uint32_t)(clients * t / threads);
+        thread->client_count = (uint32_t)(clients * (t + 1) / threads) - thread->first_client;
+        thread->clients = states + thread->first_client;
+        thread->interval_ns = (uint64_t)(1e9 * threads / rate);
+        if (thread->interval_ns == 0) {
+            thread->interval_ns = 1;
+        }
+        // Los hilos se desfasan para no enviar todos a la vez
+        thread->start_ns = start + thread->interval_ns * (uint64_t)t / (uint64_t)threads;
+        thread->measure_ns = measure;
+        thread->end_ns = end;
+        thread->rng = 0x9e3779b97f4a7c15ull ^ ((uint64_t)(t + 1) * 0xbf58476d1ce4e5b9ull);
+        thread->udp_socket = open_client_socket();
+        if (thread->udp_socket < 0) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    pthread_t* thread_ids = calloc((size_t)threads, sizeof(pthread_t));
+    if (thread_ids == NULL) {
+        return EXIT_FAILURE;
+    }
+    for (long t = 0; t < threads; ++t) {
+        if (pthread_create(&thread_ids[t], NULL, load_loop, &workers[t]) != 0) {
+            perror("No se pudo crear el hilo generador");
+            return EXIT_FAILURE;
+        }
+    }
+    load_stats total;
+    memset(&total, 0, sizeof(total));
+    for (long t = 0; t < threads; ++t) {
+        pthread_join(thread_ids[t], NULL);
+        add_stats(&total, &workers[t].stats);
+        close(workers[t].udp_socket);
+    }
+
+    unsigned long bound = 0;
+    for (long i = 0; i < clients; ++i) {
+        bound += states[i].address != 0;
+    }
+    unsigned long started = 0;
+    for (int op = 0; op < OP_COUNT; ++op) {
+        started += total.operations[op];
+    }
+    unsigned long handshakes = histogram_total(total.handshake);
+    unsigned long renewals = histogram_total(total.renewal);
+
+    printf("\n---- RESULTADO DE LA CARGA ----\n");
+    printf("Transacciones iniciadas: %lu (discover=%lu request=%lu release=%lu decline=%lu), omitidas por clientes ocupados: %lu\n",
+           started, total.operations[OP_DISCOVER], total.operations[OP_RENEW], total.operations[OP_RELEASE],
+           total.operations[OP_DECLINE], total.busy_skipped);
+    printf("Paquetes enviados: %lu (errores: %lu), respuestas: %lu (OFFER=%lu ACK=%lu NAK=%lu, obsoletas=%lu, inválidas=%lu)\n",
+           total.packets_sent, total.send_errors, total.replies, total.offers, total.acks, total.naks,
+           total.stale_replies, total.malformed);
+    printf("Sin respuesta: %lu, clientes con lease al terminar: %lu, mayor retraso del generador: %.2f ms\n",
+           total.timeouts, bound, total.max_lag_ns / 1e6);
+    printf("ACK por segundo: %.0f\n", total.acks / seconds);
+    printf("DISCOVER->ACK (%lu): p50=%lu us p99=%lu us p99.9=%lu us\n", handshakes,
+           (unsigned long)latency_percentile(total.handshake, 0.50), (unsigned long)latency_percentile(total.handshake, 0.99),
+           (unsigned long)latency_percentile(total.handshake, 0.999));
+    printf("REQUEST->ACK (%lu): p50=%lu us p99=%lu us p99.9=%lu us\n", renewals,
+           (unsigned long)latency_percentile(total.renewal, 0.50), (unsigned long)latency_percentile(total.renewal, 0.99),
+           (unsigned long)latency_percentile(total.renewal, 0.999));
+    printf("-------------------------------\n");
+
+    printf("test=load clients=%ld threads=%ld rate=%.0f seconds=%.1f started=%lu skipped=%lu sent=%lu send_errors=%lu "
+           "offers=%lu acks=%lu naks=%lu timeouts=%lu stale=%lu bound=%lu acks_per_s=%.0f max_lag_ms=%.2f "
+           "handshake_p50_us=%lu handshake_p99_us=%lu handshake_p999_us=%lu "
+           "renew_p50_us=%lu renew_p99_us=%lu renew_p999_us=%lu\n",
+           clients, threads, rate, seconds, started, total.busy_skipped, total.packets_sent, total.send_errors,
+           total.offers, total.acks, total.naks, total.timeouts, total.stale_replies, bound, total.acks / seconds,
+           total.max_lag_ns / 1e6, (unsigned long)latency_percentile(total.handshake, 0.50),
+           (unsigned long)latency_percentile(total.handshake, 0.99), (unsigned long)latency_percentile(total.handshake, 0.999),
+           (unsigned long)latency_percentile(total.renewal, 0.50), (unsigned long)latency_percentile(total.renewal, 0.99),
+           (unsigned long)latency_percentile(total.renewal, 0.999));
+
+    free(thread_ids);
+    free(workers);
+    free(states);
+    return EXIT_SUCCESS;
+}
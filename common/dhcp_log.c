@@ -0,0 +1,246 @@
+#include "dhcp_log.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LOG_RING_SIZE 1024          // Entradas del anillo (potencia de 2)
+#define LOG_ENTRY_TEXT 480          // Longitud máxima del texto de un mensaje
+#define LOG_BATCH_BYTES 65536       // Tamaño del lote que se escribe con un solo write()
+#define LOG_FLUSH_INTERVAL_MS 20    // Espera del escritor cuando el anillo está vacío
+
+// Entrada del anillo. 'sequence' indica de quién es el turno sobre la entrada
+// (cola MPSC acotada con números de secuencia por slot).
+typedef struct {
+    _Atomic size_t sequence;
+    time_t timestamp;
+    dhcp_log_level level;
+    char text[LOG_ENTRY_TEXT];
+} log_entry;
+
+static log_entry ring[LOG_RING_SIZE];
+static _Atomic size_t ring_head;  // Próxima posición a reservar (productores)
+static size_t ring_tail;          // Próxima posición a consumir (solo el escritor)
+
+static atomic_int min_level = DHCP_LOG_INFO;
+static atomic_int initialized = 0;
+static atomic_int running = 0;
+static atomic_ulong written_count;
+static atomic_ulong dropped_count;
+static atomic_ulong filtered_count;
+
+static int log_fd = -1;
+static pthread_t writer_thread;
+
+static const char* level_names[] = {"DEBUG", "INFO", "WARNING", "ERROR"};
+
+int dhcp_log_parse_level(const char* name, dhcp_log_level* level) {
+    for (int i = DHCP_LOG_DEBUG; i <= DHCP_LOG_ERROR; ++i) {
+        if (strcasecmp(name, level_names[i]) == 0) {
+            *level = (dhcp_log_level)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+void dhcp_log_set_level(dhcp_log_level level) {
+    atomic_store_explicit(&min_level, level, memory_order_relaxed);
+}
+
+dhcp_log_level dhcp_log_get_level(void) {
+    return (dhcp_log_level)atomic_load_explicit(&min_level, memory_order_relaxed);
+}
+
+void dhcp_vlog(dhcp_log_level level, const char* format, va_list args) {
+    if (!atomic_load_explicit(&initialized, memory_order_acquire)) {
+        return;
+    }
+    if ((int)level < atomic_load_explicit(&min_level, memory_order_relaxed)) {
+        atomic_fetch_add_explicit(&filtered_count, 1, memory_order_relaxed);
+        return;
+    }
+
+    // Reservar una entrada libre sin bloquear; si el anillo está lleno se descarta
+    size_t pos = atomic_load_explicit(&ring_head, memory_order_relaxed);
+    log_entry* entry;
+    for (;;) {
+        entry = &ring[pos & (LOG_RING_SIZE - 1)];
+        size_t sequence = atomic_load_explicit(&entry->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring_head, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            atomic_fetch_add_explicit(&dropped_count, 1, memory_order_relaxed);
+            return;
+        } else {
+            pos = atomic_load_explicit(&ring_head, memory_order_relaxed);
+        }
+    }
+
+    entry->timestamp = time(NULL);
+    entry->level = level;
+    vsnprintf(entry->text, LOG_ENTRY_TEXT, format, args);
+
+    // Publicar la entrada para el escritor
+    atomic_store_explicit(&entry->sequence, pos + 1, memory_order_release);
+}
+
+void dhcp_log(dhcp_log_level level, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    dhcp_vlog(level, format, args);
+    va_end(args);
+}
+
+// Escribe todo el buffer, reintentando escrituras parciales
+static void write_all(const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t n = write(log_fd, data, length);
+        if (n <= 0) {
+            return;
+        }
+        data += n;
+        length -= (size_t)n;
+    }
+}
+
+// Vacía las entradas publicadas en lotes. Retorna cuántas se escribieron.
+static size_t drain_ring(char* batch) {
+    static time_t cached_second = (time_t)-1;
+    static char cached_time[20];
+    static unsigned long reported_drops = 0;
+
+    size_t used = 0;
+    size_t drained = 0;
+
+    for (;;) {
+        log_entry* entry = &ring[ring_tail & (LOG_RING_SIZE - 1)];
+        size_t sequence = atomic_load_explicit(&entry->sequence, memory_order_acquire);
+        if (sequence != ring_tail + 1) {
+            break;  // No hay más entradas publicadas
+        }
+
+        // Formatear la fecha solo una vez por segundo
+        if (entry->timestamp != cached_second) {
+            struct tm time_info;
+            localtime_r(&entry->timestamp, &time_info);
+            strftime(cached_time, sizeof(cached_time), "%Y-%m-%d %H:%M:%S", &time_info);
+            cached_second = entry->timestamp;
+        }
+
+        if (used + LOG_ENTRY_TEXT + 64 > LOG_BATCH_BYTES) {
+            write_all(batch, used);
+            used = 0;
+        }
+        int n = snprintf(batch + used, LOG_BATCH_BYTES - used, "[%s] %s: %s\n",
+                         cached_time, level_names[entry->level], entry->text);
+        if (n > 0) {
+            used += (size_t)n;  // Siempre cabe: se reservó espacio para una entrada completa
+        }
+
+        // Devolver la entrada a los productores
+        atomic_store_explicit(&entry->sequence, ring_tail + LOG_RING_SIZE, memory_order_release);
+        ring_tail++;
+        drained++;
+    }
+
+    // Dejar constancia en el archivo de los mensajes perdidos por anillo lleno
+    unsigned long drops = atomic_load_explicit(&dropped_count, memory_order_relaxed);
+    if (drops != reported_drops) {
+        int n = snprintf(batch + used, LOG_BATCH_BYTES - used,
+                         "[%s] WARNING: %lu mensajes de log descartados por buffer lleno\n",
+                         cached_second == (time_t)-1 ? "-" : cached_time, drops - reported_drops);
+        if (n > 0 && (size_t)n < LOG_BATCH_BYTES - used) {
+            used += (size_t)n;
+        }
+        reported_drops = drops;
+    }
+
+    if (used > 0) {
+        write_all(batch, used);
+    }
+    atomic_fetch_add_explicit(&written_count, drained, memory_order_relaxed);
+    return drained;
+}
+
+static void* writer_loop(void* arg) {
+    (void)arg;
+    char* batch = malloc(LOG_BATCH_BYTES);
+    if (batch == NULL) {
+        return NULL;
+    }
+
+    struct timespec pause = {0, LOG_FLUSH_INTERVAL_MS * 1000000L};
+    while (atomic_load_explicit(&running, memory_order_acquire)) {
+        if (drain_ring(batch) == 0) {
+            nanosleep(&pause, NULL);
+        }
+    }
+    drain_ring(batch);  // Últimos mensajes antes de cerrar
+
+    free(batch);
+    return NULL;
+}
+
+int dhcp_log_init(const char* path, int truncate) {
+    if (atomic_load(&initialized)) {
+        return 0;
+    }
+
+    int flags = O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC | (truncate ? O_TRUNC : 0);
+    log_fd = open(path, flags, 0644);
+    if (log_fd < 0) {
+        perror("No se pudo abrir el archivo de log");
+        return -1;
+    }
+
+    for (size_t i = 0; i < LOG_RING_SIZE; ++i) {
+        atomic_init(&ring[i].sequence, i);
+    }
+    atomic_store(&ring_head, 0);
+    ring_tail = 0;
+
+    const char* env_level = getenv("DHCP_LOG_LEVEL");
+    dhcp_log_level level;
+    if (env_level != NULL && dhcp_log_parse_level(env_level, &level) == 0) {
+        dhcp_log_set_level(level);
+    }
+
+    atomic_store(&running, 1);
+    if (pthread_create(&writer_thread, NULL, writer_loop, NULL) != 0) {
+        perror("No se pudo crear el hilo escritor de logs");
+        close(log_fd);
+        log_fd = -1;
+        return -1;
+    }
+    atomic_store_explicit(&initialized, 1, memory_order_release);
+    atexit(dhcp_log_shutdown);
+    return 0;
+}
+
+void dhcp_log_shutdown(void) {
+    if (!atomic_exchange(&initialized, 0)) {
+        return;
+    }
+    atomic_store_explicit(&running, 0, memory_order_release);
+    pthread_join(writer_thread, NULL);
+    close(log_fd);
+    log_fd = -1;
+}
+
+void dhcp_log_get_stats(dhcp_log_stats* stats) {
+    stats->written = atomic_load_explicit(&written_count, memory_order_relaxed);
+    stats->dropped = atomic_load_explicit(&dropped_count, memory_order_relaxed);
+    stats->filtered = atomic_load_explicit(&filtered_count, memory_order_relaxed);
+}
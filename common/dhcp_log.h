@@ -0,0 +1,44 @@
+#ifndef DHCP_LOG_H
+#define DHCP_LOG_H
+
+#include <stdarg.h>
+
+// Subsistema de logs compartido por servidor, relay y clientes.
+// Los hilos que registran solo copian el mensaje a un anillo sin bloqueo;
+// un único hilo escritor formatea la fecha y escribe en lotes con un fd
+// abierto durante toda la ejecución.
+
+typedef enum {
+    DHCP_LOG_DEBUG = 0,
+    DHCP_LOG_INFO,
+    DHCP_LOG_WARNING,
+    DHCP_LOG_ERROR
+} dhcp_log_level;
+
+typedef struct {
+    unsigned long written;  // Mensajes escritos en el archivo
+    unsigned long dropped;  // Mensajes descartados porque el anillo estaba lleno
+    unsigned long filtered; // Mensajes descartados por debajo del nivel mínimo
+} dhcp_log_stats;
+
+// Abre el archivo (truncándolo si 'truncate' != 0) y arranca el hilo escritor.
+// El nivel mínimo inicial se toma de la variable de entorno DHCP_LOG_LEVEL.
+int dhcp_log_init(const char* path, int truncate);
+
+// Vacía los mensajes pendientes, detiene el escritor y cierra el archivo.
+// Se registra con atexit() en dhcp_log_init.
+void dhcp_log_shutdown(void);
+
+void dhcp_log_set_level(dhcp_log_level level);
+dhcp_log_level dhcp_log_get_level(void);
+
+// Convierte "DEBUG", "INFO", "WARNING" o "ERROR" en un nivel. Retorna -1 si no lo reconoce.
+int dhcp_log_parse_level(const char* name, dhcp_log_level* level);
+
+// Encola un mensaje con formato estilo printf. Nunca bloquea.
+void dhcp_log(dhcp_log_level level, const char* format, ...) __attribute__((format(printf, 2, 3)));
+void dhcp_vlog(dhcp_log_level level, const char* format, va_list args);
+
+void dhcp_log_get_stats(dhcp_log_stats* stats);
+
+#endif
@@ -0,0 +1,356 @@
+#include "dhcp_metrics.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define CACHE_LINE 64
+#define REQUEST_WAIT_MS 100     // Espera de la petición HTTP antes de responder en texto plano
+#define SEND_TIMEOUT_SECONDS 1  // Un lector que no lee no bloquea el hilo para siempre
+
+// Ranura de un hilo: contadores y, por cada histograma, sus cubetas y la
+// suma en ns. 'shared' marca la ranura común de los hilos que no cupieron.
+typedef struct {
+    int shared;
+    atomic_ulong values[];
+} metrics_slot;
+
+#define HISTOGRAM_VALUES (METRICS_LATENCY_BUCKETS + 1)
+
+static const metric_descriptor* counter_table;
+static const metric_descriptor* histogram_table;
+static unsigned int counter_count;
+static unsigned int histogram_count;
+static size_t slot_bytes;
+
+static pthread_mutex_t registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static metrics_slot* slots[METRICS_MAX_SLOTS];
+static atomic_uint slot_count;
+static metrics_slot* shared_slot;
+static _Thread_local metrics_slot* thread_slot;
+
+static struct {
+    metrics_collector function;
+    void* arg;
+} collectors[METRICS_MAX_COLLECTORS];
+static atomic_uint collector_count;
+
+static int listen_fd = -1;
+static char listen_path[sizeof(((struct sockaddr_un*)0)->sun_path)];
+
+static metrics_slot* allocate_slot(int shared) {
+    metrics_slot* slot = aligned_alloc(CACHE_LINE, slot_bytes);
+    if (slot != NULL) {
+        memset(slot, 0, slot_bytes);
+        slot->shared = shared;
+    }
+    return slot;
+}
+
+int metrics_init(const metric_descriptor* counters, unsigned int counters_size,
+                 const metric_descriptor* histograms, unsigned int histograms_size) {
+    size_t values = counters_size + (size_t)histograms_size * HISTOGRAM_VALUES;
+    size_t bytes = sizeof(metrics_slot) + values * sizeof(atomic_ulong);
+    // Tamaño múltiplo de la línea de caché: la ranura siguiente empieza en otra línea
+    slot_bytes = (bytes + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+    counter_table = counters;
+    histogram_table = histograms;
+    counter_count = counters_size;
+    histogram_count = histograms_size;
+    shared_slot = allocate_slot(1);
+    return shared_slot != NULL ? 0 : -1;
+}
+
+// Ranura del hilo; la primera vez se registra (única toma del mutex por hilo)
+static metrics_slot* current_slot(void) {
+    if (thread_slot != NULL || shared_slot == NULL) {
+        return thread_slot;
+    }
+    pthread_mutex_lock(&registry_mutex);
+    unsigned int count = atomic_load_explicit(&slot_count, memory_order_relaxed);
+    metrics_slot* slot = count < METRICS_MAX_SLOTS ? allocate_slot(0) : NULL;
+    if (slot != NULL) {
+        slots[count] = slot;
+        atomic_store_explicit(&slot_count, count + 1, memory_order_release);
+    } else {
+        slot = shared_slot;
+    }
+    pthread_mutex_unlock(&registry_mutex);
+    thread_slot = slot;
+    return slot;
+}
+
+static inline void bump(metrics_slot* slot, size_t index, unsigned long amount) {
+    if (slot->shared) {
+        atomic_fetch_add_explicit(&slot->values[index], amount, memory_order_relaxed);
+        return;
+    }
+    // Único escritor: no hace falta una suma atómica
+    unsigned long value = atomic_load_explicit(&slot->values[index], memory_order_relaxed);
+    atomic_store_explicit(&slot->values[index], value + amount, memory_order_relaxed);
+}
+
+void metrics_add(unsigned int counter, unsigned long amount) {
+    metrics_slot* slot = current_slot();
+    if (slot != NULL && counter < counter_count) {
+        bump(slot, counter, amount);
+    }
+}
+
+void metrics_set(unsigned int gauge, unsigned long value) {
+    metrics_slot* slot = current_slot();
+    if (slot != NULL && gauge < counter_count) {
+        atomic_store_explicit(&slot->values[gauge], value, memory_order_relaxed);
+    }
+}
+
+static inline unsigned int latency_bucket(uint64_t nanoseconds) {
+    uint64_t microseconds = nanoseconds / 1000;
+    unsigned int bucket = microseconds == 0 ? 0 : 64 - (unsigned int)__builtin_clzll(microseconds);
+    return bucket < METRICS_LATENCY_BUCKETS ? bucket : METRICS_LATENCY_BUCKETS - 1;
+}
+
+void metrics_observe(unsigned int histogram, uint64_t nanoseconds) {
+    metrics_slot* slot = current_slot();
+    if (slot == NULL || histogram >= histogram_count) {
+        return;
+    }
+    size_t base = counter_count + (size_t)histogram * HISTOGRAM_VALUES;
+    bump(slot, base + latency_bucket(nanoseconds), 1);
+    bump(slot, base + METRICS_LATENCY_BUCKETS, (unsigned long)nanoseconds);
+}
+
+static unsigned long sum_value(size_t index) {
+    unsigned long total = 0;
+    if (shared_slot == NULL) {
+        return 0;
+    }
+    unsigned int count = atomic_load_explicit(&slot_count, memory_order_acquire);
+    for (unsigned int i = 0; i < count; ++i) {
+        total += atomic_load_explicit(&slots[i]->values[index], memory_order_relaxed);
+    }
+    return total + atomic_load_explicit(&shared_slot->values[index], memory_order_relaxed);
+}
+
+unsigned long metrics_read_counter(unsigned int counter) {
+    return counter < counter_count ? sum_value(counter) : 0;
+}
+
+uint64_t metrics_read_histogram(unsigned int histogram, unsigned long buckets[METRICS_LATENCY_BUCKETS]) {
+    memset(buckets, 0, METRICS_LATENCY_BUCKETS * sizeof(unsigned long));
+    if (histogram >= histogram_count) {
+        return 0;
+    }
+    size_t base = counter_count + (size_t)histogram * HISTOGRAM_VALUES;
+    for (int bucket = 0; bucket < METRICS_LATENCY_BUCKETS; ++bucket) {
+        buckets[bucket] = sum_value(base + (size_t)bucket);
+    }
+    return sum_value(base + METRICS_LATENCY_BUCKETS);
+}
+
+int metrics_add_collector(metrics_collector collector, void* arg) {
+    pthread_mutex_lock(&registry_mutex);
+    unsigned int count = atomic_load_explicit(&collector_count, memory_order_relaxed);
+    if (count == METRICS_MAX_COLLECTORS) {
+        pthread_mutex_unlock(&registry_mutex);
+        return -1;
+    }
+    collectors[count].function = collector;
+    collectors[count].arg = arg;
+    atomic_store_explicit(&collector_count, count + 1, memory_order_release);
+    pthread_mutex_unlock(&registry_mutex);
+    return 0;
+}
+
+void metrics_write_header(FILE* out, const char* name, const char* help, const char* type) {
+    fprintf(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+void metrics_write_sample(FILE* out, const char* name, const char* labels, double value) {
+    if (labels != NULL) {
+        fprintf(out, "%s{%s} %.17g\n", name, labels, value);
+    } else {
+        fprintf(out, "%s %.17g\n", name, value);
+    }
+}
+
+// Cabecera solo cuando cambia el nombre respecto a la serie anterior publicada
+static void write_header_once(FILE* out, const char** previous, const metric_descriptor* metric, const char* type) {
+    if (*previous == NULL || strcmp(*previous, metric->name) != 0) {
+        metrics_write_header(out, metric->name, metric->help, type);
+    }
+    *previous = metric->name;
+}
+
+static void write_histogram(FILE* out, unsigned int index) {
+    const metric_descriptor* metric = &histogram_table[index];
+    unsigned long buckets[METRICS_LATENCY_BUCKETS];
+    uint64_t sum_ns = metrics_read_histogram(index, buckets);
+    const char* labels = metric->labels != NULL ? metric->labels : "";
+    const char* separator = metric->labels != NULL ? "," : "";
+
+    // Cubetas acumuladas; el límite de la cubeta i es 2^i microsegundos
+    unsigned long cumulative = 0;
+    for (int bucket = 0; bucket < METRICS_LATENCY_BUCKETS - 1; ++bucket) {
+        cumulative += buckets[bucket];
+        fprintf(out, "%s_bucket{%s%sle=\"%g\"} %lu\n", metric->name, labels, separator,
+                (double)(1ul << bucket) / 1e6, cumulative);
+    }
+    cumulative += buckets[METRICS_LATENCY_BUCKETS - 1];
+    fprintf(out, "%s_bucket{%s%sle=\"+Inf\"} %lu\n", metric->name, labels, separator, cumulative);
+    if (metric->labels != NULL) {
+        fprintf(out, "%s_sum{%s} %.9f\n%s_count{%s} %lu\n", metric->name, labels, sum_ns / 1e9, metric->name,
+                labels, cumulative);
+    } else {
+        fprintf(out, "%s_sum %.9f\n%s_count %lu\n", metric->name, sum_ns / 1e9, metric->name, cumulative);
+    }
+}
+
+void metrics_write(FILE* out) {
+    const char* previous = NULL;
+    for (unsigned int i = 0; i < counter_count; ++i) {
+        const metric_descriptor* metric = &counter_table[i];
+        if (metric->name == NULL) {
+            continue;
+        }
+        write_header_once(out, &previous, metric, metric->type == METRIC_GAUGE ? "gauge" : "counter");
+        if (metric->labels != NULL) {
+            fprintf(out, "%s{%s} %lu\n", metric->name, metric->labels, metrics_read_counter(i));
+        } else {
+            fprintf(out, "%s %lu\n", metric->name, metrics_read_counter(i));
+        }
+    }
+    previous = NULL;
+    for (unsigned int i = 0; i < histogram_count; ++i) {
+        if (histogram_table[i].name == NULL) {
+            continue;
+        }
+        write_header_once(out, &previous, &histogram_table[i], "histogram");
+        write_histogram(out, i);
+    }
+    unsigned int count = atomic_load_explicit(&collector_count, memory_order_acquire);
+    for (unsigned int i = 0; i < count; ++i) {
+        collectors[i].function(out, collectors[i].arg);
+    }
+}
+
+static int write_all(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = send(fd, data, length, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        data += written;
+        length -= (size_t)written;
+    }
+    return 0;
+}
+
+// Atiende una conexión: texto plano, o HTTP si el cliente envió una petición GET
+static void serve_client(int client) {
+    struct timeval timeout = {SEND_TIMEOUT_SECONDS, 0};
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    int http = 0;
+    struct pollfd descriptor = {client, POLLIN, 0};
+    if (poll(&descriptor, 1, REQUEST_WAIT_MS) > 0) {
+        char request[1024];
+        ssize_t received = recv(client, request, sizeof(request), 0);
+        http = received >= 4 && memcmp(request, "GET ", 4) == 0;
+    }
+
+    char* body = NULL;
+    size_t body_length = 0;
+    FILE* out = open_memstream(&body, &body_length);
+    if (out == NULL) {
+        return;
+    }
+    metrics_write(out);
+    fclose(out);
+
+    if (http) {
+        char header[256];
+        int length = snprintf(header, sizeof(header),
+                              "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                              "Content-Length: %zu\r\nConnection: close\r\n\r\n", body_length);
+        if (write_all(client, header, (size_t)length) != 0) {
+            free(body);
+            return;
+        }
+    }
+    write_all(client, body, body_length);
+    free(body);
+}
+
+static void* serve_loop(void* arg) {
+    (void)arg;
+    while (1) {
+        int client = accept(listen_fd, NULL, NULL);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            break;  // metrics_stop cerró el socket
+        }
+        serve_client(client);
+        close(client);
+    }
+    return NULL;
+}
+
+int metrics_start(const char* path) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(address.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    unlink(path);  // Socket de una ejecución anterior
+    if (bind(fd, (struct sockaddr*)&address, sizeof(address)) < 0 || listen(fd, 16) < 0) {
+        close(fd);
+        return -1;
+    }
+    listen_fd = fd;
+    strcpy(listen_path, path);
+
+    // El hilo no atiende señales: las recibe el hilo principal
+    sigset_t all, previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &previous);
+    pthread_t thread;
+    int result = pthread_create(&thread, NULL, serve_loop, NULL);
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    if (result != 0) {
+        metrics_stop();
+        return -1;
+    }
+    pthread_detach(thread);
+    return 0;
+}
+
+void metrics_stop(void) {
+    if (listen_fd < 0) {
+        return;
+    }
+    shutdown(listen_fd, SHUT_RDWR);  // Despierta al hilo bloqueado en accept
+    close(listen_fd);
+    listen_fd = -1;
+    unlink(listen_path);
+}
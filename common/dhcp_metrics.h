@@ -0,0 +1,73 @@
+#ifndef DHCP_METRICS_H
+#define DHCP_METRICS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Métricas en vivo compartidas por servidor y relay. Cada hilo que cuenta
+// algo recibe, la primera vez, su propia ranura de contadores e histogramas
+// alineada y rellenada a líneas de caché completas, así que dos hilos nunca
+// escriben en la misma línea. Cada ranura tiene un único escritor: sumar es
+// una lectura y una escritura relajadas, sin mutex ni instrucciones atómicas
+// con bloqueo. Al leer se suman las ranuras de todos los hilos.
+// metrics_write las escribe en el formato de texto de Prometheus y
+// metrics_start las sirve por un socket Unix.
+
+#define METRICS_MAX_SLOTS 1024      // Hilos con ranura propia (el resto comparte una con sumas atómicas)
+#define METRICS_LATENCY_BUCKETS 24  // Potencias de 2 en microsegundos (hasta ~8 s)
+#define METRICS_MAX_COLLECTORS 8
+
+typedef enum {
+    METRIC_COUNTER,
+    METRIC_GAUGE  // Cada hilo publica su último valor con metrics_set; al leer se suman
+} metric_type;
+
+// Descripción de un contador o histograma. Las series con el mismo nombre (y
+// distintas etiquetas) deben ir seguidas en la tabla. Una entrada sin nombre
+// no se publica (p. ej. un servidor no configurado).
+typedef struct {
+    const char* name;    // "dhcp_server_messages_received_total"
+    const char* labels;  // "type=\"DHCPDISCOVER\"" o NULL
+    const char* help;
+    metric_type type;    // Ignorado en los histogramas
+} metric_descriptor;
+
+// Fija las tablas (que deben seguir vivas) antes de crear los hilos que
+// cuentan. Sin llamarla, metrics_add, metrics_set y metrics_observe no hacen nada.
+int metrics_init(const metric_descriptor* counters, unsigned int counter_count,
+                 const metric_descriptor* histograms, unsigned int histogram_count);
+
+void metrics_add(unsigned int counter, unsigned long amount);
+void metrics_set(unsigned int gauge, unsigned long value);
+
+// Registra una duración. Cubeta i: menos de 2^i microsegundos (la última no tiene límite).
+void metrics_observe(unsigned int histogram, uint64_t nanoseconds);
+
+// Suma de todos los hilos (cada valor se lee de forma atómica)
+unsigned long metrics_read_counter(unsigned int counter);
+
+// Copia las cubetas sumadas de todos los hilos y retorna la suma de las duraciones en ns
+uint64_t metrics_read_histogram(unsigned int histogram, unsigned long buckets[METRICS_LATENCY_BUCKETS]);
+
+// Añade series calculadas en cada lectura (ocupación de un pool, profundidad
+// de una cola...). Corre en el hilo que sirve las métricas.
+typedef void (*metrics_collector)(FILE* out, void* arg);
+int metrics_add_collector(metrics_collector collector, void* arg);
+
+// Ayudas para los colectores: líneas # HELP / # TYPE y una muestra
+void metrics_write_header(FILE* out, const char* name, const char* help, const char* type);
+void metrics_write_sample(FILE* out, const char* name, const char* labels, double value);
+
+// Escribe todas las métricas en formato de texto de Prometheus
+void metrics_write(FILE* out);
+
+// Sirve las métricas en un socket Unix desde un hilo propio. Cada conexión
+// recibe el texto completo y se cierra; si envía una petición HTTP (por
+// ejemplo curl --unix-socket) la respuesta lleva cabeceras HTTP. Retorna -1
+// si no se pudo abrir el socket.
+int metrics_start(const char* path);
+
+// Cierra el socket y borra su archivo
+void metrics_stop(void);
+
+#endif
@@ -0,0 +1,101 @@
+#include "dhcp_subnet.h"
+
+#include <arpa/inet.h>
+#include <stdlib.h>
+#include <string.h>
+
+uint32_t dhcp_prefix_mask(uint32_t prefix_length) {
+    return prefix_length == 0 ? 0 : 0xffffffffu << (32 - prefix_length);
+}
+
+int dhcp_subnet_parse(const char* text, uint32_t* address, uint32_t* prefix_length) {
+    char buffer[INET_ADDRSTRLEN];
+    const char* slash = strchr(text, '/');
+    size_t length = slash ? (size_t)(slash - text) : strlen(text);
+    if (length == 0 || length >= sizeof(buffer)) {
+        return -1;
+    }
+    memcpy(buffer, text, length);
+    buffer[length] = '\0';
+
+    struct in_addr parsed;
+    if (inet_pton(AF_INET, buffer, &parsed) != 1) {
+        return -1;
+    }
+    *address = ntohl(parsed.s_addr);
+    *prefix_length = 32;
+    if (slash != NULL) {
+        char* end;
+        unsigned long prefix = strtoul(slash + 1, &end, 10);
+        if (slash[1] == '\0' || *end != '\0' || prefix > 32) {
+            return -1;
+        }
+        *prefix_length = (uint32_t)prefix;
+    }
+    return 0;
+}
+
+void dhcp_subnet_table_init(dhcp_subnet_table* table) {
+    memset(table, 0, sizeof(*table));
+}
+
+void dhcp_subnet_table_destroy(dhcp_subnet_table* table) {
+    free(table->entries);
+    memset(table, 0, sizeof(*table));
+}
+
+int dhcp_subnet_table_add(dhcp_subnet_table* table, uint32_t address, uint32_t prefix_length, uint32_t value) {
+    if (table->count == table->capacity) {
+        uint32_t capacity = table->capacity ? table->capacity * 2 : 16;
+        dhcp_subnet_entry* entries = realloc(table->entries, capacity * sizeof(dhcp_subnet_entry));
+        if (entries == NULL) {
+            return -1;
+        }
+        table->entries = entries;
+        table->capacity = capacity;
+    }
+    uint32_t mask = dhcp_prefix_mask(prefix_length);
+    dhcp_subnet_entry* entry = &table->entries[table->count++];
+    entry->first = address & mask;
+    entry->last = entry->first | ~mask;
+    entry->value = value;
+    return 0;
+}
+
+static int compare_entries(const void* left, const void* right) {
+    const dhcp_subnet_entry* a = left;
+    const dhcp_subnet_entry* b = right;
+    return (a->first > b->first) - (a->first < b->first);
+}
+
+int dhcp_subnet_table_build(dhcp_subnet_table* table) {
+    if (table->count > 1) {
+        qsort(table->entries, table->count, sizeof(dhcp_subnet_entry), compare_entries);
+    }
+    for (uint32_t i = 1; i < table->count; ++i) {
+        if (table->entries[i].first <= table->entries[i - 1].last) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int dhcp_subnet_lookup(const dhcp_subnet_table* table, uint32_t address, uint32_t* value) {
+    if (table->count == 0) {
+        return -1;
+    }
+    // Última subred cuyo inicio no supera la dirección. Sin saltos que
+    // dependan de la dirección: el compilador usa un cmov en cada paso.
+    const dhcp_subnet_entry* base = table->entries;
+    uint32_t remaining = table->count;
+    while (remaining > 1) {
+        uint32_t half = remaining / 2;
+        base = base[half].first <= address ? base + half : base;
+        remaining -= half;
+    }
+    if (address < base->first || address > base->last) {
+        return -1;
+    }
+    *value = base->value;
+    return 0;
+}
@@ -0,0 +1,44 @@
+#ifndef DHCP_SUBNET_H
+#define DHCP_SUBNET_H
+
+#include <stdint.h>
+
+// Tabla de subredes para elegir la que contiene una dirección: en el servidor
+// la del giaddr de la solicitud, en el relay la del origen del cliente. Cada
+// subred se guarda como el rango [red, broadcast] con un valor asociado. Los
+// rangos quedan ordenados y sin solaparse, así que la búsqueda es binaria
+// sobre un arreglo contiguo: unas 12 comparaciones con 4096 subredes y 17 con
+// 100000, sin depender de cuántos bits tenga cada prefijo.
+
+typedef struct {
+    uint32_t first;  // Dirección de red (orden de host)
+    uint32_t last;   // Dirección de broadcast
+    uint32_t value;
+} dhcp_subnet_entry;
+
+typedef struct {
+    dhcp_subnet_entry* entries;
+    uint32_t count;
+    uint32_t capacity;
+} dhcp_subnet_table;
+
+// Máscara de un prefijo de 0 a 32 bits (orden de host)
+uint32_t dhcp_prefix_mask(uint32_t prefix_length);
+
+// Convierte "a.b.c.d/n" en dirección (orden de host) y longitud de prefijo.
+// Sin "/n" se toma /32. Retorna -1 si el texto no es válido.
+int dhcp_subnet_parse(const char* text, uint32_t* address, uint32_t* prefix_length);
+
+void dhcp_subnet_table_init(dhcp_subnet_table* table);
+void dhcp_subnet_table_destroy(dhcp_subnet_table* table);
+
+// Añade la subred que contiene 'address' con el prefijo dado. Retorna -1 si no hay memoria.
+int dhcp_subnet_table_add(dhcp_subnet_table* table, uint32_t address, uint32_t prefix_length, uint32_t value);
+
+// Ordena la tabla tras añadir las subredes. Retorna -1 si dos subredes se solapan.
+int dhcp_subnet_table_build(dhcp_subnet_table* table);
+
+// Retorna 0 y escribe el valor de la subred que contiene 'address', o -1 si ninguna la contiene
+int dhcp_subnet_lookup(const dhcp_subnet_table* table, uint32_t address, uint32_t* value);
+
+#endif
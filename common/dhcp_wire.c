@@ -0,0 +1,254 @@
+#include "dhcp_wire.h"
+
+#include <stdio.h>
+#include <string.h>
+
+_Static_assert(sizeof(dhcp_header) == DHCP_HEADER_SIZE, "la cabecera DHCP debe medir 236 bytes");
+
+static const uint8_t magic_cookie[4] = {0x63, 0x82, 0x53, 0x63};
+
+uint32_t dhcp_read_u32(const uint8_t* data) {
+    return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+}
+
+static void write_u32(uint8_t* data, uint32_t value) {
+    data[0] = (uint8_t)(value >> 24);
+    data[1] = (uint8_t)(value >> 16);
+    data[2] = (uint8_t)(value >> 8);
+    data[3] = (uint8_t)value;
+}
+
+int dhcp_parse(const uint8_t* packet, size_t length, dhcp_packet_view* view) {
+    if (length < DHCP_OPTIONS_OFFSET || memcmp(packet + DHCP_HEADER_SIZE, magic_cookie, 4) != 0) {
+        return -1;
+    }
+
+    memset(view, 0, sizeof(*view));
+    view->packet = packet;
+    view->length = length;
+    view->op = packet[offsetof(dhcp_header, op)];
+    view->hlen = packet[offsetof(dhcp_header, hlen)];
+    view->flags = (uint16_t)((packet[offsetof(dhcp_header, flags)] << 8) | packet[offsetof(dhcp_header, flags) + 1]);
+    view->xid = dhcp_read_u32(packet + offsetof(dhcp_header, xid));
+    view->ciaddr = dhcp_read_u32(packet + offsetof(dhcp_header, ciaddr));
+    view->yiaddr = dhcp_read_u32(packet + offsetof(dhcp_header, yiaddr));
+    view->giaddr = dhcp_read_u32(packet + offsetof(dhcp_header, giaddr));
+    view->chaddr = packet + offsetof(dhcp_header, chaddr);
+    if (view->hlen > sizeof(((dhcp_header*)0)->chaddr)) {
+        return -1;
+    }
+
+    // Una sola pasada: validar cada TLV y anotar las opciones conocidas
+    const uint8_t* options = packet + DHCP_OPTIONS_OFFSET;
+    const uint8_t* cursor = options;
+    const uint8_t* end = packet + length;
+    while (cursor < end) {
+        uint8_t code = *cursor;
+        if (code == DHCP_OPT_PAD) {
+            cursor++;
+            continue;
+        }
+        if (code == DHCP_OPT_END) {
+            break;
+        }
+        size_t remaining = (size_t)(end - cursor);
+        if (remaining < 2 || remaining < 2u + cursor[1]) {
+            return -1;  // La opción se sale del datagrama
+        }
+        uint8_t option_length = cursor[1];
+        const uint8_t* data = cursor + 2;
+        switch (code) {
+            case DHCP_OPT_MESSAGE_TYPE:
+                if (option_length == 1) view->message_type = data[0];
+                break;
+            case DHCP_OPT_REQUESTED_IP:
+                if (option_length == 4) view->requested_ip = data;
+                break;
+            case DHCP_OPT_SERVER_ID:
+                if (option_length == 4) view->server_id = data;
+                break;
+            case DHCP_OPT_LEASE_TIME:
+                if (option_length == 4) view->lease_time = data;
+                break;
+            case DHCP_OPT_MESSAGE:
+                view->message = data;
+                view->message_length = option_length;
+                break;
+        }
+        cursor = data + option_length;
+    }
+
+    view->options = options;
+    view->options_length = (size_t)(cursor - options);
+    return 0;
+}
+
+void dhcp_option_iter_init(dhcp_option_iter* iter, const dhcp_packet_view* view) {
+    iter->cursor = view->options;
+    iter->end = view->options + view->options_length;
+}
+
+int dhcp_option_next(dhcp_option_iter* iter, uint8_t* code, uint8_t* length, const uint8_t** data) {
+    while (iter->cursor < iter->end && *iter->cursor == DHCP_OPT_PAD) {
+        iter->cursor++;
+    }
+    if (iter->cursor >= iter->end) {
+        return 0;
+    }
+    // dhcp_parse ya comprobó que cada opción cabe antes de la opción END
+    *code = iter->cursor[0];
+    *length = iter->cursor[1];
+    *data = iter->cursor + 2;
+    iter->cursor += 2 + iter->cursor[1];
+    return 1;
+}
+
+const uint8_t* dhcp_find_option(const dhcp_packet_view* view, uint8_t code, uint8_t* length) {
+    dhcp_option_iter iter;
+    uint8_t current;
+    const uint8_t* data;
+    dhcp_option_iter_init(&iter, view);
+    while (dhcp_option_next(&iter, &current, length, &data)) {
+        if (current == code) {
+            return data;
+        }
+    }
+    return NULL;
+}
+
+int dhcp_read_lease_info(const dhcp_packet_view* view, dhcp_lease_info* info) {
+    memset(info, 0, sizeof(*info));
+    info->address = view->yiaddr;
+    int found = 0;
+
+    dhcp_option_iter iter;
+    uint8_t code, length;
+    const uint8_t* data;
+    dhcp_option_iter_init(&iter, view);
+    while (dhcp_option_next(&iter, &code, &length, &data)) {
+        if (length < 4) {
+            continue;
+        }
+        // Router y DNS pueden traer varias direcciones: se usa la primera
+        switch (code) {
+            case DHCP_OPT_SUBNET_MASK: info->subnet_mask = dhcp_read_u32(data); found |= 1; break;
+            case DHCP_OPT_ROUTER:      info->router = dhcp_read_u32(data);      found |= 2; break;
+            case DHCP_OPT_DNS_SERVER:  info->dns_server = dhcp_read_u32(data);  found |= 4; break;
+            case DHCP_OPT_LEASE_TIME:  info->lease_time = dhcp_read_u32(data);  found |= 8; break;
+            case DHCP_OPT_SERVER_ID:   info->server_id = dhcp_read_u32(data);   break;
+        }
+    }
+    return info->address != 0 && found == 15 ? 0 : -1;
+}
+
+// Cabecera común de solicitudes y respuestas: ceros, magic cookie y opción 53
+static int init_message(dhcp_builder* builder, uint8_t* buffer, size_t capacity, uint8_t op, uint8_t message_type) {
+    builder->buffer = buffer;
+    builder->capacity = capacity;
+    builder->length = 0;
+    builder->overflow = 0;
+    if (capacity < DHCP_OPTIONS_OFFSET) {
+        builder->overflow = 1;
+        return -1;
+    }
+
+    memset(buffer, 0, DHCP_OPTIONS_OFFSET);
+    buffer[offsetof(dhcp_header, op)] = op;
+    buffer[offsetof(dhcp_header, htype)] = DHCP_HTYPE_ETHERNET;
+    buffer[offsetof(dhcp_header, hlen)] = DHCP_HLEN_ETHERNET;
+    memcpy(buffer + DHCP_HEADER_SIZE, magic_cookie, 4);
+    builder->length = DHCP_OPTIONS_OFFSET;
+    dhcp_add_option(builder, DHCP_OPT_MESSAGE_TYPE, 1, &message_type);
+    return builder->overflow ? -1 : 0;
+}
+
+int dhcp_builder_init_request(dhcp_builder* builder, uint8_t* buffer, size_t capacity,
+                              uint8_t message_type, uint32_t xid, const uint8_t mac[6]) {
+    if (init_message(builder, buffer, capacity, BOOTREQUEST, message_type) != 0) {
+        return -1;
+    }
+    write_u32(buffer + offsetof(dhcp_header, xid), xid);
+    memcpy(buffer + offsetof(dhcp_header, chaddr), mac, DHCP_HLEN_ETHERNET);
+    return 0;
+}
+
+void dhcp_set_ciaddr(dhcp_builder* builder, uint32_t ciaddr) {
+    if (builder->length >= DHCP_OPTIONS_OFFSET) {
+        write_u32(builder->buffer + offsetof(dhcp_header, ciaddr), ciaddr);
+    }
+}
+
+int dhcp_builder_init_reply(dhcp_builder* builder, uint8_t* buffer, size_t capacity,
+                            const dhcp_packet_view* request, uint8_t message_type, uint32_t yiaddr) {
+    if (init_message(builder, buffer, capacity, BOOTREPLY, message_type) != 0) {
+        return -1;
+    }
+    // La respuesta conserva la transacción, el relay (giaddr) y el tipo de hardware del cliente
+    buffer[offsetof(dhcp_header, htype)] = request->packet[offsetof(dhcp_header, htype)];
+    buffer[offsetof(dhcp_header, hlen)] = request->hlen;
+    write_u32(buffer + offsetof(dhcp_header, xid), request->xid);
+    buffer[offsetof(dhcp_header, flags)] = (uint8_t)(request->flags >> 8);
+    buffer[offsetof(dhcp_header, flags) + 1] = (uint8_t)request->flags;
+    write_u32(buffer + offsetof(dhcp_header, yiaddr), yiaddr);
+    write_u32(buffer + offsetof(dhcp_header, giaddr), request->giaddr);
+    memcpy(buffer + offsetof(dhcp_header, chaddr), request->chaddr, sizeof(((dhcp_header*)0)->chaddr));
+    return 0;
+}
+
+void dhcp_add_option(dhcp_builder* builder, uint8_t code, uint8_t length, const void* data) {
+    // Reservar siempre un byte para la opción END
+    if (builder->overflow || builder->length + 2 + length + 1 > builder->capacity) {
+        builder->overflow = 1;
+        return;
+    }
+    uint8_t* cursor = builder->buffer + builder->length;
+    cursor[0] = code;
+    cursor[1] = length;
+    memcpy(cursor + 2, data, length);
+    builder->length += 2 + length;
+}
+
+void dhcp_add_option_u32(dhcp_builder* builder, uint8_t code, uint32_t value) {
+    uint8_t data[4];
+    write_u32(data, value);
+    dhcp_add_option(builder, code, sizeof(data), data);
+}
+
+size_t dhcp_finish(dhcp_builder* builder) {
+    if (builder->overflow || builder->length + 1 > builder->capacity) {
+        return 0;
+    }
+    builder->buffer[builder->length++] = DHCP_OPT_END;
+    if (builder->length < DHCP_MIN_PACKET_SIZE && builder->capacity >= DHCP_MIN_PACKET_SIZE) {
+        memset(builder->buffer + builder->length, 0, DHCP_MIN_PACKET_SIZE - builder->length);
+        builder->length = DHCP_MIN_PACKET_SIZE;
+    }
+    return builder->length;
+}
+
+const char* dhcp_message_name(uint8_t message_type) {
+    static const char* names[] = {
+        "DESCONOCIDO", "DHCPDISCOVER", "DHCPOFFER", "DHCPREQUEST", "DHCPDECLINE",
+        "DHCPACK", "DHCPNAK", "DHCPRELEASE", "DHCPINFORM"
+    };
+    return message_type < sizeof(names) / sizeof(names[0]) ? names[message_type] : names[0];
+}
+
+int dhcp_parse_mac(const char* text, uint8_t mac[6]) {
+    unsigned int bytes[6];
+    char extra;
+    if (sscanf(text, "%2x:%2x:%2x:%2x:%2x:%2x%c", &bytes[0], &bytes[1], &bytes[2],
+               &bytes[3], &bytes[4], &bytes[5], &extra) != 6) {
+        return -1;
+    }
+    for (int i = 0; i < 6; ++i) {
+        mac[i] = (uint8_t)bytes[i];
+    }
+    return 0;
+}
+
+const char* dhcp_mac_string(const uint8_t* chaddr, char* buffer) {
+    snprintf(buffer, 18, "%02x:%02x:%02x:%02x:%02x:%02x",
+             chaddr[0], chaddr[1], chaddr[2], chaddr[3], chaddr[4], chaddr[5]);
+    return buffer;
+}
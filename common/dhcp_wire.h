@@ -0,0 +1,178 @@
+#ifndef DHCP_WIRE_H
+#define DHCP_WIRE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Formato binario BOOTP/DHCP (RFC 2131 / RFC 2132) compartido por servidor,
+// relay y clientes: cabecera fija de 236 bytes, magic cookie y opciones TLV.
+// El parser no copia ni reserva memoria: la vista apunta al buffer recibido,
+// que debe seguir vivo mientras se use. El constructor escribe la respuesta
+// directamente en el buffer de envío.
+
+#define DHCP_HEADER_SIZE 236
+#define DHCP_MAGIC_COOKIE 0x63825363u
+#define DHCP_OPTIONS_OFFSET (DHCP_HEADER_SIZE + 4)  // Cabecera + magic cookie
+#define DHCP_MIN_PACKET_SIZE 300                   // Tamaño mínimo de un mensaje BOOTP
+#define DHCP_MAX_PACKET_SIZE 576                   // Máximo que todo cliente debe aceptar
+
+#define DHCP_SERVER_PORT 67
+#define DHCP_CLIENT_PORT 68
+
+// Campo op de la cabecera
+enum {
+    BOOTREQUEST = 1,
+    BOOTREPLY = 2
+};
+
+#define DHCP_HTYPE_ETHERNET 1
+#define DHCP_HLEN_ETHERNET 6
+#define DHCP_FLAG_BROADCAST 0x8000
+
+// Tipos de mensaje (opción 53)
+enum {
+    DHCPDISCOVER = 1,
+    DHCPOFFER = 2,
+    DHCPREQUEST = 3,
+    DHCPDECLINE = 4,
+    DHCPACK = 5,
+    DHCPNAK = 6,
+    DHCPRELEASE = 7,
+    DHCPINFORM = 8
+};
+
+// Códigos de opción usados por el proyecto
+enum {
+    DHCP_OPT_PAD = 0,
+    DHCP_OPT_SUBNET_MASK = 1,
+    DHCP_OPT_ROUTER = 3,
+    DHCP_OPT_DNS_SERVER = 6,
+    DHCP_OPT_REQUESTED_IP = 50,
+    DHCP_OPT_LEASE_TIME = 51,
+    DHCP_OPT_MESSAGE_TYPE = 53,
+    DHCP_OPT_SERVER_ID = 54,
+    DHCP_OPT_PARAMETER_LIST = 55,
+    DHCP_OPT_MESSAGE = 56,
+    DHCP_OPT_CLIENT_ID = 61,
+    DHCP_OPT_END = 255
+};
+
+// Cabecera fija tal como viaja por la red (enteros en orden de red).
+// Todos los campos quedan alineados a su tamaño, así que no hay relleno.
+typedef struct {
+    uint8_t op;
+    uint8_t htype;
+    uint8_t hlen;
+    uint8_t hops;
+    uint32_t xid;
+    uint16_t secs;
+    uint16_t flags;
+    uint32_t ciaddr;
+    uint32_t yiaddr;
+    uint32_t siaddr;
+    uint32_t giaddr;
+    uint8_t chaddr[16];
+    char sname[64];
+    char file[128];
+} dhcp_header;
+
+// Vista de un mensaje recibido. Los campos escalares se copian (orden de
+// host); chaddr y las opciones apuntan al buffer original. Las opciones
+// conocidas se localizan en la misma pasada de validación.
+typedef struct {
+    const uint8_t* packet;
+    size_t length;
+    const uint8_t* options;        // Primer byte tras la magic cookie
+    size_t options_length;         // Hasta la opción END (sin incluirla)
+    uint8_t op;
+    uint8_t hlen;
+    uint16_t flags;
+    uint32_t xid;                  // Orden de host (solo se compara y se devuelve)
+    uint32_t ciaddr;               // Orden de host
+    uint32_t yiaddr;               // Orden de host
+    uint32_t giaddr;               // Orden de host
+    const uint8_t* chaddr;         // 16 bytes; los primeros 'hlen' son la MAC
+    uint8_t message_type;          // 0 si falta la opción 53
+    const uint8_t* requested_ip;   // Opción 50 (4 bytes) o NULL
+    const uint8_t* server_id;      // Opción 54 (4 bytes) o NULL
+    const uint8_t* lease_time;     // Opción 51 (4 bytes) o NULL
+    const uint8_t* message;        // Opción 56 o NULL (sin terminador)
+    uint8_t message_length;
+} dhcp_packet_view;
+
+// Valida el mensaje y llena la vista. Retorna -1 si es demasiado corto, no
+// tiene la magic cookie o alguna opción se sale del buffer. Las opciones
+// sobrecargadas en sname/file (opción 52) no se interpretan.
+int dhcp_parse(const uint8_t* packet, size_t length, dhcp_packet_view* view);
+
+// Recorrido de las opciones de un mensaje ya validado por dhcp_parse
+typedef struct {
+    const uint8_t* cursor;
+    const uint8_t* end;
+} dhcp_option_iter;
+
+void dhcp_option_iter_init(dhcp_option_iter* iter, const dhcp_packet_view* view);
+
+// Avanza a la siguiente opción (se saltan los PAD). Retorna 1 y escribe el
+// código, la longitud y un puntero a los datos, o 0 al llegar al final.
+int dhcp_option_next(dhcp_option_iter* iter, uint8_t* code, uint8_t* length, const uint8_t** data);
+
+// Busca la primera aparición de 'code'. Retorna NULL si no está.
+const uint8_t* dhcp_find_option(const dhcp_packet_view* view, uint8_t code, uint8_t* length);
+
+// Lee un entero de 32 bits en orden de red desde una opción (sin alineación)
+uint32_t dhcp_read_u32(const uint8_t* data);
+
+// Configuración entregada en un DHCPOFFER o DHCPACK (direcciones en orden de host)
+typedef struct {
+    uint32_t address;      // yiaddr
+    uint32_t subnet_mask;
+    uint32_t router;
+    uint32_t dns_server;
+    uint32_t server_id;    // 0 si el servidor no envió la opción 54
+    uint32_t lease_time;   // Segundos
+} dhcp_lease_info;
+
+// Extrae la configuración de una respuesta. Retorna -1 si falta yiaddr, la
+// máscara, el router, el DNS o la duración del lease.
+int dhcp_read_lease_info(const dhcp_packet_view* view, dhcp_lease_info* info);
+
+// Constructor de mensajes sobre un buffer del llamador
+typedef struct {
+    uint8_t* buffer;
+    size_t capacity;
+    size_t length;
+    int overflow;  // Se activa si alguna opción no cupo; dhcp_finish retorna 0
+} dhcp_builder;
+
+// Empieza una solicitud de cliente (BOOTREQUEST) con la MAC en chaddr
+int dhcp_builder_init_request(dhcp_builder* builder, uint8_t* buffer, size_t capacity,
+                              uint8_t message_type, uint32_t xid, const uint8_t mac[6]);
+
+// Fija ciaddr (orden de host): IP actual del cliente en DHCPRELEASE y en renovaciones
+void dhcp_set_ciaddr(dhcp_builder* builder, uint32_t ciaddr);
+
+// Empieza la respuesta a 'request' (BOOTREPLY): copia xid, flags, giaddr y
+// chaddr, y fija yiaddr (orden de host, 0 en un NAK)
+int dhcp_builder_init_reply(dhcp_builder* builder, uint8_t* buffer, size_t capacity,
+                            const dhcp_packet_view* request, uint8_t message_type, uint32_t yiaddr);
+
+void dhcp_add_option(dhcp_builder* builder, uint8_t code, uint8_t length, const void* data);
+
+// Opción de 4 bytes (dirección IPv4 o segundos) a partir de un valor en orden de host
+void dhcp_add_option_u32(dhcp_builder* builder, uint8_t code, uint32_t value);
+
+// Añade END y rellena con ceros hasta DHCP_MIN_PACKET_SIZE. Retorna el tamaño
+// del mensaje o 0 si no cupo en el buffer.
+size_t dhcp_finish(dhcp_builder* builder);
+
+// Nombre del tipo de mensaje ("DHCPOFFER", ...) o "DESCONOCIDO"
+const char* dhcp_message_name(uint8_t message_type);
+
+// Convierte "aa:bb:cc:dd:ee:ff" a bytes. Retorna -1 si el formato no es válido.
+int dhcp_parse_mac(const char* text, uint8_t mac[6]);
+
+// Formatea los 6 primeros bytes de chaddr como "aa:bb:cc:dd:ee:ff" (buffer de 18 bytes)
+const char* dhcp_mac_string(const uint8_t* chaddr, char* buffer);
+
+#endif
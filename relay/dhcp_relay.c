@@ -6,146 +6,191 @@
 #include <signal.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
-#include <sys/socket.h>  // Inclusión necesaria para SO_REUSEPORT
-#include <time.h>
+
+#include "dhcp_log.h"
+#include "relay_forward.h"
+#include "relay_metrics.h"
+#include "relay_trace.h"
 
 #define SERVER_PORT 67
 #define CLIENT_PORT 68
-#define BUFFER_SIZE 1024
 #define RELAY_LOG_FILE "relay/dhcp_relay.log"
+#define RELAY_TRACE_FILE "relay/dhcp_relay.trace"
+#define DEFAULT_UPSTREAM "192.168.2.2"  // Servidor DHCP en la subred B si no se indica -s
+#define MAX_TRANSACTIONS 16384          // Intercambios simultáneos en curso
+#define DEFAULT_CLIENT_SUBNET "192.168.1.0/24"  // Subred de los clientes si no se indica -c
 
-// Funcion que escribe mensajes en el archivo de log
+// Funcion que escribe mensajes en el archivo de log (se encolan para el hilo escritor)
 void log_message(const char* level, const char* message) {
-    // Open the log file in append mode
-    FILE* log_file = fopen(RELAY_LOG_FILE, "a");
-    if (log_file == NULL) {
-        perror("No se pudo abrir el archivo de log del relay");
-        return;
-    }
+    dhcp_log_level log_level = DHCP_LOG_INFO;
+    dhcp_log_parse_level(level, &log_level);
+    dhcp_log(log_level, "%s", message);
+}
 
-    // Get the current time for the timestamp
-    time_t now = time(NULL);
-    struct tm* time_info = localtime(&now);
-    char time_str[20];  // Buffer to hold the time string
-    strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", time_info);
+// Banderas activadas por señales: SIGUSR1 pide el informe, SIGINT/SIGTERM detienen el bucle
+static volatile sig_atomic_t stats_requested = 0;
+static volatile sig_atomic_t stop_requested = 0;
 
-    // Write the log message with timestamp and level
-    fprintf(log_file, "[%s] %s: %s\n", time_str, level, message);
-    fclose(log_file);
+static void handle_sigusr1(int signum) {
+    (void)signum;
+    stats_requested = 1;
 }
 
-int main() {
-    FILE* log_file = fopen(RELAY_LOG_FILE, "w");
-    if (log_file != NULL) {
-        fclose(log_file);
+static void handle_shutdown(int signum) {
+    (void)signum;
+    stop_requested = 1;
+}
+
+static void print_usage(const char* program) {
+    printf("Uso: %s [-s servidor[:puerto]]... [-c IP/prefijo]... [-p puerto] [-L ninguno|binario|texto] [-t traza] [-M socket_métricas]\n", program);
+    printf("     %s -d traza   (muestra una traza binaria como texto)\n", program);
+}
+
+int main(int argc, char *argv[]) {
+    relay_context relay;
+    memset(&relay, 0, sizeof(relay));
+    relay.log_mode = RELAY_LOG_BINARY;
+    const char* trace_path = RELAY_TRACE_FILE;
+    long client_port = SERVER_PORT;  // -p: puerto donde escucha a los clientes
+    const char* metrics_path = NULL; // -M: socket Unix donde se publican las métricas
+    dhcp_subnet_table_init(&relay.client_subnets);
+
+    // Servidores DHCP: uno por cada -s, en cualquier orden. Subredes de
+    // clientes: una por cada -c con la IP del relay en ella, que pasa a ser el
+    // giaddr de sus solicitudes.
+    int opt;
+    uint32_t address, prefix_length;
+    while ((opt = getopt(argc, argv, "s:c:p:L:t:d:M:")) != -1) {
+        switch (opt) {
+            case 's':
+                if (upstream_add(&relay.upstreams, optarg) != 0) {
+                    printf("Servidor DHCP inválido: %s (se admiten hasta %d)\n", optarg, MAX_UPSTREAMS);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'c':
+                if (dhcp_subnet_parse(optarg, &address, &prefix_length) != 0 ||
+                    dhcp_subnet_table_add(&relay.client_subnets, address, prefix_length, address) != 0) {
+                    printf("Subred de clientes inválida: %s (se esperaba IP/prefijo)\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'p':
+                client_port = atol(optarg);
+                if (client_port < 1 || client_port > 65535) {
+                    printf("El puerto de los clientes debe estar entre 1 y 65535.\n");
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'L':
+                if (strcmp(optarg, "ninguno") == 0) {
+                    relay.log_mode = RELAY_LOG_NONE;
+                } else if (strcmp(optarg, "binario") == 0) {
+                    relay.log_mode = RELAY_LOG_BINARY;
+                } else if (strcmp(optarg, "texto") == 0) {
+                    relay.log_mode = RELAY_LOG_TEXT;
+                } else {
+                    print_usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 't':
+                trace_path = optarg;
+                break;
+            case 'M':
+                metrics_path = optarg;
+                break;
+            case 'd':
+                if (relay_trace_dump(optarg) != 0) {
+                    printf("No se pudo leer la traza %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                return EXIT_SUCCESS;
+            default:
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+        }
     }
-    int sockfd;
-    struct sockaddr_in relay_addr, client_addr, server_addr;
-    char buffer[BUFFER_SIZE];
-
-    // Crear socket UDP
-    if ((sockfd = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
-        perror("No se pudo crear el socket");
-        log_message("ERROR", "No se pudo crear el socket");
-        exit(EXIT_FAILURE);
+    if (relay.upstreams.count == 0) {
+        // Reemplaza con la IP del servidor DHCP en la subred B
+        upstream_add(&relay.upstreams, DEFAULT_UPSTREAM);
+    }
+    if (relay.client_subnets.count == 0) {
+        // Sin -c se atiende la subred A como antes, sin poner giaddr
+        dhcp_subnet_parse(DEFAULT_CLIENT_SUBNET, &address, &prefix_length);
+        dhcp_subnet_table_add(&relay.client_subnets, address, prefix_length, 0);
+    }
+    if (dhcp_subnet_table_build(&relay.client_subnets) != 0) {
+        printf("Las subredes de clientes (-c) no pueden solaparse.\n");
+        return EXIT_FAILURE;
     }
-    log_message("INFO", "Socket UDP creado");
-
-    // Habilitar reutilización de la dirección y puerto
-    int opt = 1;
-    if (setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR | SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
-        perror("No se pudo establecer opciones del socket");
-        log_message("ERROR", "No se pudo establecer opciones del socket");
-        close(sockfd);
+
+    dhcp_log_init(RELAY_LOG_FILE, 1);  // Truncar el log de la ejecución anterior
+    if (relay_metrics_init(&relay.upstreams) != 0) {
+        printf("No se pudieron crear los contadores de métricas.\n");
         exit(EXIT_FAILURE);
     }
-    log_message("INFO", "Opciones del socket establecidas");
-
-    // Configurar la dirección del relay (escuchar en todas las interfaces)
-    memset(&relay_addr, 0, sizeof(relay_addr));
-    relay_addr.sin_family = AF_INET;
-    relay_addr.sin_addr.s_addr = htonl(INADDR_ANY);
-    relay_addr.sin_port = htons(SERVER_PORT);
-
-    // Enlazar el socket al puerto 67
-    if (bind(sockfd, (struct sockaddr *)&relay_addr, sizeof(relay_addr)) < 0) {
-        perror("No se pudo enlazar el socket");
-        log_message("ERROR", "No se pudo enlazar el socket");
-        close(sockfd);
+    if (relay.log_mode == RELAY_LOG_BINARY && relay_trace_open(trace_path) != 0) {
+        perror("No se pudo abrir el archivo de traza");
+        log_message("ERROR", "No se pudo abrir el archivo de traza");
         exit(EXIT_FAILURE);
     }
-    log_message("INFO", "Socket enlazado al puerto 67");
-
-    // Configurar la dirección del servidor DHCP
-    memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;
-    // Reemplaza con la IP del servidor DHCP en la subred B
-    server_addr.sin_addr.s_addr = inet_addr("192.168.2.2");
-    server_addr.sin_port = htons(SERVER_PORT);
-
-    // Definir la dirección de red y la máscara de subred
-    uint32_t netmask = inet_addr("255.255.255.0");
-    uint32_t network_address = inet_addr("192.168.1.0");
-
-    printf("DHCP Relay iniciado y escuchando en el puerto %d...\n", SERVER_PORT);
-    log_message("INFO", "DHCP Relay iniciado y escuchando en el puerto 67");
-
-    while (1) {
-        socklen_t len = sizeof(client_addr);
-        int n = recvfrom(sockfd, buffer, BUFFER_SIZE, 0, (struct sockaddr *)&client_addr, &len);
-        if (n < 0) {
-            perror("Error al recibir datos");
-            log_message("ERROR", "Error al recibir datos");
-            continue;
-        }
 
-        // Comprobar si la dirección IP del cliente está dentro de la subred permitida
-        if ((client_addr.sin_addr.s_addr & netmask) != (network_address)) {
-            // El cliente no está en la subred permitida, ignorar el mensaje
-            log_message("WARNING", "Mensaje de cliente fuera de la subred permitida ignorado");
-            continue;
-        }
+    if (transaction_table_init(&relay.transactions, MAX_TRANSACTIONS) != 0) {
+        printf("No se pudo crear la tabla de transacciones.\n");
+        log_message("ERROR", "No se pudo crear la tabla de transacciones");
+        exit(EXIT_FAILURE);
+    }
 
-        // Mostrar mensaje recibido
-        buffer[n] = '\0';
-        char log_buffer[BUFFER_SIZE + 100];
-        snprintf(log_buffer, sizeof(log_buffer), "Mensaje recibido de %s:%d -- %s",
-                 inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port), buffer);
-        log_message("INFO", log_buffer);
-        printf("%s\n", log_buffer);
-
-        // Reenviar el mensaje al servidor DHCP
-        if (sendto(sockfd, buffer, n, 0, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
-            perror("Error al reenviar al servidor");
-            log_message("ERROR", "Error al reenviar al servidor");
-        } else {
-            snprintf(log_buffer, sizeof(log_buffer), "Mensaje reenviado al servidor DHCP %s:%d",
-                     inet_ntoa(server_addr.sin_addr), ntohs(server_addr.sin_port));
-            log_message("INFO", log_buffer);
-            printf("%s\n", log_buffer);
-        }
+    // Socket hacia los clientes en el puerto 67 o el de -p (escuchar en todas las interfaces)
+    relay.client_socket = relay_open_socket((uint16_t)client_port, 1);
+    if (relay.client_socket < 0) {
+        exit(EXIT_FAILURE);
+    }
+    dhcp_log(DHCP_LOG_INFO, "Socket enlazado al puerto %ld", client_port);
 
-        // Esperar respuesta del servidor DHCP
-        n = recvfrom(sockfd, buffer, BUFFER_SIZE, 0, NULL, NULL);
-        if (n < 0) {
-            perror("Error al recibir datos del servidor DHCP");
-            log_message("ERROR", "Error al recibir datos del servidor DHCP");
-            continue;
-        }
+    // Socket hacia los servidores con un puerto efímero
+    relay.server_socket = relay_open_socket(0, 0);
+    if (relay.server_socket < 0) {
+        close(relay.client_socket);
+        exit(EXIT_FAILURE);
+    }
+    log_message("INFO", "Socket UDP hacia los servidores creado");
 
-        // Reenviar la respuesta al cliente original
-        if (sendto(sockfd, buffer, n, 0, (struct sockaddr *)&client_addr, len) < 0) {
-            perror("Error al reenviar al cliente");
-            log_message("ERROR", "Error al reenviar al cliente");
-        } else {
-            snprintf(log_buffer, sizeof(log_buffer), "Respuesta reenviada al cliente %s:%d",
-                     inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port));
-            log_message("INFO", log_buffer);
-            printf("%s\n", log_buffer);
+    if (metrics_path != NULL) {
+        if (metrics_start(metrics_path) != 0) {
+            perror("No se pudo abrir el socket de métricas");
+            log_message("ERROR", "No se pudo abrir el socket de métricas");
+            exit(EXIT_FAILURE);
         }
+        printf("Métricas disponibles en el socket %s\n", metrics_path);
     }
 
-    close(sockfd);
+    // Señales sin SA_RESTART para que epoll_wait retorne y el bucle las atienda enseguida
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sigemptyset(&sa.sa_mask);
+    sa.sa_handler = handle_sigusr1;
+    sigaction(SIGUSR1, &sa, NULL);
+    sa.sa_handler = handle_shutdown;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    static const char* mode_names[] = {"ninguno", "binario", "texto"};
+    printf("DHCP Relay iniciado y escuchando en el puerto %ld (%d servidores, %u subredes, registro %s)...\n",
+           client_port, relay.upstreams.count, relay.client_subnets.count, mode_names[relay.log_mode]);
+    dhcp_log(DHCP_LOG_INFO, "DHCP Relay iniciado y escuchando en el puerto %ld", client_port);
+
+    relay_run(&relay, &stop_requested, &stats_requested);
+
+    relay_report(&relay);
+    metrics_stop();
+    relay_trace_close();
+    close(relay.server_socket);
+    close(relay.client_socket);
+    transaction_table_destroy(&relay.transactions);
+    dhcp_subnet_table_destroy(&relay.client_subnets);
     log_message("INFO", "Socket cerrado y programa terminado");
+    dhcp_log_shutdown();
     return 0;
 }
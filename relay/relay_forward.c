@@ -0,0 +1,438 @@
+#include "relay_forward.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>  // Inclusión necesaria para SO_REUSEPORT
+#include <time.h>
+#include <unistd.h>
+
+#include "dhcp_log.h"
+#include "dhcp_wire.h"
+#include "relay_metrics.h"
+#include "relay_trace.h"
+
+#define BUFFER_SIZE 1024
+#define MAX_EPOLL_WAIT_MS 1000
+#define SOCKET_BUFFER_BYTES (4 * 1024 * 1024)  // Absorbe ráfagas de miles de clientes
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+// Descarte de un paquete: siempre cuenta; en modo texto además deja la línea de siempre
+static void count_drop(const relay_context* relay, unsigned int counter, const char* message) {
+    metrics_add(counter, 1);
+    if (relay->log_mode == RELAY_LOG_TEXT) {
+        dhcp_log(DHCP_LOG_WARNING, "%s", message);
+    }
+}
+
+int relay_open_socket(uint16_t port, int reuse) {
+    int sockfd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    if (sockfd < 0) {
+        perror("No se pudo crear el socket");
+        dhcp_log(DHCP_LOG_ERROR, "No se pudo crear el socket");
+        return -1;
+    }
+
+    // Habilitar reutilización de la dirección y del puerto: cada opción es un
+    // nombre distinto de setsockopt y se activa con su propia llamada
+    int opt = 1;
+    if (reuse && setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+        perror("No se pudo activar SO_REUSEADDR");
+        dhcp_log(DHCP_LOG_ERROR, "No se pudo activar SO_REUSEADDR en el socket");
+        close(sockfd);
+        return -1;
+    }
+    if (reuse && setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+        perror("No se pudo activar SO_REUSEPORT");
+        dhcp_log(DHCP_LOG_ERROR, "No se pudo activar SO_REUSEPORT en el socket");
+        close(sockfd);
+        return -1;
+    }
+
+    // Un buffer de recepción amplio evita perder datagramas en ráfagas (el
+    // kernel lo limita a net.core.rmem_max; si falla se usa el valor por defecto)
+    int buffer_bytes = SOCKET_BUFFER_BYTES;
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &buffer_bytes, sizeof(buffer_bytes));
+
+    struct sockaddr_in relay_addr;
+    memset(&relay_addr, 0, sizeof(relay_addr));
+    relay_addr.sin_family = AF_INET;
+    relay_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    relay_addr.sin_port = htons(port);
+    if (bind(sockfd, (struct sockaddr *)&relay_addr, sizeof(relay_addr)) < 0) {
+        perror("No se pudo enlazar el socket");
+        dhcp_log(DHCP_LOG_ERROR, "No se pudo enlazar el socket");
+        close(sockfd);
+        return -1;
+    }
+    return sockfd;
+}
+
+// Envía la solicitud al servidor 'index' y anota el reenvío en la transacción (si la hay)
+static void send_to_upstream(relay_context* relay, relay_transaction* transaction, int index,
+                             const dhcp_packet_view* packet, relay_trace_event event) {
+    upstream_server* server = &relay->upstreams.servers[index];
+    if (sendto(relay->server_socket, packet->packet, packet->length, 0,
+               (struct sockaddr *)&server->addr, sizeof(server->addr)) < 0) {
+        metrics_add(RELAY_METRIC_SEND_ERRORS, 1);
+        perror("Error al reenviar al servidor");
+        dhcp_log(DHCP_LOG_ERROR, "Error al reenviar al servidor");
+    } else {
+        metrics_add(RELAY_METRIC_UPSTREAM_FORWARDED + (unsigned int)index, 1);
+        metrics_add(RELAY_METRIC_REQUESTS_FORWARDED, 1);
+        if (relay->log_mode == RELAY_LOG_BINARY) {
+            relay_trace_emit(event, packet->message_type, packet->xid, packet->chaddr, &server->addr, index,
+                             packet->length);
+        } else if (relay->log_mode == RELAY_LOG_TEXT) {
+            char log_buffer[BUFFER_SIZE];
+            snprintf(log_buffer, sizeof(log_buffer), "Mensaje reenviado al servidor DHCP %s:%d",
+                     inet_ntoa(server->addr.sin_addr), ntohs(server->addr.sin_port));
+            dhcp_log(DHCP_LOG_INFO, "%s", log_buffer);
+            printf("%s\n", log_buffer);
+        }
+    }
+    if (transaction == NULL) {
+        return;
+    }
+
+    uint64_t now = now_us();
+    transaction->upstream = (int8_t)index;
+    transaction->tried |= 1u << index;
+    transaction->sent_us = now;
+    transaction->awaiting_reply = 1;
+    // Sin copia de la solicitud no se puede pasar a otro servidor: se espera el plazo máximo
+    uint64_t timeout = transaction->request_length > 0 ? upstream_retry_timeout(server) : UPSTREAM_RETRY_MAX_US;
+    transaction_set_deadline(&relay->transactions, transaction, now + timeout);
+}
+
+// Servidor preferido para una solicitud: el que nombra la opción 54 (REQUEST
+// tras un OFFER, RELEASE, DECLINE) si es uno de los configurados; si no, el
+// que ya atiende la transacción; si no, el del hash consistente de la MAC
+static int choose_upstream(const relay_context* relay, const dhcp_packet_view* packet,
+                           const relay_transaction* transaction) {
+    uint64_t now = now_us();
+    if (packet->server_id != NULL) {
+        struct sockaddr_in server_id;
+        memset(&server_id, 0, sizeof(server_id));
+        server_id.sin_addr.s_addr = htonl(dhcp_read_u32(packet->server_id));
+        server_id.sin_port = htons(DHCP_SERVER_PORT);
+        int index = upstream_find(&relay->upstreams, &server_id);
+        if (index >= 0) {
+            return index;
+        }
+    }
+    if (transaction != NULL && transaction->upstream >= 0 &&
+        relay->upstreams.servers[transaction->upstream].ejected_until_us <= now) {
+        return transaction->upstream;
+    }
+    return upstream_select(&relay->upstreams, packet->chaddr, 0, now);
+}
+
+// Lee todas las solicitudes pendientes de los clientes y las reenvía a un servidor
+static void forward_client_requests(relay_context* relay) {
+    uint8_t buffer[BUFFER_SIZE];
+    struct sockaddr_in client_addr;
+
+    while (1) {
+        socklen_t len = sizeof(client_addr);
+        ssize_t n = recvfrom(relay->client_socket, buffer, BUFFER_SIZE, 0, (struct sockaddr *)&client_addr, &len);
+        if (n < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                perror("Error al recibir datos");
+                dhcp_log(DHCP_LOG_ERROR, "Error al recibir datos");
+            }
+            return;
+        }
+        metrics_add(RELAY_METRIC_REQUESTS_RECEIVED, 1);
+
+        // Comprobar si la dirección IP del cliente está dentro de una subred atendida
+        uint32_t giaddr;
+        if (dhcp_subnet_lookup(&relay->client_subnets, ntohl(client_addr.sin_addr.s_addr), &giaddr) != 0) {
+            count_drop(relay, RELAY_METRIC_OUTSIDE_SUBNET, "Mensaje de cliente fuera de la subred permitida ignorado");
+            continue;
+        }
+
+        // Validar el mensaje DHCP antes de reenviarlo
+        dhcp_packet_view packet;
+        if (dhcp_parse(buffer, (size_t)n, &packet) != 0 || packet.op != BOOTREQUEST) {
+            count_drop(relay, RELAY_METRIC_MALFORMED, "Mensaje DHCP mal formado ignorado");
+            continue;
+        }
+        if (packet.packet[offsetof(dhcp_header, hops)] >= RELAY_MAX_HOPS) {
+            count_drop(relay, RELAY_METRIC_TOO_MANY_HOPS, "Mensaje DHCP con demasiados saltos ignorado");
+            continue;
+        }
+        buffer[offsetof(dhcp_header, hops)]++;
+        if (packet.message_type < RELAY_MESSAGE_TYPES) {
+            metrics_add(RELAY_METRIC_REQUEST_TYPE + packet.message_type, 1);
+        }
+
+        // Si ningún relay anterior lo puso, el giaddr de la subred le indica al servidor de qué pool asignar
+        if (giaddr != 0 && packet.giaddr == 0) {
+            uint32_t value = htonl(giaddr);
+            memcpy(buffer + offsetof(dhcp_header, giaddr), &value, sizeof(value));
+            packet.giaddr = giaddr;
+        }
+
+        if (relay->log_mode == RELAY_LOG_TEXT) {
+            char mac[18];
+            char log_buffer[BUFFER_SIZE + 100];
+            snprintf(log_buffer, sizeof(log_buffer), "Mensaje recibido de %s:%d -- %s de %s (xid %08x)",
+                     inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port),
+                     dhcp_message_name(packet.message_type), dhcp_mac_string(packet.chaddr, mac), packet.xid);
+            dhcp_log(DHCP_LOG_INFO, "%s", log_buffer);
+            printf("%s\n", log_buffer);
+        }
+
+        // RELEASE y DECLINE no tienen respuesta: no abren transacción
+        if (packet.message_type == DHCPRELEASE || packet.message_type == DHCPDECLINE) {
+            int index = choose_upstream(relay, &packet, NULL);
+            if (index >= 0) {
+                send_to_upstream(relay, NULL, index, &packet, TRACE_REQUEST_FORWARDED);
+            }
+            continue;
+        }
+
+        int created;
+        relay_transaction* transaction = transaction_begin(&relay->transactions, packet.xid, packet.chaddr,
+                                                           &client_addr, &created);
+        if (transaction == NULL) {
+            count_drop(relay, RELAY_METRIC_TABLE_FULL, "Tabla de transacciones llena; solicitud descartada");
+            continue;
+        }
+        int index = choose_upstream(relay, &packet, created ? NULL : transaction);
+        if (index < 0) {
+            transaction_remove(&relay->transactions, transaction);
+            continue;
+        }
+
+        // Copia para pasar la solicitud a otro servidor si este no responde
+        transaction->tried = 0;
+        transaction->request_length = 0;
+        if ((size_t)n <= sizeof(transaction->request)) {
+            memcpy(transaction->request, buffer, (size_t)n);
+            transaction->request_length = (uint16_t)n;
+        }
+        send_to_upstream(relay, transaction, index, &packet, TRACE_REQUEST_FORWARDED);
+    }
+}
+
+// Lee todas las respuestas pendientes de los servidores y las devuelve al cliente de su transacción
+static void forward_server_replies(relay_context* relay) {
+    uint8_t buffer[BUFFER_SIZE];
+    struct sockaddr_in source;
+
+    while (1) {
+        socklen_t source_len = sizeof(source);
+        ssize_t n = recvfrom(relay->server_socket, buffer, BUFFER_SIZE, 0, (struct sockaddr *)&source, &source_len);
+        if (n < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                perror("Error al recibir datos del servidor DHCP");
+                dhcp_log(DHCP_LOG_ERROR, "Error al recibir datos del servidor DHCP");
+            }
+            return;
+        }
+
+        int index = upstream_find(&relay->upstreams, &source);
+        if (index < 0) {
+            count_drop(relay, RELAY_METRIC_UNKNOWN_SERVER, "Respuesta de un servidor DHCP no configurado ignorada");
+            continue;
+        }
+        dhcp_packet_view packet;
+        if (dhcp_parse(buffer, (size_t)n, &packet) != 0 || packet.op != BOOTREPLY) {
+            count_drop(relay, RELAY_METRIC_MALFORMED, "Respuesta DHCP mal formada ignorada");
+            continue;
+        }
+        relay_transaction* transaction = transaction_find(&relay->transactions, packet.xid, packet.chaddr);
+        if (transaction == NULL) {
+            count_drop(relay, RELAY_METRIC_ORPHAN_REPLIES, "Respuesta del servidor sin transacción en curso ignorada");
+            continue;
+        }
+
+        // El RTT solo se mide contra el último reenvío al mismo servidor
+        uint64_t now = now_us();
+        if (transaction->awaiting_reply && transaction->upstream == index) {
+            upstream_record_reply(&relay->upstreams.servers[index], now - transaction->sent_us);
+            metrics_observe(RELAY_METRIC_UPSTREAM_RTT + (unsigned int)index, (now - transaction->sent_us) * 1000);
+        }
+
+        // Reenviar la respuesta al cliente original (gana la primera que llegue)
+        struct sockaddr_in client_addr = transaction->client_addr;
+        if (sendto(relay->client_socket, buffer, (size_t)n, 0, (struct sockaddr *)&client_addr, sizeof(client_addr)) < 0) {
+            metrics_add(RELAY_METRIC_SEND_ERRORS, 1);
+            perror("Error al reenviar al cliente");
+            dhcp_log(DHCP_LOG_ERROR, "Error al reenviar al cliente");
+        } else {
+            metrics_add(RELAY_METRIC_REPLIES_FORWARDED, 1);
+            if (relay->log_mode == RELAY_LOG_BINARY) {
+                relay_trace_emit(TRACE_REPLY_FORWARDED, packet.message_type, packet.xid, packet.chaddr,
+                                 &client_addr, index, (size_t)n);
+            } else if (relay->log_mode == RELAY_LOG_TEXT) {
+                char log_buffer[BUFFER_SIZE];
+                snprintf(log_buffer, sizeof(log_buffer), "Respuesta reenviada al cliente %s:%d",
+                         inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port));
+                dhcp_log(DHCP_LOG_INFO, "%s", log_buffer);
+                printf("%s\n", log_buffer);
+            }
+        }
+
+        // Tras un OFFER el cliente seguirá con un REQUEST del mismo xid al
+        // servidor que lo ofreció; ACK y NAK cierran el intercambio
+        if (packet.message_type == DHCPOFFER) {
+            transaction->upstream = (int8_t)index;
+            transaction->awaiting_reply = 0;
+            transaction_set_deadline(&relay->transactions, transaction, now + RELAY_OFFER_HOLD_US);
+        } else {
+            transaction_remove(&relay->transactions, transaction);
+        }
+    }
+}
+
+// Atiende los plazos vencidos: pasa la solicitud al siguiente servidor del
+// hash o, si ya se probaron todos, abandona la transacción (el cliente la reintentará)
+static void handle_expired_transactions(relay_context* relay) {
+    uint32_t abandoned = 0;
+    uint64_t now = now_us();
+    relay_transaction* transaction;
+
+    while ((transaction = transaction_next_expired(&relay->transactions, now)) != NULL) {
+        if (!transaction->awaiting_reply) {
+            // El cliente no envió el REQUEST tras el OFFER
+            transaction_remove(&relay->transactions, transaction);
+            continue;
+        }
+
+        upstream_record_timeout(&relay->upstreams.servers[transaction->upstream], now);
+        // La copia ya pasó dhcp_parse al recibirla; se vuelve a leer para reenviarla
+        dhcp_packet_view packet = {0};
+        int next = -1;
+        if (transaction->request_length > 0 &&
+            dhcp_parse(transaction->request, transaction->request_length, &packet) == 0) {
+            next = upstream_select(&relay->upstreams, transaction->mac, transaction->tried, now);
+        }
+        if (next < 0) {
+            if (relay->log_mode == RELAY_LOG_BINARY) {
+                relay_trace_emit(TRACE_ABANDONED, 0, transaction->xid, transaction->mac,
+                                 &transaction->client_addr, transaction->upstream, transaction->request_length);
+            }
+            transaction_remove(&relay->transactions, transaction);
+            abandoned++;
+            continue;
+        }
+        metrics_add(RELAY_METRIC_FAILOVERS, 1);
+        send_to_upstream(relay, transaction, next, &packet, TRACE_FAILOVER);
+    }
+
+    // Una sola línea por ronda: no depende del número de paquetes
+    if (abandoned > 0) {
+        metrics_add(RELAY_METRIC_ABANDONED, abandoned);
+        dhcp_log(DHCP_LOG_WARNING, "%u transacciones sin respuesta de ningún servidor abandonadas (%u en curso)",
+                 abandoned, relay->transactions.count);
+    }
+}
+
+void relay_get_counters(relay_counters* counters) {
+    counters->requests_received = metrics_read_counter(RELAY_METRIC_REQUESTS_RECEIVED);
+    counters->requests_forwarded = metrics_read_counter(RELAY_METRIC_REQUESTS_FORWARDED);
+    counters->replies_forwarded = metrics_read_counter(RELAY_METRIC_REPLIES_FORWARDED);
+    counters->outside_subnet = metrics_read_counter(RELAY_METRIC_OUTSIDE_SUBNET);
+    counters->malformed = metrics_read_counter(RELAY_METRIC_MALFORMED);
+    counters->too_many_hops = metrics_read_counter(RELAY_METRIC_TOO_MANY_HOPS);
+    counters->table_full = metrics_read_counter(RELAY_METRIC_TABLE_FULL);
+    counters->unknown_server = metrics_read_counter(RELAY_METRIC_UNKNOWN_SERVER);
+    counters->orphan_replies = metrics_read_counter(RELAY_METRIC_ORPHAN_REPLIES);
+    counters->failovers = metrics_read_counter(RELAY_METRIC_FAILOVERS);
+    counters->abandoned = metrics_read_counter(RELAY_METRIC_ABANDONED);
+    counters->send_errors = metrics_read_counter(RELAY_METRIC_SEND_ERRORS);
+}
+
+void relay_report(const relay_context* relay) {
+    relay_counters counters;
+    relay_get_counters(&counters);
+    const relay_counters* c = &counters;
+    relay_trace_stats trace;
+    relay_trace_get_stats(&trace);
+
+    printf("Relay: %lu solicitudes recibidas, %lu reenviadas, %lu respuestas devueltas, %lu cambios de servidor, "
+           "%lu abandonadas, %u en curso\n",
+           c->requests_received, c->requests_forwarded, c->replies_forwarded, c->failovers, c->abandoned,
+           relay->transactions.count);
+    printf("Descartes: %lu fuera de subred, %lu mal formados, %lu con demasiados saltos, %lu por tabla llena, "
+           "%lu de servidores desconocidos, %lu sin transacción, %lu errores de envío\n",
+           c->outside_subnet, c->malformed, c->too_many_hops, c->table_full, c->unknown_server, c->orphan_replies,
+           c->send_errors);
+    printf("Traza: %lu registros escritos, %lu descartados\n", trace.written, trace.dropped);
+    dhcp_log(DHCP_LOG_INFO, "Relay: %lu solicitudes recibidas, %lu reenviadas, %lu respuestas devueltas, "
+             "%lu cambios de servidor, %lu abandonadas, %u en curso",
+             c->requests_received, c->requests_forwarded, c->replies_forwarded, c->failovers, c->abandoned,
+             relay->transactions.count);
+    dhcp_log(DHCP_LOG_INFO, "Descartes: %lu fuera de subred, %lu mal formados, %lu con demasiados saltos, "
+             "%lu por tabla llena, %lu de servidores desconocidos, %lu sin transacción, %lu errores de envío",
+             c->outside_subnet, c->malformed, c->too_many_hops, c->table_full, c->unknown_server, c->orphan_replies,
+             c->send_errors);
+    dhcp_log(DHCP_LOG_INFO, "Traza: %lu registros escritos, %lu descartados", trace.written, trace.dropped);
+    upstream_report(&relay->upstreams, now_us());
+}
+
+int relay_run(relay_context* relay, volatile sig_atomic_t* stop, volatile sig_atomic_t* report) {
+    int epoll_fd = epoll_create1(0);
+    if (epoll_fd < 0) {
+        perror("No se pudo crear la instancia de epoll");
+        dhcp_log(DHCP_LOG_ERROR, "No se pudo crear la instancia de epoll");
+        return -1;
+    }
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = relay->client_socket;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, relay->client_socket, &event);
+    event.data.fd = relay->server_socket;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, relay->server_socket, &event);
+
+    int result = 0;
+    while (!*stop) {
+        if (*report) {
+            *report = 0;
+            relay_report(relay);
+        }
+
+        // Despertar a tiempo para el próximo plazo de una transacción (redondeado hacia arriba)
+        int64_t wait_us = transaction_next_deadline(&relay->transactions, now_us());
+        int wait_ms = MAX_EPOLL_WAIT_MS;
+        if (wait_us >= 0 && wait_us < MAX_EPOLL_WAIT_MS * 1000ll) {
+            wait_ms = (int)((wait_us + 999) / 1000);
+        }
+
+        struct epoll_event events[2];
+        int ready = epoll_wait(epoll_fd, events, 2, wait_ms);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Error en epoll_wait");
+            dhcp_log(DHCP_LOG_ERROR, "Error en epoll_wait");
+            result = -1;
+            break;
+        }
+        for (int i = 0; i < ready; ++i) {
+            if (events[i].data.fd == relay->client_socket) {
+                forward_client_requests(relay);
+            } else {
+                forward_server_replies(relay);
+            }
+        }
+
+        handle_expired_transactions(relay);
+        metrics_set(RELAY_METRIC_IN_FLIGHT, relay->transactions.count);
+    }
+
+    close(epoll_fd);
+    return result;
+}
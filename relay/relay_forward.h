@@ -0,0 +1,69 @@
+#ifndef RELAY_FORWARD_H
+#define RELAY_FORWARD_H
+
+#include <signal.h>
+#include <stdint.h>
+
+#include "dhcp_subnet.h"
+#include "relay_transactions.h"
+#include "relay_upstreams.h"
+
+// Núcleo de reenvío del relay: un socket hacia los clientes y otro hacia los
+// servidores (puerto efímero, el servidor responde a la dirección de origen),
+// ambos no bloqueantes y atendidos por un único bucle epoll. El bucle no
+// formatea texto por paquete salvo en modo texto: cada reenvío solo suma
+// contadores y, en modo binario, deja un registro en la traza (relay_trace.h).
+
+#define RELAY_MAX_HOPS 16                      // Límite de relays encadenados (RFC 1542)
+#define RELAY_OFFER_HOLD_US (10 * 1000000ull)  // Espera del DHCPREQUEST tras un DHCPOFFER
+
+typedef enum {
+    RELAY_LOG_NONE,    // Solo contadores
+    RELAY_LOG_BINARY,  // Contadores y traza binaria en segundo plano
+    RELAY_LOG_TEXT     // Una línea por paquete en consola y en el log (comportamiento anterior)
+} relay_log_mode;
+
+// Copia de los contadores del bucle, que se llevan en las métricas por hilo
+// de relay_metrics.h (relay_metrics_init debe llamarse antes de relay_run)
+typedef struct {
+    unsigned long requests_received;   // Datagramas leídos del lado de los clientes
+    unsigned long requests_forwarded;  // Envíos a un servidor, incluidos los cambios de servidor
+    unsigned long replies_forwarded;   // Respuestas devueltas a un cliente
+    unsigned long outside_subnet;
+    unsigned long malformed;           // Solicitudes y respuestas que no pasan dhcp_parse
+    unsigned long too_many_hops;
+    unsigned long table_full;
+    unsigned long unknown_server;      // Respuestas de un origen no configurado
+    unsigned long orphan_replies;      // Respuestas sin transacción en curso
+    unsigned long failovers;
+    unsigned long abandoned;
+    unsigned long send_errors;
+} relay_counters;
+
+typedef struct {
+    int client_socket;
+    int server_socket;
+    upstream_set upstreams;
+    // Subredes de los clientes atendidos (búsqueda por la dirección de origen).
+    // El valor es el giaddr (orden de host) que se pone en sus solicitudes
+    // para que el servidor elija la subred, o 0 para no tocarlo.
+    dhcp_subnet_table client_subnets;
+    transaction_table transactions;
+    relay_log_mode log_mode;
+} relay_context;
+
+// Socket UDP no bloqueante enlazado a 'port' (0 = puerto efímero). Retorna -1 si falla.
+int relay_open_socket(uint16_t port, int reuse);
+
+// Atiende los sockets y los plazos hasta que '*stop' se active. Cuando
+// '*report' se activa escribe los contadores y el estado de los servidores.
+// Retorna -1 si epoll falla.
+int relay_run(relay_context* relay, volatile sig_atomic_t* stop, volatile sig_atomic_t* report);
+
+// Suma de los contadores desde el arranque (de todos los relay_context)
+void relay_get_counters(relay_counters* counters);
+
+// Escribe los contadores, las estadísticas de la traza y el estado de los servidores
+void relay_report(const relay_context* relay);
+
+#endif
@@ -0,0 +1,75 @@
+#include "relay_metrics.h"
+
+#include <arpa/inet.h>
+#include <stdio.h>
+
+static metric_descriptor counters[RELAY_COUNTER_COUNT];
+static metric_descriptor histograms[RELAY_HISTOGRAM_COUNT];
+
+static char type_labels[RELAY_MESSAGE_TYPES][32];
+static char server_labels[MAX_UPSTREAMS][48];  // server="IP:puerto"
+
+static void describe(metric_descriptor* metric, const char* name, const char* labels, const char* help,
+                     metric_type type) {
+    metric->name = name;
+    metric->labels = labels;
+    metric->help = help;
+    metric->type = type;
+}
+
+int relay_metrics_init(const upstream_set* upstreams) {
+    describe(&counters[RELAY_METRIC_REQUESTS_RECEIVED], "dhcp_relay_requests_received_total", NULL,
+             "Datagramas leídos del lado de los clientes.", METRIC_COUNTER);
+    describe(&counters[RELAY_METRIC_REQUESTS_FORWARDED], "dhcp_relay_requests_forwarded_total", NULL,
+             "Solicitudes enviadas a un servidor, incluidos los cambios de servidor.", METRIC_COUNTER);
+    describe(&counters[RELAY_METRIC_REPLIES_FORWARDED], "dhcp_relay_replies_forwarded_total", NULL,
+             "Respuestas devueltas a un cliente.", METRIC_COUNTER);
+
+    static const struct {
+        unsigned int id;
+        const char* reason;
+    } drops[] = {
+        {RELAY_METRIC_OUTSIDE_SUBNET, "reason=\"fuera_de_subred\""},
+        {RELAY_METRIC_MALFORMED, "reason=\"mal_formado\""},
+        {RELAY_METRIC_TOO_MANY_HOPS, "reason=\"demasiados_saltos\""},
+        {RELAY_METRIC_TABLE_FULL, "reason=\"tabla_llena\""},
+        {RELAY_METRIC_UNKNOWN_SERVER, "reason=\"servidor_desconocido\""},
+        {RELAY_METRIC_ORPHAN_REPLIES, "reason=\"sin_transaccion\""},
+        {RELAY_METRIC_SEND_ERRORS, "reason=\"error_de_envio\""},
+    };
+    for (size_t i = 0; i < sizeof(drops) / sizeof(drops[0]); ++i) {
+        describe(&counters[drops[i].id], "dhcp_relay_dropped_total", drops[i].reason,
+                 "Paquetes descartados por motivo.", METRIC_COUNTER);
+    }
+    describe(&counters[RELAY_METRIC_FAILOVERS], "dhcp_relay_failovers_total", NULL,
+             "Solicitudes pasadas a otro servidor tras agotar la espera.", METRIC_COUNTER);
+    describe(&counters[RELAY_METRIC_ABANDONED], "dhcp_relay_abandoned_total", NULL,
+             "Transacciones sin respuesta de ningún servidor.", METRIC_COUNTER);
+    describe(&counters[RELAY_METRIC_IN_FLIGHT], "dhcp_relay_transactions_in_flight", NULL,
+             "Transacciones en curso.", METRIC_GAUGE);
+
+    for (int type = 1; type < RELAY_MESSAGE_TYPES; ++type) {
+        snprintf(type_labels[type], sizeof(type_labels[type]), "type=\"%s\"", dhcp_message_name((uint8_t)type));
+        describe(&counters[RELAY_METRIC_REQUEST_TYPE + type], "dhcp_relay_requests_by_type_total", type_labels[type],
+                 "Solicitudes válidas de los clientes por tipo.", METRIC_COUNTER);
+    }
+
+    // Los servidores no configurados quedan sin nombre y no se publican
+    for (int i = 0; i < upstreams->count; ++i) {
+        const upstream_server* server = &upstreams->servers[i];
+        char address[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &server->addr.sin_addr, address, sizeof(address));
+        snprintf(server_labels[i], sizeof(server_labels[i]), "server=\"%s:%u\"", address, ntohs(server->addr.sin_port));
+        describe(&counters[RELAY_METRIC_UPSTREAM_FORWARDED + i], "dhcp_relay_upstream_forwarded_total",
+                 server_labels[i], "Solicitudes enviadas a cada servidor.", METRIC_COUNTER);
+        describe(&counters[RELAY_METRIC_UPSTREAM_REPLIES + i], "dhcp_relay_upstream_replies_total",
+                 server_labels[i], "Respuestas recibidas de cada servidor.", METRIC_COUNTER);
+        describe(&counters[RELAY_METRIC_UPSTREAM_TIMEOUTS + i], "dhcp_relay_upstream_timeouts_total",
+                 server_labels[i], "Esperas agotadas de cada servidor.", METRIC_COUNTER);
+        describe(&counters[RELAY_METRIC_UPSTREAM_EJECTIONS + i], "dhcp_relay_upstream_ejections_total",
+                 server_labels[i], "Veces que se apartó cada servidor.", METRIC_COUNTER);
+        describe(&histograms[RELAY_METRIC_UPSTREAM_RTT + i], "dhcp_relay_upstream_rtt_seconds",
+                 server_labels[i], "Tiempo entre el reenvío a un servidor y su respuesta.", METRIC_COUNTER);
+    }
+    return metrics_init(counters, RELAY_COUNTER_COUNT, histograms, RELAY_HISTOGRAM_COUNT);
+}
@@ -0,0 +1,45 @@
+#ifndef RELAY_METRICS_H
+#define RELAY_METRICS_H
+
+#include "dhcp_metrics.h"
+#include "dhcp_wire.h"
+#include "relay_upstreams.h"
+
+// Contadores e histogramas del relay (identificadores para metrics_add y
+// metrics_observe). Los de cada servidor se indexan con su posición en el
+// upstream_set y los de cada tipo de mensaje con el valor de la opción 53.
+
+#define RELAY_MESSAGE_TYPES (DHCPINFORM + 1)
+
+enum {
+    RELAY_METRIC_REQUESTS_RECEIVED = 0,  // Datagramas leídos del lado de los clientes
+    RELAY_METRIC_REQUESTS_FORWARDED,     // Envíos a un servidor, incluidos los cambios de servidor
+    RELAY_METRIC_REPLIES_FORWARDED,      // Respuestas devueltas a un cliente
+    RELAY_METRIC_OUTSIDE_SUBNET,
+    RELAY_METRIC_MALFORMED,              // Solicitudes y respuestas que no pasan dhcp_parse
+    RELAY_METRIC_TOO_MANY_HOPS,
+    RELAY_METRIC_TABLE_FULL,
+    RELAY_METRIC_UNKNOWN_SERVER,         // Respuestas de un origen no configurado
+    RELAY_METRIC_ORPHAN_REPLIES,         // Respuestas sin transacción en curso
+    RELAY_METRIC_SEND_ERRORS,
+    RELAY_METRIC_FAILOVERS,
+    RELAY_METRIC_ABANDONED,
+    RELAY_METRIC_IN_FLIGHT,              // Gauge: transacciones en curso
+    RELAY_METRIC_REQUEST_TYPE,           // Por tipo: solicitudes válidas de los clientes
+    RELAY_METRIC_UPSTREAM_FORWARDED = RELAY_METRIC_REQUEST_TYPE + RELAY_MESSAGE_TYPES,  // Por servidor
+    RELAY_METRIC_UPSTREAM_REPLIES = RELAY_METRIC_UPSTREAM_FORWARDED + MAX_UPSTREAMS,
+    RELAY_METRIC_UPSTREAM_TIMEOUTS = RELAY_METRIC_UPSTREAM_REPLIES + MAX_UPSTREAMS,
+    RELAY_METRIC_UPSTREAM_EJECTIONS = RELAY_METRIC_UPSTREAM_TIMEOUTS + MAX_UPSTREAMS,
+    RELAY_COUNTER_COUNT = RELAY_METRIC_UPSTREAM_EJECTIONS + MAX_UPSTREAMS
+};
+
+enum {
+    RELAY_METRIC_UPSTREAM_RTT = 0,  // Por servidor: tiempo hasta su respuesta
+    RELAY_HISTOGRAM_COUNT = RELAY_METRIC_UPSTREAM_RTT + MAX_UPSTREAMS
+};
+
+// Registra las tablas del relay en dhcp_metrics, con una etiqueta por cada
+// servidor configurado (antes de crear los hilos que cuentan)
+int relay_metrics_init(const upstream_set* upstreams);
+
+#endif
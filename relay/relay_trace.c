@@ -0,0 +1,177 @@
+#include "relay_trace.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "dhcp_wire.h"
+
+#define TRACE_RING_SIZE 8192          // Registros del anillo (potencia de 2)
+#define TRACE_BATCH_RECORDS 1024      // Registros por write()
+#define TRACE_FLUSH_INTERVAL_MS 20    // Espera del escritor cuando el anillo está vacío
+
+_Static_assert(sizeof(relay_trace_record) == 32, "el registro de traza debe medir 32 bytes");
+_Static_assert(sizeof(relay_trace_header) == 16, "la cabecera de traza debe medir 16 bytes");
+
+// Anillo de un productor y un consumidor: cada lado solo escribe su índice
+static relay_trace_record ring[TRACE_RING_SIZE];
+static _Atomic size_t ring_head;   // Próximo registro a escribir (bucle del relay)
+static _Atomic size_t ring_tail;   // Próximo registro a volcar (escritor)
+
+static atomic_int running = 0;
+static atomic_ulong written_count;
+static atomic_ulong dropped_count;
+static int trace_fd = -1;
+static pthread_t writer_thread;
+
+void relay_trace_emit(relay_trace_event event, uint8_t message_type, uint32_t xid, const uint8_t* mac,
+                      const struct sockaddr_in* peer, int upstream, size_t length) {
+    if (trace_fd < 0) {
+        return;
+    }
+    size_t head = atomic_load_explicit(&ring_head, memory_order_relaxed);
+    if (head - atomic_load_explicit(&ring_tail, memory_order_acquire) >= TRACE_RING_SIZE) {
+        atomic_fetch_add_explicit(&dropped_count, 1, memory_order_relaxed);
+        return;
+    }
+
+    relay_trace_record* record = &ring[head & (TRACE_RING_SIZE - 1)];
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    record->timestamp_us = (uint64_t)now.tv_sec * 1000000u + (uint64_t)now.tv_nsec / 1000u;
+    record->xid = xid;
+    record->peer_ip = peer ? peer->sin_addr.s_addr : 0;
+    record->peer_port = peer ? peer->sin_port : 0;
+    record->length = (uint16_t)length;
+    memcpy(record->mac, mac, sizeof(record->mac));
+    record->event = (uint8_t)event;
+    record->message_type = message_type;
+    record->upstream = (int8_t)upstream;
+    memset(record->reserved, 0, sizeof(record->reserved));
+
+    atomic_store_explicit(&ring_head, head + 1, memory_order_release);
+}
+
+// Escribe todo el buffer, reintentando escrituras parciales
+static void write_all(const void* data, size_t length) {
+    const char* cursor = data;
+    while (length > 0) {
+        ssize_t n = write(trace_fd, cursor, length);
+        if (n <= 0) {
+            return;
+        }
+        cursor += n;
+        length -= (size_t)n;
+    }
+}
+
+// Vuelca los registros publicados; los tramos contiguos del anillo se escriben directamente
+static size_t drain_ring(void) {
+    size_t tail = atomic_load_explicit(&ring_tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring_head, memory_order_acquire);
+    size_t drained = 0;
+
+    while (tail != head) {
+        size_t start = tail & (TRACE_RING_SIZE - 1);
+        size_t count = head - tail;
+        if (count > TRACE_RING_SIZE - start) {
+            count = TRACE_RING_SIZE - start;
+        }
+        if (count > TRACE_BATCH_RECORDS) {
+            count = TRACE_BATCH_RECORDS;
+        }
+        write_all(&ring[start], count * sizeof(relay_trace_record));
+        tail += count;
+        drained += count;
+        // Devolver los registros al productor
+        atomic_store_explicit(&ring_tail, tail, memory_order_release);
+    }
+    atomic_fetch_add_explicit(&written_count, drained, memory_order_relaxed);
+    return drained;
+}
+
+static void* writer_loop(void* arg) {
+    (void)arg;
+    struct timespec pause = {0, TRACE_FLUSH_INTERVAL_MS * 1000000L};
+    while (atomic_load_explicit(&running, memory_order_acquire)) {
+        if (drain_ring() == 0) {
+            nanosleep(&pause, NULL);
+        }
+    }
+    drain_ring();  // Últimos registros antes de cerrar
+    return NULL;
+}
+
+int relay_trace_open(const char* path) {
+    trace_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (trace_fd < 0) {
+        return -1;
+    }
+    relay_trace_header header = {RELAY_TRACE_MAGIC, RELAY_TRACE_VERSION, sizeof(relay_trace_record), 0};
+    write_all(&header, sizeof(header));
+
+    atomic_store(&ring_head, 0);
+    atomic_store(&ring_tail, 0);
+    atomic_store(&written_count, 0);
+    atomic_store(&dropped_count, 0);
+    atomic_store(&running, 1);
+    if (pthread_create(&writer_thread, NULL, writer_loop, NULL) != 0) {
+        close(trace_fd);
+        trace_fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+void relay_trace_close(void) {
+    if (trace_fd < 0) {
+        return;
+    }
+    atomic_store_explicit(&running, 0, memory_order_release);
+    pthread_join(writer_thread, NULL);
+    close(trace_fd);
+    trace_fd = -1;
+}
+
+void relay_trace_get_stats(relay_trace_stats* stats) {
+    stats->written = atomic_load_explicit(&written_count, memory_order_relaxed);
+    stats->dropped = atomic_load_explicit(&dropped_count, memory_order_relaxed);
+}
+
+int relay_trace_dump(const char* path) {
+    static const char* event_names[] = {"?", "SOLICITUD", "RESPUESTA", "CAMBIO_SERVIDOR", "ABANDONADA"};
+
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        return -1;
+    }
+    relay_trace_header header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != RELAY_TRACE_MAGIC ||
+        header.version != RELAY_TRACE_VERSION || header.record_size != sizeof(relay_trace_record)) {
+        fclose(file);
+        return -1;
+    }
+
+    relay_trace_record record;
+    while (fread(&record, sizeof(record), 1, file) == 1) {
+        time_t seconds = (time_t)(record.timestamp_us / 1000000u);
+        struct tm time_info;
+        char timestamp[20], mac[18], peer[INET_ADDRSTRLEN];
+        localtime_r(&seconds, &time_info);
+        strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", &time_info);
+        inet_ntop(AF_INET, &record.peer_ip, peer, sizeof(peer));
+        printf("%s.%06u %-15s %-12s xid %08x MAC %s %s:%u servidor %d %u bytes\n",
+               timestamp, (unsigned int)(record.timestamp_us % 1000000u),
+               record.event < sizeof(event_names) / sizeof(event_names[0]) ? event_names[record.event] : "?",
+               dhcp_message_name(record.message_type), record.xid, dhcp_mac_string(record.mac, mac),
+               peer, ntohs(record.peer_port), record.upstream, record.length);
+    }
+    fclose(file);
+    return 0;
+}
@@ -0,0 +1,64 @@
+#ifndef RELAY_TRACE_H
+#define RELAY_TRACE_H
+
+#include <netinet/in.h>
+#include <stdint.h>
+
+// Traza binaria del relay: un registro de 32 bytes por paquete reenviado, sin
+// formatear texto en el bucle de reenvío. El bucle solo copia el registro a
+// un anillo (un único productor) y un hilo escritor lo vuelca en lotes al
+// archivo. Si el anillo se llena el registro se descarta y se cuenta.
+// El archivo empieza con una cabecera de 16 bytes; "relay -d <archivo>" lo
+// muestra como texto.
+
+#define RELAY_TRACE_MAGIC 0x52544452u  // "RDTR"
+#define RELAY_TRACE_VERSION 1
+
+typedef enum {
+    TRACE_REQUEST_FORWARDED = 1,   // Solicitud de un cliente reenviada a un servidor
+    TRACE_REPLY_FORWARDED = 2,     // Respuesta de un servidor devuelta al cliente
+    TRACE_FAILOVER = 3,            // Solicitud reenviada a otro servidor por falta de respuesta
+    TRACE_ABANDONED = 4            // Ningún servidor respondió
+} relay_trace_event;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+    uint64_t reserved;
+} relay_trace_header;
+
+typedef struct {
+    uint64_t timestamp_us;  // Tiempo real (microsegundos desde epoch)
+    uint32_t xid;
+    uint32_t peer_ip;       // Cliente o servidor, orden de red
+    uint16_t peer_port;     // Orden de red
+    uint16_t length;        // Bytes del mensaje
+    uint8_t mac[6];
+    uint8_t event;          // relay_trace_event
+    uint8_t message_type;
+    int8_t upstream;        // Índice del servidor, -1 si no aplica
+    uint8_t reserved[3];
+} relay_trace_record;
+
+typedef struct {
+    unsigned long written;
+    unsigned long dropped;
+} relay_trace_stats;
+
+// Abre (truncando) el archivo de traza y arranca el hilo escritor
+int relay_trace_open(const char* path);
+
+// Vacía los registros pendientes, detiene el escritor y cierra el archivo
+void relay_trace_close(void);
+
+// Encola un registro. Nunca bloquea; solo puede llamarlo un hilo.
+void relay_trace_emit(relay_trace_event event, uint8_t message_type, uint32_t xid, const uint8_t* mac,
+                      const struct sockaddr_in* peer, int upstream, size_t length);
+
+void relay_trace_get_stats(relay_trace_stats* stats);
+
+// Imprime un archivo de traza como texto. Retorna -1 si no se puede leer o no es una traza.
+int relay_trace_dump(const char* path);
+
+#endif
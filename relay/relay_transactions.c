@@ -0,0 +1,175 @@
+#include "relay_transactions.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define NO_ENTRY (-1)
+
+static uint32_t transaction_hash(uint32_t xid, const uint8_t mac[6]) {
+    uint32_t low = (uint32_t)mac[2] << 24 | (uint32_t)mac[3] << 16 | (uint32_t)mac[4] << 8 | mac[5];
+    uint32_t hash = xid ^ low ^ ((uint32_t)mac[0] << 8 | mac[1]);
+    hash ^= hash >> 16;
+    hash *= 0x7feb352du;
+    hash ^= hash >> 15;
+    return hash;
+}
+
+int transaction_table_init(transaction_table* table, uint32_t capacity) {
+    memset(table, 0, sizeof(*table));
+    uint32_t buckets = 1;
+    while (buckets < capacity) {
+        buckets <<= 1;
+    }
+    table->entries = calloc(capacity, sizeof(relay_transaction));
+    table->buckets = malloc(buckets * sizeof(int32_t));
+    if (table->entries == NULL || table->buckets == NULL) {
+        transaction_table_destroy(table);
+        return -1;
+    }
+    for (uint32_t i = 0; i < buckets; ++i) {
+        table->buckets[i] = NO_ENTRY;
+    }
+    for (uint32_t i = 0; i < capacity; ++i) {
+        table->entries[i].next = i + 1 < capacity ? (int32_t)(i + 1) : NO_ENTRY;
+    }
+    table->capacity = capacity;
+    table->bucket_mask = buckets - 1;
+    table->free_head = capacity > 0 ? 0 : NO_ENTRY;
+    table->earliest = NO_ENTRY;
+    table->latest = NO_ENTRY;
+    return 0;
+}
+
+void transaction_table_destroy(transaction_table* table) {
+    free(table->entries);
+    free(table->buckets);
+    table->entries = NULL;
+    table->buckets = NULL;
+}
+
+static int32_t index_of(const transaction_table* table, const relay_transaction* transaction) {
+    return (int32_t)(transaction - table->entries);
+}
+
+static void unlink_deadline(transaction_table* table, relay_transaction* transaction) {
+    if (transaction->earlier != NO_ENTRY) {
+        table->entries[transaction->earlier].later = transaction->later;
+    } else {
+        table->earliest = transaction->later;
+    }
+    if (transaction->later != NO_ENTRY) {
+        table->entries[transaction->later].earlier = transaction->earlier;
+    } else {
+        table->latest = transaction->earlier;
+    }
+}
+
+// Inserta en orden de plazo buscando desde el final de la lista
+static void link_deadline(transaction_table* table, relay_transaction* transaction) {
+    int32_t index = index_of(table, transaction);
+    int32_t before = table->latest;
+    while (before != NO_ENTRY && table->entries[before].deadline_us > transaction->deadline_us) {
+        before = table->entries[before].earlier;
+    }
+
+    transaction->earlier = before;
+    if (before != NO_ENTRY) {
+        transaction->later = table->entries[before].later;
+        table->entries[before].later = index;
+    } else {
+        transaction->later = table->earliest;
+        table->earliest = index;
+    }
+    if (transaction->later != NO_ENTRY) {
+        table->entries[transaction->later].earlier = index;
+    } else {
+        table->latest = index;
+    }
+}
+
+relay_transaction* transaction_find(transaction_table* table, uint32_t xid, const uint8_t mac[6]) {
+    int32_t index = table->buckets[transaction_hash(xid, mac) & table->bucket_mask];
+    while (index != NO_ENTRY) {
+        relay_transaction* transaction = &table->entries[index];
+        if (transaction->xid == xid && memcmp(transaction->mac, mac, sizeof(transaction->mac)) == 0) {
+            return transaction;
+        }
+        index = transaction->next;
+    }
+    return NULL;
+}
+
+relay_transaction* transaction_begin(transaction_table* table, uint32_t xid, const uint8_t mac[6],
+                                     const struct sockaddr_in* client_addr, int* created) {
+    relay_transaction* transaction = transaction_find(table, xid, mac);
+    if (transaction != NULL) {
+        // La respuesta va a la dirección más reciente del cliente
+        transaction->client_addr = *client_addr;
+        *created = 0;
+        return transaction;
+    }
+    if (table->free_head == NO_ENTRY) {
+        return NULL;
+    }
+
+    int32_t index = table->free_head;
+    transaction = &table->entries[index];
+    table->free_head = transaction->next;
+
+    uint32_t bucket = transaction_hash(xid, mac) & table->bucket_mask;
+    transaction->xid = xid;
+    memcpy(transaction->mac, mac, sizeof(transaction->mac));
+    transaction->in_use = 1;
+    transaction->awaiting_reply = 1;
+    transaction->client_addr = *client_addr;
+    transaction->sent_us = 0;
+    transaction->upstream = -1;
+    transaction->tried = 0;
+    transaction->request_length = 0;
+    transaction->next = table->buckets[bucket];
+    table->buckets[bucket] = index;
+    // Sin plazo hasta que el llamador lo fije: va al final de la lista
+    transaction->deadline_us = UINT64_MAX;
+    link_deadline(table, transaction);
+    table->count++;
+    *created = 1;
+    return transaction;
+}
+
+void transaction_set_deadline(transaction_table* table, relay_transaction* transaction, uint64_t deadline_us) {
+    unlink_deadline(table, transaction);
+    transaction->deadline_us = deadline_us;
+    link_deadline(table, transaction);
+}
+
+void transaction_remove(transaction_table* table, relay_transaction* transaction) {
+    int32_t index = index_of(table, transaction);
+    int32_t* link = &table->buckets[transaction_hash(transaction->xid, transaction->mac) & table->bucket_mask];
+    while (*link != NO_ENTRY && *link != index) {
+        link = &table->entries[*link].next;
+    }
+    if (*link == index) {
+        *link = transaction->next;
+    }
+    unlink_deadline(table, transaction);
+
+    transaction->in_use = 0;
+    transaction->next = table->free_head;
+    table->free_head = index;
+    table->count--;
+}
+
+relay_transaction* transaction_next_expired(transaction_table* table, uint64_t now_us) {
+    if (table->earliest == NO_ENTRY || table->entries[table->earliest].deadline_us > now_us) {
+        return NULL;
+    }
+    return &table->entries[table->earliest];
+}
+
+int64_t transaction_next_deadline(const transaction_table* table, uint64_t now_us) {
+    if (table->earliest == NO_ENTRY) {
+        return -1;
+    }
+    uint64_t deadline = table->entries[table->earliest].deadline_us;
+    return deadline > now_us ? (int64_t)(deadline - now_us) : 0;
+}
@@ -0,0 +1,73 @@
+#ifndef RELAY_TRANSACTIONS_H
+#define RELAY_TRANSACTIONS_H
+
+#include <netinet/in.h>
+#include <stdint.h>
+
+#include "dhcp_wire.h"
+
+// Tabla de transacciones en curso del relay. Cada solicitud reenviada al
+// servidor deja una entrada con clave (xid, MAC) y la dirección del cliente,
+// para devolverle la respuesta cuando llegue por el socket del lado del
+// servidor, junto con una copia de la solicitud para reenviarla a otro
+// servidor si el elegido no responde a tiempo. Las entradas viven en un
+// arreglo preasignado con encadenamiento por índices; además forman una
+// lista ordenada por plazo. Los plazos nuevos casi siempre son los más
+// lejanos, así que la inserción recorre la lista desde el final y en la
+// práctica cuesta O(1); los plazos vencidos se atienden desde la cabeza.
+
+typedef struct {
+    uint32_t xid;
+    uint8_t mac[6];
+    uint8_t in_use;
+    uint8_t awaiting_reply;          // 1 mientras se espera al servidor; 0 tras un DHCPOFFER
+    struct sockaddr_in client_addr;  // A quién devolver la respuesta
+    uint64_t deadline_us;            // Reloj monotónico en microsegundos
+    uint64_t sent_us;                // Último reenvío (para medir el RTT)
+    int8_t upstream;                 // Servidor del último reenvío o del que respondió
+    uint32_t tried;                  // Servidores ya probados en este intento (bit i = servidor i)
+    uint16_t request_length;         // 0 si la solicitud no cabía en la copia
+    uint8_t request[DHCP_MAX_PACKET_SIZE];
+    int32_t next;                    // Siguiente en el bucket (o en la lista libre)
+    int32_t earlier;                 // Lista por plazo
+    int32_t later;
+} relay_transaction;
+
+typedef struct {
+    relay_transaction* entries;
+    int32_t* buckets;
+    uint32_t capacity;
+    uint32_t bucket_mask;
+    int32_t free_head;
+    int32_t earliest;     // Próximo plazo en vencer
+    int32_t latest;
+    uint32_t count;
+} transaction_table;
+
+// Reserva la tabla para 'capacity' transacciones simultáneas. Retorna -1 si no hay memoria.
+int transaction_table_init(transaction_table* table, uint32_t capacity);
+void transaction_table_destroy(transaction_table* table);
+
+// Busca la transacción de (xid, MAC). Retorna NULL si no existe.
+relay_transaction* transaction_find(transaction_table* table, uint32_t xid, const uint8_t mac[6]);
+
+// Registra la transacción de (xid, MAC) o, si ya existía (retransmisión del
+// cliente o DHCPREQUEST tras un DHCPOFFER), la devuelve con la dirección del
+// cliente actualizada. '*created' indica cuál de los dos casos fue. El
+// llamador fija el plazo con transaction_set_deadline. Retorna NULL si la tabla está llena.
+relay_transaction* transaction_begin(transaction_table* table, uint32_t xid, const uint8_t mac[6],
+                                     const struct sockaddr_in* client_addr, int* created);
+
+// Fija (o cambia) el plazo de una transacción
+void transaction_set_deadline(transaction_table* table, relay_transaction* transaction, uint64_t deadline_us);
+
+void transaction_remove(transaction_table* table, relay_transaction* transaction);
+
+// Transacción con el plazo más próximo si ya venció en 'now_us', o NULL. El
+// llamador debe fijarle un plazo nuevo o quitarla antes de volver a llamar.
+relay_transaction* transaction_next_expired(transaction_table* table, uint64_t now_us);
+
+// Microsegundos hasta el próximo plazo (-1 si la tabla está vacía)
+int64_t transaction_next_deadline(const transaction_table* table, uint64_t now_us);
+
+#endif
@@ -0,0 +1,150 @@
+#include "relay_upstreams.h"
+
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dhcp_log.h"
+#include "relay_metrics.h"
+
+// Mezcla de 64 bits (splitmix64) para el hash rendezvous
+static uint64_t mix64(uint64_t value) {
+    value += 0x9e3779b97f4a7c15ull;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+    return value ^ (value >> 31);
+}
+
+int upstream_add(upstream_set* set, const char* spec) {
+    if (set->count >= MAX_UPSTREAMS) {
+        return -1;
+    }
+    char address[INET_ADDRSTRLEN];
+    unsigned int port = 67;
+    const char* colon = strchr(spec, ':');
+    size_t length = colon ? (size_t)(colon - spec) : strlen(spec);
+    if (length == 0 || length >= sizeof(address)) {
+        return -1;
+    }
+    memcpy(address, spec, length);
+    address[length] = '\0';
+    if (colon != NULL) {
+        char* end;
+        unsigned long parsed = strtoul(colon + 1, &end, 10);
+        if (*end != '\0' || parsed == 0 || parsed > 65535) {
+            return -1;
+        }
+        port = (unsigned int)parsed;
+    }
+
+    upstream_server* server = &set->servers[set->count];
+    memset(server, 0, sizeof(*server));
+    server->addr.sin_family = AF_INET;
+    server->addr.sin_port = htons((uint16_t)port);
+    if (inet_pton(AF_INET, address, &server->addr.sin_addr) != 1) {
+        return -1;
+    }
+    server->hash_seed = (uint32_t)mix64(((uint64_t)ntohl(server->addr.sin_addr.s_addr) << 16) | port);
+    server->index = set->count;
+    set->count++;
+    return 0;
+}
+
+int upstream_find(const upstream_set* set, const struct sockaddr_in* addr) {
+    for (int i = 0; i < set->count; ++i) {
+        if (set->servers[i].addr.sin_addr.s_addr == addr->sin_addr.s_addr &&
+            set->servers[i].addr.sin_port == addr->sin_port) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int upstream_select(const upstream_set* set, const uint8_t mac[6], uint32_t tried, uint64_t now_us) {
+    uint64_t key = 0;
+    for (int i = 0; i < 6; ++i) {
+        key = (key << 8) | mac[i];
+    }
+
+    int best = -1, best_ejected = -1;
+    uint64_t best_score = 0, best_ejected_score = 0;
+    for (int i = 0; i < set->count; ++i) {
+        if (tried & (1u << i)) {
+            continue;
+        }
+        const upstream_server* server = &set->servers[i];
+        uint64_t score = mix64(key ^ ((uint64_t)server->hash_seed << 32));
+        if (server->ejected_until_us > now_us) {
+            if (best_ejected < 0 || score > best_ejected_score) {
+                best_ejected = i;
+                best_ejected_score = score;
+            }
+        } else if (best < 0 || score > best_score) {
+            best = i;
+            best_score = score;
+        }
+    }
+    return best >= 0 ? best : best_ejected;
+}
+
+uint64_t upstream_retry_timeout(const upstream_server* server) {
+    if (server->rtt_ewma_us == 0) {
+        return UPSTREAM_RETRY_DEFAULT_US;
+    }
+    uint64_t timeout = server->rtt_ewma_us * 4;
+    if (timeout < UPSTREAM_RETRY_MIN_US) {
+        return UPSTREAM_RETRY_MIN_US;
+    }
+    return timeout > UPSTREAM_RETRY_MAX_US ? UPSTREAM_RETRY_MAX_US : timeout;
+}
+
+void upstream_record_reply(upstream_server* server, uint64_t rtt_us) {
+    metrics_add(RELAY_METRIC_UPSTREAM_REPLIES + (unsigned int)server->index, 1);
+    // EWMA con peso 1/8 para la muestra nueva (como el SRTT de TCP)
+    server->rtt_ewma_us = server->rtt_ewma_us == 0 ? rtt_us : (server->rtt_ewma_us * 7 + rtt_us) / 8;
+    if (server->ejected_until_us != 0 || server->consecutive_timeouts >= UPSTREAM_EJECT_AFTER) {
+        char address[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &server->addr.sin_addr, address, sizeof(address));
+        printf("Servidor DHCP %s vuelve a responder\n", address);
+        dhcp_log(DHCP_LOG_INFO, "Servidor DHCP %s vuelve a responder", address);
+    }
+    server->consecutive_timeouts = 0;
+    server->ejected_until_us = 0;
+}
+
+int upstream_record_timeout(upstream_server* server, uint64_t now_us) {
+    metrics_add(RELAY_METRIC_UPSTREAM_TIMEOUTS + (unsigned int)server->index, 1);
+    server->consecutive_timeouts++;
+    // Un servidor apartado que vuelve a fallar al probarlo se aparta de nuevo
+    if (server->consecutive_timeouts < UPSTREAM_EJECT_AFTER || server->ejected_until_us > now_us) {
+        return 0;
+    }
+    server->ejected_until_us = now_us + UPSTREAM_EJECT_US;
+    metrics_add(RELAY_METRIC_UPSTREAM_EJECTIONS + (unsigned int)server->index, 1);
+
+    char address[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &server->addr.sin_addr, address, sizeof(address));
+    printf("Servidor DHCP %s apartado tras %u esperas agotadas seguidas\n", address, server->consecutive_timeouts);
+    dhcp_log(DHCP_LOG_WARNING, "Servidor DHCP %s apartado tras %u esperas agotadas seguidas",
+             address, server->consecutive_timeouts);
+    return 1;
+}
+
+void upstream_report(const upstream_set* set, uint64_t now_us) {
+    for (int i = 0; i < set->count; ++i) {
+        const upstream_server* server = &set->servers[i];
+        char address[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &server->addr.sin_addr, address, sizeof(address));
+        unsigned long forwarded = metrics_read_counter(RELAY_METRIC_UPSTREAM_FORWARDED + (unsigned int)i);
+        unsigned long replies = metrics_read_counter(RELAY_METRIC_UPSTREAM_REPLIES + (unsigned int)i);
+        unsigned long timeouts = metrics_read_counter(RELAY_METRIC_UPSTREAM_TIMEOUTS + (unsigned int)i);
+        unsigned long ejections = metrics_read_counter(RELAY_METRIC_UPSTREAM_EJECTIONS + (unsigned int)i);
+        printf("Servidor %s:%d %s: RTT %.2f ms, %lu reenviados, %lu respuestas, %lu esperas agotadas, apartado %lu veces\n",
+               address, ntohs(server->addr.sin_port), server->ejected_until_us > now_us ? "apartado" : "disponible",
+               server->rtt_ewma_us / 1000.0, forwarded, replies, timeouts, ejections);
+        dhcp_log(DHCP_LOG_INFO, "Servidor %s:%d %s: RTT %.2f ms, %lu reenviados, %lu respuestas, %lu esperas agotadas, apartado %lu veces",
+                 address, ntohs(server->addr.sin_port), server->ejected_until_us > now_us ? "apartado" : "disponible",
+                 server->rtt_ewma_us / 1000.0, forwarded, replies, timeouts, ejections);
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef RELAY_UPSTREAMS_H
+#define RELAY_UPSTREAMS_H
+
+#include <netinet/in.h>
+#include <stdint.h>
+
+// Conjunto de servidores DHCP a los que reenvía el relay. Cada cliente se
+// asigna a un servidor con hashing consistente sobre su MAC (rendezvous: el
+// servidor con mayor hash(MAC, servidor)), así que un cliente siempre habla
+// con el mismo servidor mientras esté sano y, si se añade o cae uno, solo se
+// mueven los clientes de ese servidor. Por servidor se lleva una media móvil
+// exponencial del RTT, que fija el plazo antes de pasar la solicitud al
+// siguiente servidor, y las esperas agotadas consecutivas: tras varias
+// seguidas el servidor se aparta durante un tiempo.
+
+#define MAX_UPSTREAMS 16
+#define UPSTREAM_EJECT_AFTER 3               // Esperas agotadas seguidas para apartar un servidor
+#define UPSTREAM_EJECT_US (10 * 1000000ull)  // Tiempo apartado antes de volver a probarlo
+#define UPSTREAM_RETRY_MIN_US 100000ull      // Plazo mínimo antes de pasar al siguiente servidor
+#define UPSTREAM_RETRY_MAX_US 2000000ull
+#define UPSTREAM_RETRY_DEFAULT_US 500000ull  // Plazo mientras no hay muestras de RTT
+
+typedef struct {
+    struct sockaddr_in addr;
+    uint32_t hash_seed;              // Derivado de la dirección: el orden en la línea de comandos no importa
+    uint64_t rtt_ewma_us;            // 0 mientras no haya muestras
+    uint32_t consecutive_timeouts;
+    uint64_t ejected_until_us;       // 0 si está disponible
+    int index;                       // Posición en el conjunto: identifica sus métricas (relay_metrics.h)
+} upstream_server;
+
+typedef struct {
+    upstream_server servers[MAX_UPSTREAMS];
+    int count;
+} upstream_set;
+
+// Añade un servidor "IP[:puerto]" (puerto 67 por defecto). Retorna -1 si el
+// formato no es válido o ya hay MAX_UPSTREAMS servidores.
+int upstream_add(upstream_set* set, const char* spec);
+
+// Índice del servidor con esa dirección de origen, o -1 si no es uno de ellos
+int upstream_find(const upstream_set* set, const struct sockaddr_in* addr);
+
+// Servidor para la MAC sin contar los de 'tried' (bit i = servidor i). Se
+// prefieren los no apartados; si todos lo están se elige igualmente entre
+// ellos para no dejar al cliente sin servicio. Retorna -1 si no queda ninguno.
+int upstream_select(const upstream_set* set, const uint8_t mac[6], uint32_t tried, uint64_t now_us);
+
+// Plazo de espera de una respuesta de este servidor antes de reintentar con otro
+uint64_t upstream_retry_timeout(const upstream_server* server);
+
+void upstream_record_reply(upstream_server* server, uint64_t rtt_us);
+
+// Retorna 1 si esta espera agotada aparta al servidor
+int upstream_record_timeout(upstream_server* server, uint64_t now_us);
+
+// Escribe en consola y en el log el estado y los contadores de cada servidor
+void upstream_report(const upstream_set* set, uint64_t now_us);
+
+#endif
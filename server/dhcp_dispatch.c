@@ -0,0 +1,173 @@
+#include "dhcp_dispatch.h"
+
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "dhcp_server.h"
+#include "reply_cache.h"
+#include "server_metrics.h"
+
+static dhcp_handler handlers[DISPATCH_MESSAGE_TYPES];
+
+void dispatch_register(uint8_t message_type, dhcp_handler handler) {
+    if (message_type < DISPATCH_MESSAGE_TYPES) {
+        handlers[message_type] = handler;
+    }
+}
+
+static inline uint64_t elapsed_ns(const struct timespec* start) {
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (uint64_t)(end.tv_sec - start->tv_sec) * 1000000000ull + (uint64_t)(end.tv_nsec - start->tv_nsec);
+}
+
+void dispatch_request(client_request* request) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    dhcp_packet_view packet;
+    if (dhcp_parse(request->buffer, request->length, &packet) != 0 || packet.op != BOOTREQUEST ||
+        packet.hlen != DHCP_HLEN_ETHERNET) {
+        metrics_add(SERVER_METRIC_MALFORMED, 1);
+        char client_ip[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &request->client_addr.sin_addr, client_ip, sizeof(client_ip));
+        printf("Mensaje DHCP mal formado de %s:%d (%zu bytes)\n", client_ip, ntohs(request->client_addr.sin_port),
+               request->length);
+        log_message("WARNING", "Mensaje DHCP mal formado descartado.");
+        return;
+    }
+
+    uint8_t type = packet.message_type;
+    dhcp_handler handler = type < DISPATCH_MESSAGE_TYPES ? handlers[type] : NULL;
+    if (handler == NULL) {
+        metrics_add(SERVER_METRIC_UNHANDLED, 1);
+        printf("Mensaje no reconocido: %s (tipo %u)\n", dhcp_message_name(type), type);
+        return;
+    }
+
+    // La instantánea no se libera hasta config_release, aunque el manejador
+    // espere al journal y mientras tanto lleguen varias recargas
+    const network_config* config = config_acquire();
+    // Sin giaddr el cliente está en la subred local; si pasó por un relay,
+    // el giaddr indica su subred
+    uint32_t subnet_index = 0;
+    if (packet.giaddr != 0 && dhcp_subnet_lookup(&config->selector, packet.giaddr, &subnet_index) != 0) {
+        config_release();
+        metrics_add(SERVER_METRIC_NO_SUBNET, 1);
+        log_message("WARNING", "Mensaje con un giaddr fuera de las subredes configuradas descartado.");
+        return;
+    }
+
+    // Decodificar una sola vez lo que usan los manejadores
+    dhcp_message message;
+    message.request = request;
+    message.packet = &packet;
+    message.config = config;
+    message.subnet = &config->subnets[subnet_index];
+    message.subnet_index = subnet_index;
+    memcpy(message.mac, packet.chaddr, sizeof(message.mac));
+    message.client_ip = packet.ciaddr;
+    message.requested_ip = packet.requested_ip ? dhcp_read_u32(packet.requested_ip) : 0;
+    message.server_id = packet.server_id ? dhcp_read_u32(packet.server_id) : 0;
+
+    // Una retransmisión (misma MAC, xid, tipo y giaddr) dentro de la ventana
+    // recibe los mismos bytes que la original sin volver a pasar por la
+    // tabla de leases. Solo DHCPDISCOVER y DHCPREQUEST tienen respuesta.
+    int cacheable = config->retransmit_window > 0 && (type == DHCPDISCOVER || type == DHCPREQUEST);
+    int result = 0;
+    size_t cached = cacheable ? reply_cache_lookup(&packet, (uint32_t)config->retransmit_window * 1000,
+                                                   request->reply, sizeof(request->reply)) : 0;
+    if (cached > 0) {
+        request->reply_length = cached;
+        metrics_add(SERVER_METRIC_REPLY_CACHE_HIT, 1);
+    } else {
+        result = handler(&message);
+        if (cacheable) {
+            metrics_add(SERVER_METRIC_REPLY_CACHE_MISS, 1);
+            reply_cache_store(&packet, request->reply, request->reply_length);
+        }
+    }
+    config_release();
+
+    // Contadores del hilo: sin atómicas compartidas entre workers
+    metrics_add(SERVER_METRIC_RECEIVED + type, 1);
+    if (result != 0) {
+        metrics_add(SERVER_METRIC_REJECTED + type, 1);
+    }
+    metrics_observe(SERVER_METRIC_LATENCY + type, elapsed_ns(&start));
+}
+
+void dispatch_get_stats(dispatch_stats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->malformed = metrics_read_counter(SERVER_METRIC_MALFORMED);
+    stats->unhandled = metrics_read_counter(SERVER_METRIC_UNHANDLED);
+    stats->no_subnet = metrics_read_counter(SERVER_METRIC_NO_SUBNET);
+    stats->cache_hits = metrics_read_counter(SERVER_METRIC_REPLY_CACHE_HIT);
+    stats->cache_misses = metrics_read_counter(SERVER_METRIC_REPLY_CACHE_MISS);
+    for (int type = 0; type < DISPATCH_MESSAGE_TYPES; ++type) {
+        stats->types[type].received = metrics_read_counter(SERVER_METRIC_RECEIVED + type);
+        stats->types[type].rejected = metrics_read_counter(SERVER_METRIC_REJECTED + type);
+        metrics_read_histogram(SERVER_METRIC_LATENCY + type, stats->types[type].latency);
+    }
+}
+
+// Cota superior (en microsegundos) de la cubeta que contiene el percentil
+static unsigned long latency_percentile(const dispatch_type_stats* stats, double percentile) {
+    unsigned long total = 0;
+    for (int bucket = 0; bucket < DISPATCH_LATENCY_BUCKETS; ++bucket) {
+        total += stats->latency[bucket];
+    }
+    unsigned long target = (unsigned long)(total * percentile);
+    unsigned long seen = 0;
+    for (int bucket = 0; bucket < DISPATCH_LATENCY_BUCKETS; ++bucket) {
+        seen += stats->latency[bucket];
+        if (seen > target) {
+            return 1ul << bucket;
+        }
+    }
+    return 1ul << (DISPATCH_LATENCY_BUCKETS - 1);
+}
+
+void dispatch_report_stats(void) {
+    dispatch_stats stats;
+    dispatch_get_stats(&stats);
+
+    char log_entry[BUFFER_SIZE];
+    snprintf(log_entry, BUFFER_SIZE, "Mensajes mal formados: %lu, sin manejador: %lu, sin subred: %lu",
+             stats.malformed, stats.unhandled, stats.no_subnet);
+    log_message("INFO", log_entry);
+    printf("\n---- ESTADÍSTICAS DE MENSAJES ----\n%s\n", log_entry);
+
+    unsigned long lookups = stats.cache_hits + stats.cache_misses;
+    snprintf(log_entry, BUFFER_SIZE, "Retransmisiones respondidas desde la caché: %lu de %lu solicitudes (%.1f%%)",
+             stats.cache_hits, lookups, lookups > 0 ? 100.0 * stats.cache_hits / lookups : 0.0);
+    log_message("INFO", log_entry);
+    printf("%s\n", log_entry);
+
+    for (int type = 0; type < DISPATCH_MESSAGE_TYPES; ++type) {
+        const dispatch_type_stats* current = &stats.types[type];
+        if (current->received == 0) {
+            continue;
+        }
+        snprintf(log_entry, BUFFER_SIZE,
+                 "%s: %lu recibidos, %lu rechazados, latencia p50 < %lu us, p99 < %lu us, p99.9 < %lu us",
+                 dhcp_message_name((uint8_t)type), current->received, current->rejected,
+                 latency_percentile(current, 0.50), latency_percentile(current, 0.99),
+                 latency_percentile(current, 0.999));
+        log_message("INFO", log_entry);
+        printf("%s\n", log_entry);
+
+        // Histograma: solo las cubetas con mensajes
+        int length = snprintf(log_entry, BUFFER_SIZE, "  histograma:");
+        for (int bucket = 0; bucket < DISPATCH_LATENCY_BUCKETS && length < BUFFER_SIZE; ++bucket) {
+            if (current->latency[bucket] > 0) {
+                length += snprintf(log_entry + length, BUFFER_SIZE - length, " <%luus=%lu",
+                                   1ul << bucket, current->latency[bucket]);
+            }
+        }
+        printf("%s\n", log_entry);
+    }
+    printf("----------------------------------\n");
+}
@@ -0,0 +1,63 @@
+#ifndef DHCP_DISPATCH_H
+#define DHCP_DISPATCH_H
+
+#include <stdint.h>
+
+#include "dhcp_wire.h"
+#include "request_queue.h"
+#include "server_config.h"
+#include "server_metrics.h"
+
+// Capa de despacho de los workers: valida el datagrama y lo clasifica en una
+// sola pasada (opción 53), decodifica una vez la MAC y las IP a binario,
+// elige la subred por el giaddr y llama al manejador registrado para ese
+// tipo. Cuenta los mensajes de cada tipo y guarda un histograma de la
+// latencia de procesamiento (en las métricas por hilo de server_metrics.h).
+
+#define DISPATCH_MESSAGE_TYPES SERVER_MESSAGE_TYPES      // Índice = valor de la opción 53
+#define DISPATCH_LATENCY_BUCKETS METRICS_LATENCY_BUCKETS  // Potencias de 2 en microsegundos (hasta ~8 s)
+
+// Mensaje decodificado que recibe cada manejador
+typedef struct {
+    client_request* request;         // Socket y dirección a la que responder
+    const dhcp_packet_view* packet;  // Vista sobre el buffer recibido
+    const network_config* config;    // Instantánea vigente durante toda la solicitud
+    const subnet_config* subnet;     // Subred del cliente (la local si giaddr es 0)
+    uint32_t subnet_index;           // Índice de 'subnet', que es también el pool de leases
+    uint8_t mac[6];                  // chaddr
+    uint32_t client_ip;              // ciaddr (orden de host, 0 si no tiene)
+    uint32_t requested_ip;           // Opción 50 (orden de host, 0 si no viene)
+    uint32_t server_id;              // Opción 54 (orden de host, 0 si no viene)
+} dhcp_message;
+
+// Retorna 0 si atendió el mensaje o -1 si lo rechazó (NAK, IP o MAC que no coinciden...)
+typedef int (*dhcp_handler)(const dhcp_message* message);
+
+// Registra el manejador de un tipo de mensaje (antes de arrancar los workers)
+void dispatch_register(uint8_t message_type, dhcp_handler handler);
+
+// Procesa un datagrama recibido. La llaman los workers.
+void dispatch_request(client_request* request);
+
+typedef struct {
+    unsigned long received;
+    unsigned long rejected;
+    unsigned long latency[DISPATCH_LATENCY_BUCKETS];  // Cubeta i: menos de 2^i microsegundos
+} dispatch_type_stats;
+
+typedef struct {
+    unsigned long malformed;   // Datagramas que no son un BOOTREQUEST válido
+    unsigned long unhandled;   // Tipos sin manejador registrado
+    unsigned long no_subnet;   // giaddr que no pertenece a ninguna subred configurada
+    unsigned long cache_hits;    // Retransmisiones respondidas desde reply_cache
+    unsigned long cache_misses;  // DHCPDISCOVER/DHCPREQUEST que pasaron por su manejador
+    dispatch_type_stats types[DISPATCH_MESSAGE_TYPES];
+} dispatch_stats;
+
+// Copia de los contadores (suma de los de todos los hilos)
+void dispatch_get_stats(dispatch_stats* stats);
+
+// Escribe en consola y en el log los contadores y percentiles de cada tipo
+void dispatch_report_stats(void);
+
+#endif
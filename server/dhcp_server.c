@@ -1,527 +1,977 @@
+#define _GNU_SOURCE  // recvmmsg/sendmmsg
 #include <arpa/inet.h>
 #include <pthread.h>  // Añadido para multithreading
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdatomic.h>
 #include <sys/socket.h>
+#include <linux/filter.h>
+#include <sched.h>
 #include <unistd.h>
 #include <time.h>
 
-#define BUFFER_SIZE 1024
-#define POOL_SIZE 2
-#define LOG_FILE "./server/dhcp_server.log"
-
-// Estructura para almacenar los registros de arrendamiento
-typedef struct {
-    char ip[16];              // Dirección IP asignada
-    char mac_address[18];     // Dirección MAC del cliente
-    time_t lease_start;       // Tiempo de inicio del lease
-    time_t lease_duration;    // Duración del lease en segundos
-    int assigned;             // 0: libre, 1: asignada
-    int conflicted;           // 0: sin conflicto, 1: en conflicto
-    char subnet_mask[16];     // Máscara de subred
-    char default_gateway[16]; // Puerta de enlace predeterminada
-    char dns_server[16];      // Servidor DNS
-} lease_record;
-
-// Estructura para pasar información al hilo
-typedef struct {
-    int udp_socket;
-    char buffer[BUFFER_SIZE];
-    struct sockaddr_in client_addr;
-    socklen_t client_addr_len;
-} client_request;
-
-lease_record lease_table[POOL_SIZE];
+#include "dhcp_dispatch.h"
+#include "dhcp_log.h"
+#include "dhcp_server.h"
+#include "dhcp_wire.h"
+#include "lease_journal.h"
+#include "lease_table.h"
+#include "reply_cache.h"
+#include "request_queue.h"
+#include "server_config.h"
+#include "server_metrics.h"
+
+#define DEFAULT_WORKERS 4       // Hilos worker por defecto
+#define DEFAULT_QUEUE_SIZE 256  // Slots de la cola de solicitudes por defecto
+#define MAX_IO_BATCH 64         // Máximo de datagramas por recvmmsg/sendmmsg
+#define MAX_SERVER_SOCKETS 256  // Máximo de sockets SO_REUSEPORT (opción -r)
+
+// Datagramas por llamada al socket (opción -b); 1 = recvfrom/sendto por paquete
+static int io_batch = 1;
+
+// Función para escribir mensajes en el log (se encolan para el hilo escritor)
+void log_message(const char* level, const char* message) {
+    dhcp_log_level log_level = DHCP_LOG_INFO;
+    dhcp_log_parse_level(level, &log_level);
+    dhcp_log(log_level, "%s", message);
+}
 
-// Mutex para proteger el acceso a lease_table
-pthread_mutex_t lease_table_mutex = PTHREAD_MUTEX_INITIALIZER;
+// Parámetros de red de la subred del cliente, comunes a DHCPOFFER y DHCPACK
+static void add_network_options(dhcp_builder* builder, const dhcp_message* message) {
+    const subnet_config* subnet = message->subnet;
+    if (message->config->server_id_addr != 0) {
+        dhcp_add_option_u32(builder, DHCP_OPT_SERVER_ID, message->config->server_id_addr);
+    }
+    dhcp_add_option_u32(builder, DHCP_OPT_LEASE_TIME, (uint32_t)subnet->lease_time);
+    dhcp_add_option_u32(builder, DHCP_OPT_SUBNET_MASK, subnet->subnet_mask_addr);
+    dhcp_add_option_u32(builder, DHCP_OPT_ROUTER, subnet->default_gateway_addr);
+    dhcp_add_option_u32(builder, DHCP_OPT_DNS_SERVER, subnet->dns_server_addr);
+}
 
-// Función para escribir mensajes en el log
-void log_message(const char* level, const char* message) {
-    FILE* log_file = fopen(LOG_FILE, "a");
-    if (log_file == NULL) {
-        perror("No se pudo abrir el archivo de log");
+// Termina el mensaje en el slot de la solicitud; el worker lo envía (solo o en
+// lote) a quien hizo la solicitud (cliente o relay) al terminar de despachar
+static void send_reply(client_request* request, dhcp_builder* builder) {
+    size_t length = dhcp_finish(builder);
+    if (length == 0) {
+        log_message("ERROR", "La respuesta DHCP no cabe en el buffer de envío.");
         return;
     }
+    request->reply_length = length;
+}
 
-    time_t now = time(NULL);
-    struct tm* time_info = localtime(&now);
-    char time_str[20];
-    strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", time_info);
+// DHCPOFFER o DHCPACK con el lease y los parámetros de red
+static void send_lease(const dhcp_message* message, uint8_t message_type, const lease_record* lease) {
+    client_request* request = message->request;
+    dhcp_builder builder;
+    dhcp_builder_init_reply(&builder, request->reply, sizeof(request->reply), message->packet, message_type, lease->ip);
+    add_network_options(&builder, message);
+    send_reply(request, &builder);
+    metrics_add(message_type == DHCPOFFER ? SERVER_METRIC_SENT_OFFER : SERVER_METRIC_SENT_ACK, 1);
+}
 
-    fprintf(log_file, "[%s] %s: %s\n", time_str, level, message);
-    fclose(log_file);
+// DHCPNAK con el motivo en la opción 56
+static void send_nak(const dhcp_message* message, const char* reason) {
+    client_request* request = message->request;
+    dhcp_builder builder;
+    dhcp_builder_init_reply(&builder, request->reply, sizeof(request->reply), message->packet, DHCPNAK, 0);
+    if (message->config->server_id_addr != 0) {
+        dhcp_add_option_u32(&builder, DHCP_OPT_SERVER_ID, message->config->server_id_addr);
+    }
+    dhcp_add_option(&builder, DHCP_OPT_MESSAGE, (uint8_t)strlen(reason), reason);
+    send_reply(request, &builder);
+    metrics_add(SERVER_METRIC_SENT_NAK, 1);
 }
 
-// Función para leer los parámetros de red desde el archivo de configuración
-int load_network_config(const char* filename, char* subnet_mask, char* default_gateway, char* dns_server, int* lease_time) {
-    FILE* file = fopen(filename, "r");
-    if (!file) {
-        perror("No se pudo abrir el archivo de configuración");
+// DHCPDISCOVER: reservar una IP disponible y ofrecerla
+static int handle_discover(const dhcp_message* message) {
+    // Retener una dirección del pool de la subred solo durante OFFER_HOLD_TIME:
+    // el lease se registra con el DHCPREQUEST. Una reserva estática tiene
+    // prioridad; si no se puede usar se ofrece otra.
+    lease_record lease;
+    uint32_t reserved_ip;
+    time_t hold_time = message->config->offer_hold_time;
+    int reserved = reservation_lookup(&message->config->reservations, message->mac, &reserved_ip) == 0 &&
+                   offer_reserved_ip(message->subnet_index, reserved_ip, message->mac, hold_time, &lease) == 0;
+    if (!reserved && offer_ip(message->subnet_index, message->mac, hold_time, &lease) != 0) {
+        printf("No hay direcciones IP disponibles para ofrecer.\n");
+        log_message("WARNING", "No hay direcciones IP disponibles para ofrecer a un cliente.");
+        metrics_add(SERVER_METRIC_NO_ADDRESS, 1);
+
+        // Informar al cliente de que no hay IPs disponibles para que espere antes de reintentar
+        send_nak(message, "No hay direcciones IP disponibles.");
         return -1;
     }
 
-    char line[BUFFER_SIZE];
-    while (fgets(line, sizeof(line), file)) {
-        // Eliminar espacios en blanco al inicio y fin de la línea
-        char* trimmed_line = line;
-        while (isspace((unsigned char)*trimmed_line)) trimmed_line++;
+    send_lease(message, DHCPOFFER, &lease);
+    char client_ip[INET_ADDRSTRLEN];
+    char lease_ip[INET_ADDRSTRLEN];
+    char client_mac[LEASE_MAC_STRLEN];
+    inet_ntop(AF_INET, &message->request->client_addr.sin_addr, client_ip, sizeof(client_ip));
+    printf("\n---- OFERTA ENVIADA ----\n");
+    printf("Cliente IP: %s:%d\n", client_ip, ntohs(message->request->client_addr.sin_port));
+    printf("IP Ofrecida: %s\n", lease_ip_string(&lease, lease_ip));
+    printf("MAC Cliente: %s\n", lease_mac_string(message->mac, client_mac));
+    printf("------------------------\n\n");
+    return 0;
+}
 
-        // Omitir líneas vacías o comentarios
-        if (*trimmed_line == '\0' || *trimmed_line == '#') {
-            continue;
-        }
+// DHCPREQUEST: confirmar (o renovar) el lease de la IP solicitada
+static int handle_request(const dhcp_message* message) {
+    // La IP va en la opción 50 (SELECTING) o en ciaddr (renovación)
+    uint32_t requested = message->requested_ip ? message->requested_ip : message->client_ip;
+    if (requested == 0) {
+        printf("No se pudo extraer la IP solicitada en DHCPREQUEST.\n");
+        log_message("ERROR", "No se pudo extraer la IP solicitada en DHCPREQUEST.");
+        return -1;
+    }
+    // El cliente eligió la oferta de otro servidor: la nuestra ya no se usará
+    uint32_t own_id = message->config->server_id_addr;
+    if (message->server_id != 0 && own_id != 0 && message->server_id != own_id) {
+        cancel_offer(message->subnet_index, message->mac);
+        return 0;
+    }
 
-        if (strncmp(trimmed_line, "SUBNET_MASK=", 12) == 0) {
-            strcpy(subnet_mask, trimmed_line + 12);
-            subnet_mask[strcspn(subnet_mask, "\n")] = '\0'; // Eliminar el salto de línea
-        } else if (strncmp(trimmed_line, "DEFAULT_GATEWAY=", 16) == 0) {
-            strcpy(default_gateway, trimmed_line + 16);
-            default_gateway[strcspn(default_gateway, "\n")] = '\0';
-        } else if (strncmp(trimmed_line, "DNS_SERVER=", 11) == 0) {
-            strcpy(dns_server, trimmed_line + 11);
-            dns_server[strcspn(dns_server, "\n")] = '\0';
-        } else if (strncmp(trimmed_line, "LEASE_TIME=", 11) == 0) {
-            *lease_time = atoi(trimmed_line + 11);
-        }
+    char requested_ip[INET_ADDRSTRLEN];
+    char client_mac[LEASE_MAC_STRLEN];
+    lease_address_string(requested, requested_ip);
+    lease_mac_string(message->mac, client_mac);
+    printf("\n---- SOLICITUD RECIBIDA (DHCPREQUEST) ----\n");
+    printf("IP Solicitada: %s\n", requested_ip);
+    printf("MAC Cliente: %s\n", client_mac);
+    printf("------------------------------------------\n");
+
+    // Verificar si la IP solicitada está asignada al cliente y renovarla
+    lease_record lease;
+    if (renew_assigned_lease(message->subnet_index, requested, message->mac, message->subnet->lease_time, &lease) == 0) {
+        send_lease(message, DHCPACK, &lease);
+        printf("\n---- CONFIRMACIÓN ENVIADA (DHCPACK) ----\n");
+        printf("IP Asignada: %s\n", requested_ip);
+        printf("MAC Cliente: %s\n", client_mac);
+        printf("Duración Lease: %d segundos\n", message->subnet->lease_time);
+        printf("------------------------------------------\n");
+        return 0;
     }
 
-    fclose(file);
+    printf("La IP solicitada %s no está asignada a la MAC %s\n", requested_ip, client_mac);
+    log_message("WARNING", "La IP solicitada no está asignada al cliente.");
+
+    // Enviar DHCPNAK al cliente
+    char reason[128];
+    snprintf(reason, sizeof(reason), "Solicitud inválida para IP %s y MAC %s", requested_ip, client_mac);
+    send_nak(message, reason);
+    printf("\n---- DHCPNAK ENVIADO ----\n");
+    printf("IP Solicitada: %s\n", requested_ip);
+    printf("Motivo: %s\n", reason);
+    printf("--------------------------\n\n");
+    return -1;
+}
+
+// DHCPRELEASE: el cliente libera la IP que tiene en ciaddr
+static int handle_release(const dhcp_message* message) {
+    if (message->client_ip == 0) {
+        printf("No se pudo extraer la IP del cliente en DHCPRELEASE.\n");
+        log_message("ERROR", "No se pudo extraer la IP del cliente en DHCPRELEASE.");
+        return -1;
+    }
+    if (release_ip(message->client_ip, message->mac) != 0) {
+        return -1;
+    }
+    metrics_add(SERVER_METRIC_RELEASED, 1);
     return 0;
 }
 
-// Función para generar el rango de IPs y asignar parámetros de red
-int generate_ip_pool(const char *ip_start, const char *ip_end) {
-    struct in_addr start_addr, end_addr;
-    if (inet_pton(AF_INET, ip_start, &start_addr) <= 0) {
-        perror("Invalid start IP address");
-        log_message("ERROR", "Dirección IP de inicio inválida.");
+// DHCPDECLINE: la IP rechazada va en la opción 50
+static int handle_decline_message(const dhcp_message* message) {
+    if (message->requested_ip == 0) {
+        printf("No se pudo extraer la IP del cliente en DHCPDECLINE.\n");
+        log_message("ERROR", "No se pudo extraer la IP del cliente en DHCPDECLINE.");
         return -1;
     }
-    if (inet_pton(AF_INET, ip_end, &end_addr) <= 0) {
-        perror("Invalid end IP address");
-        log_message("ERROR", "Dirección IP de fin inválida.");
+    if (handle_decline(message->requested_ip, message->mac) != 0) {
         return -1;
     }
+    metrics_add(SERVER_METRIC_CONFLICTS, 1);
+    return 0;
+}
 
-    unsigned long start = ntohl(start_addr.s_addr);
-    unsigned long end = ntohl(end_addr.s_addr);
-    int count = 0;
+// Envía las respuestas construidas por los manejadores: con sendto una a una o
+// con sendmmsg en una sola llamada cuando el servidor trabaja por lotes
+static void flush_replies(client_request** requests, size_t count) {
+    struct mmsghdr messages[MAX_IO_BATCH];
+    struct iovec vectors[MAX_IO_BATCH];
+    unsigned int pending = 0;
+    int udp_socket = -1;
+
+    for (size_t i = 0; i < count; ++i) {
+        client_request* request = requests[i];
+        if (request->reply_length == 0) {
+            continue;
+        }
+        if (io_batch == 1) {
+            sendto(request->udp_socket, request->reply, request->reply_length, 0,
+                   (const struct sockaddr *)&request->client_addr, request->client_addr_len);
+            continue;
+        }
+        vectors[pending].iov_base = request->reply;
+        vectors[pending].iov_len = request->reply_length;
+        memset(&messages[pending], 0, sizeof(messages[pending]));
+        messages[pending].msg_hdr.msg_name = &request->client_addr;
+        messages[pending].msg_hdr.msg_namelen = request->client_addr_len;
+        messages[pending].msg_hdr.msg_iov = &vectors[pending];
+        messages[pending].msg_hdr.msg_iovlen = 1;
+        udp_socket = request->udp_socket;  // Todas las solicitudes llegan por el mismo socket
+        pending++;
+    }
 
-    for (unsigned long ip = start; ip <= end && count < POOL_SIZE; ++ip) {
-        struct in_addr addr;
-        addr.s_addr = htonl(ip);
-        char ip_str[INET_ADDRSTRLEN];
-        inet_ntop(AF_INET, &addr, ip_str, INET_ADDRSTRLEN);
+    // sendmmsg puede enviar menos mensajes de los pedidos: reintentar con el resto
+    unsigned int sent = 0;
+    while (sent < pending) {
+        int result = sendmmsg(udp_socket, messages + sent, pending - sent, 0);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("No se pudieron enviar las respuestas");
+            log_message("ERROR", "No se pudieron enviar las respuestas DHCP del lote.");
+            break;
+        }
+        sent += (unsigned int)result;
+    }
+}
 
-        lease_table[count].assigned = 0;
-        lease_table[count].conflicted = 0;
-        strcpy(lease_table[count].ip, ip_str);
-        lease_table[count].lease_start = 0;
-        lease_table[count].lease_duration = 0;
-        memset(lease_table[count].mac_address, 0, sizeof(lease_table[count].mac_address));
+// Bucle de cada worker: toma hasta io_batch solicitudes de la cola, las
+// despacha, envía las respuestas y devuelve los slots al terminar. Termina
+// cuando la cola se cierra y ya no le quedan solicitudes.
+void* worker_loop(void* arg) {
+    request_queue* queue = (request_queue*)arg;
+    client_request* requests[MAX_IO_BATCH];
+    while (1) {
+        size_t count = request_queue_pop_batch(queue, requests, (size_t)io_batch);
+        if (count == 0) {
+            break;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            requests[i]->reply_length = 0;
+            dispatch_request(requests[i]);
+        }
+        flush_replies(requests, count);
+        request_queue_release_batch(queue, requests, count);
+    }
+    return NULL;
+}
 
-        count++;
+// Informa (como máximo una vez por segundo) de los datagramas descartados por cola llena
+void report_queue_drops(request_queue* queue) {
+    static _Thread_local time_t last_report = 0;  // Cada receptor informa de su propia cola
+    time_t now = time(NULL);
+    if (now == last_report) {
+        return;
     }
+    last_report = now;
 
-    return count;  // Retorna el número de direcciones generadas
+    queue_stats stats;
+    request_queue_get_stats(queue, &stats);
+
+    char log_entry[BUFFER_SIZE];
+    snprintf(log_entry, BUFFER_SIZE,
+             "Cola de solicitudes llena: profundidad %zu/%zu, máximo %zu, encoladas %lu, descartadas %lu",
+             stats.depth, stats.capacity, stats.high_watermark, stats.enqueued, stats.dropped);
+    log_message("WARNING", log_entry);
+    printf("%s\n", log_entry);
 }
 
-// Función para registrar un lease
-void register_lease(lease_record* lease, const char* mac_address, time_t lease_duration) {
-    lease->lease_start = time(NULL);
-    lease->lease_duration = lease_duration;
-    // lease->assigned = 1;
-    strcpy(lease->mac_address, mac_address);
+// Bandera activada por SIGHUP; la recarga se hace fuera del manejador de señal
+volatile sig_atomic_t reload_requested = 0;
 
-    // Mejorar el formato de la salida en consola
-    printf("\n**** LEASE REGISTRADO ****\n");
-    printf("IP Asignada: %s\n", lease->ip);
-    printf("MAC Cliente: %s\n", mac_address);
-    printf("Duración Lease: %ld segundos\n", lease_duration);
-    printf("**************************\n\n");
+void handle_sighup(int signum) {
+    (void)signum;
+    reload_requested = 1;
+}
 
-    char log_entry[BUFFER_SIZE];
-    snprintf(log_entry, BUFFER_SIZE, "Lease registrado para la IP %s con MAC %s por %ld segundos", lease->ip, mac_address, lease_duration);
-    log_message("INFO", log_entry);
+// Bandera activada por SIGINT/SIGTERM; el bucle principal termina y cierra la tabla limpiamente
+volatile sig_atomic_t shutdown_requested = 0;
+
+void handle_shutdown(int signum) {
+    (void)signum;
+    shutdown_requested = 1;
 }
 
-// Función para renovar un lease
-void renew_lease(lease_record* lease, time_t lease_duration) {
-    lease->lease_start = time(NULL);
-    lease->lease_duration = lease_duration;
+// Bandera activada por SIGUSR1: el bucle principal escribe las estadísticas de mensajes
+volatile sig_atomic_t stats_requested = 0;
 
-    // Mejorar el formato de la salida en consola
-    printf("\n---- LEASE RENOVADO ----\n");
-    printf("IP Renovada: %s\n", lease->ip);
-    printf("MAC Cliente: %s\n", lease->mac_address);
-    printf("Nueva Duración: %ld segundos\n", lease_duration);
-    printf("------------------------\n\n");
+void handle_sigusr1(int signum) {
+    (void)signum;
+    stats_requested = 1;
+}
 
-    char log_entry[BUFFER_SIZE];
-    snprintf(log_entry, BUFFER_SIZE, "Lease renovado para la IP %s con MAC %s por %ld segundos", lease->ip, lease->mac_address, lease_duration);
-    log_message("INFO", log_entry);
+// Aplica a la tabla de leases los cambios de reservas antes de que los
+// workers vean la configuración nueva: una IP recién reservada deja de
+// estar libre antes de que nadie pueda ofrecerla a otra MAC
+static void apply_reservation_changes(const network_config* previous, const network_config* next) {
+    update_lease_reservations(previous->reservations.addresses, previous->reservations.count,
+                              next->reservations.addresses, next->reservations.count);
 }
 
-// Función para liberar una IP
-void release_ip(const char* ip, const char* mac_address) {
-    pthread_mutex_lock(&lease_table_mutex);
-    for (int i = 0; i < POOL_SIZE; ++i) {
-        if (strcmp(lease_table[i].ip, ip) == 0) {
-            if (strcmp(lease_table[i].mac_address, mac_address) == 0) {
-                lease_table[i].assigned = 0;
-                lease_table[i].lease_start = 0;
-                lease_table[i].lease_duration = 0;
-                memset(lease_table[i].mac_address, 0, sizeof(lease_table[i].mac_address));
-
-                printf("\n---- IP LIBERADA ----\n");
-                printf("IP: %s\n", ip);
-                printf("MAC Cliente: %s\n", mac_address);
-                printf("---------------------\n\n");
-
-                char log_entry[BUFFER_SIZE];
-                snprintf(log_entry, BUFFER_SIZE, "IP %s liberada y disponible para nuevos clientes", ip);
-                log_message("INFO", log_entry);
-            } else {
-                printf("La MAC %s no coincide con el registro para la IP %s\n", mac_address, ip);
-                log_message("WARNING", "Intento de liberar una IP con una MAC que no coincide.");
-            }
-            break;
-        }
+// Recarga network_config.txt si se recibió SIGHUP
+void apply_pending_reload() {
+    if (!reload_requested) {
+        return;
+    }
+    reload_requested = 0;
+
+    if (config_reload(apply_reservation_changes) == 0) {
+        const network_config* config = config_current();
+        char log_entry[BUFFER_SIZE];
+        snprintf(log_entry, BUFFER_SIZE,
+                 "Configuración recargada: MASK=%s; GATEWAY=%s; DNS=%s; LEASE=%d; RESERVAS=%u",
+                 config->subnet_mask, config->default_gateway, config->dns_server, config->lease_time,
+                 config->reservations.count);
+        log_message("INFO", log_entry);
+        printf("%s\n", log_entry);
+    } else {
+        printf("No se pudo recargar la configuración; se mantiene la anterior.\n");
+        log_message("ERROR", "No se pudo recargar la configuración; se mantiene la anterior.");
     }
-    pthread_mutex_unlock(&lease_table_mutex);
 }
 
-// Verifica y libera leases expirados
-void check_expired_leases() {
-    time_t current_time = time(NULL);
-    pthread_mutex_lock(&lease_table_mutex);
-    for (int i = 0; i < POOL_SIZE; ++i) {
-        if (lease_table[i].assigned &&
-            difftime(current_time, lease_table[i].lease_start) >= lease_table[i].lease_duration) {
-            lease_table[i].assigned = 0;
-            lease_table[i].lease_start = 0;
-            lease_table[i].lease_duration = 0;
-            memset(lease_table[i].mac_address, 0, sizeof(lease_table[i].mac_address));
-
-            char log_entry[BUFFER_SIZE];
-            snprintf(log_entry, BUFFER_SIZE, "Lease expirado para la IP %s. Liberando la dirección.", lease_table[i].ip);
-            log_message("INFO", log_entry);
-
-            printf("%s\n", log_entry);
-        }
+// Activada al detener el servidor con -r, antes de cerrar la lectura de los
+// sockets: lo que devuelva la recepción a partir de entonces se descarta
+static atomic_int receivers_stopping = 0;
+
+// Recibe hasta io_batch datagramas con una sola llamada a recvmmsg, cada uno
+// directamente en el buffer de un slot libre, y los entrega juntos a la cola
+static void receive_batch(request_queue* queue, int udp_socket) {
+    client_request* requests[MAX_IO_BATCH];
+    size_t count = request_queue_acquire_batch(queue, requests, (size_t)io_batch);
+    if (count == 0) {
+        // Cola llena: retirar un datagrama del socket y contarlo como descartado
+        char discard[BUFFER_SIZE];
+        recvfrom(udp_socket, discard, sizeof(discard), 0, NULL, NULL);
+        request_queue_count_drop(queue);
+        report_queue_drops(queue);
+        return;
+    }
+
+    struct mmsghdr messages[MAX_IO_BATCH];
+    struct iovec vectors[MAX_IO_BATCH];
+    memset(messages, 0, count * sizeof(messages[0]));
+    for (size_t i = 0; i < count; ++i) {
+        vectors[i].iov_base = requests[i]->buffer;
+        vectors[i].iov_len = BUFFER_SIZE;
+        messages[i].msg_hdr.msg_name = &requests[i]->client_addr;
+        messages[i].msg_hdr.msg_namelen = sizeof(requests[i]->client_addr);
+        messages[i].msg_hdr.msg_iov = &vectors[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+    }
 
-        if (lease_table[i].conflicted &&
-            difftime(current_time, lease_table[i].lease_start) >= 300) {
-            lease_table[i].conflicted = 0;  // Quitar el flag de conflicto
-            char log_entry[BUFFER_SIZE];
-            snprintf(log_entry, BUFFER_SIZE, "IP %s en conflicto ahora está disponible.", lease_table[i].ip);
-            log_message("INFO", log_entry);
-            printf("%s\n", log_entry);
+    // MSG_WAITFORONE: bloquear solo hasta el primer datagrama y recoger los que ya estén en cola
+    int received = recvmmsg(udp_socket, messages, (unsigned int)count, MSG_WAITFORONE, NULL);
+    if (atomic_load(&receivers_stopping)) {
+        request_queue_release_batch(queue, requests, count);
+        return;
+    }
+    if (received < 0) {
+        if (errno != EINTR) {
+            perror("No se pudo recibir el mensaje");
+            log_message("ERROR", "No se pudo recibir el lote de mensajes.");
         }
+        request_queue_release_batch(queue, requests, count);
+        return;
+    }
+
+    for (int i = 0; i < received; ++i) {
+        client_request* request = requests[i];
+        request->udp_socket = udp_socket;
+        request->length = messages[i].msg_len;
+        request->client_addr_len = messages[i].msg_hdr.msg_namelen;
     }
-    pthread_mutex_unlock(&lease_table_mutex);
+    request_queue_push_batch(queue, requests, (size_t)received);
+    request_queue_release_batch(queue, requests + received, count - (size_t)received);
 }
 
-// Función para asignar una IP disponible
-lease_record* assign_ip(const char* client_mac, const char* subnet_mask, const char* default_gateway, const char* dns_server) {
-    pthread_mutex_lock(&lease_table_mutex);
-    for (int i = 0; i < POOL_SIZE; ++i) {
-        if (!lease_table[i].assigned && lease_table[i].conflicted == 0) {
-            lease_table[i].assigned = 1;
-            // Asignamos la MAC al registro
-            strcpy(lease_table[i].mac_address, client_mac);
-
-            // Asignar los parámetros de red
-            strcpy(lease_table[i].subnet_mask, subnet_mask);
-            strcpy(lease_table[i].default_gateway, default_gateway);
-            strcpy(lease_table[i].dns_server, dns_server);
-
-            pthread_mutex_unlock(&lease_table_mutex);
-            return &lease_table[i];  // Retornar el registro del lease
-        }
+// Un socket de escucha con su cola, su hilo receptor y sus workers. Sin -r hay
+// uno solo y lo atiende el hilo principal; con -r cada grupo se fija a una CPU.
+typedef struct {
+    int udp_socket;
+    int cpu;                 // -1 si no se fija a ninguna CPU
+    request_queue queue;
+    pthread_t receiver;      // Solo con -r
+    pthread_t* workers;
+    int worker_count;
+} socket_group;
+
+// Recibe el siguiente datagrama (o lote) de un socket y lo entrega a su cola
+static void receive_next(socket_group* group) {
+    request_queue* queue = &group->queue;
+    int udp_socket = group->udp_socket;
+    if (io_batch > 1) {
+        receive_batch(queue, udp_socket);
+        return;
+    }
+
+    client_request* request = request_queue_acquire(queue);
+    if (request == NULL) {
+        // Cola llena: retirar el datagrama del socket y contarlo como descartado
+        char discard[BUFFER_SIZE];
+        recvfrom(udp_socket, discard, sizeof(discard), 0, NULL, NULL);
+        request_queue_count_drop(queue);
+        report_queue_drops(queue);
+        return;
+    }
+
+    request->udp_socket = udp_socket;
+    request->client_addr_len = sizeof(request->client_addr);
+    int bytes_received = recvfrom(udp_socket, request->buffer, BUFFER_SIZE, 0, (struct sockaddr *)&request->client_addr, &request->client_addr_len);
+
+    if (atomic_load(&receivers_stopping)) {
+        request_queue_release(queue, request);
+    } else if (bytes_received > 0) {
+        request->length = (size_t)bytes_received;
+
+        // Entregar la solicitud a la cola para que la procese un worker
+        request_queue_push(queue, request);
+    } else if (bytes_received < 0 && errno == EINTR) {
+        // Interrumpido por una señal (SIGHUP, SIGUSR1, SIGINT o SIGTERM): devolver el slot y seguir
+        request_queue_release(queue, request);
+    } else {
+        perror("No se pudo recibir el mensaje");
+        log_message("ERROR", "No se pudo recibir el mensaje del cliente.");
+        request_queue_release(queue, request);
     }
-    pthread_mutex_unlock(&lease_table_mutex);
-    return NULL; // No hay direcciones disponibles
 }
 
-// Función para manejar el mensaje DHCPDECLINE enviado por el cliente
-void handle_decline(const char* ip, const char* mac_address) {
-    pthread_mutex_lock(&lease_table_mutex);
-    for (int i = 0; i < POOL_SIZE; ++i) {
-        if (strcmp(lease_table[i].ip, ip) == 0 && strcmp(lease_table[i].mac_address, mac_address) == 0) {
-            lease_table[i].assigned = 0;
-            lease_table[i].lease_start = 0;
-            lease_table[i].lease_duration = 0;
-            lease_table[i].conflicted = 1; 
-            memset(lease_table[i].mac_address, 0, sizeof(lease_table[i].mac_address));
-
-            char log_entry[BUFFER_SIZE];
-            snprintf(log_entry, BUFFER_SIZE, "IP %s rechazada por el cliente %s y liberada.", ip, mac_address);
-            log_message("INFO", log_entry);
-            printf("%s\n", log_entry);
-            break;
-        }
+// Hilo receptor de un socket SO_REUSEPORT (las señales siguen bloqueadas aquí)
+static void* receiver_loop(void* arg) {
+    socket_group* group = (socket_group*)arg;
+    while (!atomic_load(&receivers_stopping)) {
+        receive_next(group);
     }
-    pthread_mutex_unlock(&lease_table_mutex);
+    return NULL;
 }
 
-// Función para manejar cada solicitud de cliente en un hilo separado
-void* handle_client(void* arg) {
-    client_request* request = (client_request*)arg;
-    char* buffer = request->buffer;
-    struct sockaddr_in client_addr = request->client_addr;
-    socklen_t client_addr_len = request->client_addr_len;
-    int udp_socket = request->udp_socket;
-
-    // Variables necesarias para manejar la configuración
-    char subnet_mask[16];
-    char default_gateway[16];
-    char dns_server[16];
-    int lease_time;
-
-    // Cargar la configuración de red
-    if (load_network_config("network_config.txt", subnet_mask, default_gateway, dns_server, &lease_time) != 0) {
-        printf("Error al cargar la configuración de red.\n");
-        log_message("ERROR", "Error al cargar la configuración de red en el hilo.");
-        pthread_exit(NULL);
-    }
-
-    if (strstr(buffer, "DHCPDISCOVER")) {
-        // Extraer la dirección MAC del mensaje de DHCPDISCOVER
-        char* mac_start = strstr(buffer, "MAC ");
-        if (mac_start) {
-            char client_mac[18];
-            sscanf(mac_start + 4, "%17s", client_mac);
-
-            // Asignar una IP disponible al cliente, pasando los parámetros de red
-            lease_record* lease = assign_ip(client_mac, subnet_mask, default_gateway, dns_server);
-            if (lease) {
-                // Registrar el lease con el tiempo de lease leído desde el archivo de configuración
-                register_lease(lease, client_mac, lease_time);
-
-                // Construir el mensaje DHCPOFFER con la información adicional
-                char offer_message[BUFFER_SIZE];
-                snprintf(offer_message, BUFFER_SIZE,
-                    "DHCPOFFER: IP=%s; MASK=%s; GATEWAY=%s; DNS=%s; LEASE=%ld",
-                    lease->ip, lease->subnet_mask, lease->default_gateway, lease->dns_server, lease->lease_duration);
-
-                // Enviar el DHCPOFFER al cliente
-                sendto(udp_socket, offer_message, strlen(offer_message) + 1, 0, (struct sockaddr *)&client_addr, client_addr_len);
-                printf("\n---- OFERTA ENVIADA ----\n");
-                printf("Cliente IP: %s:%d\n", inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port));
-                printf("Mensaje: %s\n", offer_message);
-                printf("------------------------\n\n");
-            } else {
-                printf("No hay direcciones IP disponibles para ofrecer.\n");
-                log_message("WARNING", "No hay direcciones IP disponibles para ofrecer a un cliente.");
-
-                // Enviar mensaje al cliente indicando que no hay IPs disponibles
-                char noip_message[BUFFER_SIZE];
-                snprintf(noip_message, BUFFER_SIZE, "DHCPNOIP: No hay direcciones IP disponibles.");
-                sendto(udp_socket, noip_message, strlen(noip_message) + 1, 0, (struct sockaddr *)&client_addr, client_addr_len);
-            }
-        } else {
-            printf("No se pudo extraer la MAC del cliente en DHCPDISCOVER.\n");
-            log_message("ERROR", "No se pudo extraer la MAC del cliente en DHCPDISCOVER.");
-        }
-    } else if (strstr(buffer, "DHCPREQUEST")) {
-        
-        // Extraer la IP solicitada y la MAC del mensaje de DHCPREQUEST
-        char requested_ip[16] = {0};
-        char client_mac[18] = {0};
-
-        int parsed_fields = sscanf(buffer, "DHCPREQUEST: IP=%15[^;]; MAC %17s", requested_ip, client_mac);
-
-        if (parsed_fields == 2) {
-            printf("\n---- SOLICITUD RECIBIDA (DHCPREQUEST) ----\n");
-            printf("IP Solicitada: %s\n", requested_ip);
-            printf("MAC Cliente: %s\n", client_mac);
-            printf("------------------------------------------\n");
-
-            // Verificar si la IP solicitada está asignada al cliente
-            int found = 0;
-            lease_record* lease = NULL;
-            pthread_mutex_lock(&lease_table_mutex);
-            for (int i = 0; i < POOL_SIZE; ++i) {
-                if (lease_table[i].assigned &&
-                    strcmp(lease_table[i].ip, requested_ip) == 0 &&
-                    strcmp(lease_table[i].mac_address, client_mac) == 0) {
-                    lease = &lease_table[i];
-                    renew_lease(lease, lease_time);
-                    found = 1;
-                    break;
-                }
-            }
-            pthread_mutex_unlock(&lease_table_mutex);
-
-            if (found) {
-                // Construir el mensaje DHCPACK con la información adicional
-                char ack_message[BUFFER_SIZE];
-                snprintf(ack_message, BUFFER_SIZE,
-                    "DHCPACK: IP=%s; MASK=%s; GATEWAY=%s; DNS=%s; LEASE=%ld",
-                    lease->ip, lease->subnet_mask, lease->default_gateway,
-                    lease->dns_server, lease->lease_duration);
-
-                // Enviar el DHCPACK al cliente
-                sendto(udp_socket, ack_message, strlen(ack_message) + 1, 0, (struct sockaddr *)&client_addr, client_addr_len);
-                printf("\n---- CONFIRMACIÓN ENVIADA (DHCPACK) ----\n");
-                printf("IP Asignada: %s\n", lease->ip);
-                printf("MAC Cliente: %s\n", client_mac);
-                printf("Mensaje: %s\n", ack_message);
-                printf("------------------------------------------\n");
-            } else {
-                printf("La IP solicitada %s no está asignada a la MAC %s\n", requested_ip, client_mac);
-                log_message("WARNING", "La IP solicitada no está asignada al cliente.");
-
-                // Enviar DHCPNAK al cliente
-                char nak_message[BUFFER_SIZE];
-                snprintf(nak_message, BUFFER_SIZE, "DHCPNAK: Solicitud inválida para IP %s y MAC %s", requested_ip, client_mac);
-                sendto(udp_socket, nak_message, strlen(nak_message) + 1, 0, (struct sockaddr *)&client_addr, client_addr_len);
-                printf("\n---- DHCPNAK ENVIADO ----\n");
-                printf("IP Solicitada: %s\n", requested_ip);
-                printf("Mensaje: %s\n", nak_message);
-                printf("--------------------------\n\n");
-            }
-        } else {
-            printf("No se pudo extraer la IP o la MAC del cliente en DHCPREQUEST.\n");
-            log_message("ERROR", "No se pudo extraer la IP o la MAC del cliente en DHCPREQUEST.");
-        }
-    } else if (strstr(buffer, "DHCPRELEASE")) {
-        // Manejo del mensaje DHCPRELEASE
-        // Extraer la IP y MAC del cliente
-        char released_ip[16] = {0};
-        char client_mac[18] = {0};
-
-        int parsed_fields = sscanf(buffer, "DHCPRELEASE: IP=%15[^;]; MAC %17s", released_ip, client_mac);
-
-        if (parsed_fields == 2) {
-            // Liberar la IP
-            release_ip(released_ip, client_mac);
-            printf("IP liberada: %s por cliente %s\n", released_ip, client_mac);
-        } else {
-            printf("No se pudo extraer la IP o la MAC del cliente en DHCPRELEASE.\n");
-            log_message("ERROR", "No se pudo extraer la IP o la MAC del cliente en DHCPRELEASE.");
+// Fija un hilo a una CPU; los fallos solo se registran (el hilo sigue sin afinidad)
+static void pin_thread(pthread_t thread, int cpu) {
+    if (cpu < 0) {
+        return;
+    }
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    if (pthread_setaffinity_np(thread, sizeof(cpus), &cpus) != 0) {
+        log_message("WARNING", "No se pudo fijar un hilo a su CPU.");
+    }
+}
+
+// Socket UDP enlazado al puerto del servidor (67 salvo -P), opcionalmente con
+// SO_REUSEPORT para que varios sockets compartan el puerto y el kernel reparta
+// los datagramas
+static int open_server_socket(uint16_t port, int reuse_port) {
+    struct sockaddr_in server_addr;
+
+    // Configuración del servidor
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(port);
+    server_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    // Crear socket
+    int udp_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (udp_socket <= 0) {
+        perror("No se pudo crear el socket");
+        log_message("ERROR", "No se pudo crear el socket UDP.");
+        return -1;
+    }
+
+    int enable = 1;
+    if (reuse_port && setsockopt(udp_socket, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) < 0) {
+        perror("No se pudo activar SO_REUSEPORT");
+        log_message("ERROR", "No se pudo activar SO_REUSEPORT en el socket.");
+        close(udp_socket);
+        return -1;
+    }
+
+    // Bind del socket al puerto del servidor
+    if (bind(udp_socket, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
+        perror("No se pudo enlazar el socket");
+        log_message("ERROR", "No se pudo enlazar el socket al puerto del servidor.");
+        close(udp_socket);
+        return -1;
+    }
+    return udp_socket;
+}
+
+// Programa BPF clásico para el grupo SO_REUSEPORT: elige el socket con un
+// hash de la MAC del cliente (chaddr), así que todos los mensajes de un mismo
+// cliente llegan al mismo socket, cola y CPU. El kernel lo ejecuta con los
+// datos situados tras la cabecera UDP, es decir, sobre el mensaje DHCP.
+// Un datagrama demasiado corto hace que el programa retorne 0 (primer socket).
+static int attach_mac_hash(int udp_socket, unsigned int socket_count) {
+    enum { CHADDR = 28 };  // offsetof(dhcp_header, chaddr)
+    struct sock_filter code[] = {
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, CHADDR),         // A = mac[0..3]
+        BPF_STMT(BPF_MISC | BPF_TAX, 0),                    // X = A
+        BPF_STMT(BPF_LD | BPF_H | BPF_ABS, CHADDR + 4),     // A = mac[4..5]
+        BPF_STMT(BPF_ALU | BPF_XOR | BPF_X, 0),             // A ^= X
+        BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, socket_count),  // A %= sockets
+        BPF_STMT(BPF_RET | BPF_A, 0)
+    };
+    struct sock_fprog program = {sizeof(code) / sizeof(code[0]), code};
+    if (setsockopt(udp_socket, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &program, sizeof(program)) < 0) {
+        perror("No se pudo instalar el programa BPF de afinidad por MAC");
+        log_message("WARNING", "No se pudo instalar el programa BPF de afinidad por MAC; el kernel repartirá por 4-tupla.");
+        return -1;
+    }
+    return 0;
+}
+
+// Etiquetas pool="i",subnet="red/prefijo" de cada pool para las métricas. Las
+// subredes no cambian con una recarga, así que se calculan una vez al arrancar.
+static char (*pool_labels)[64] = NULL;
+
+static int build_pool_labels(const network_config* config) {
+    pool_labels = calloc(config->subnet_count, sizeof(*pool_labels));
+    if (pool_labels == NULL) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < config->subnet_count; ++i) {
+        char network[INET_ADDRSTRLEN];
+        snprintf(pool_labels[i], sizeof(pool_labels[i]), "pool=\"%u\",subnet=\"%s/%u\"", i,
+                 lease_address_string(config->subnets[i].network, network), config->subnets[i].prefix_length);
+    }
+    return 0;
+}
+
+// Ocupación de cada pool, calculada al leer las métricas
+static void collect_pool_metrics(FILE* out, void* arg) {
+    (void)arg;
+    uint32_t pools = lease_pool_count();
+    metrics_write_header(out, "dhcp_server_pool_addresses", "Direcciones de cada pool.", "gauge");
+    for (uint32_t i = 0; i < pools; ++i) {
+        uint32_t size, available;
+        if (lease_pool_usage(i, &size, &available) == 0) {
+            metrics_write_sample(out, "dhcp_server_pool_addresses", pool_labels[i], size);
         }
-    } else if (strstr(buffer, "DHCPDECLINE")) {
-        // Manejo del mensaje DHCPDECLINE
-        char declined_ip[16] = {0};
-        char client_mac[18] = {0};
-
-        int parsed_fields = sscanf(buffer, "DHCPDECLINE: IP=%15[^;]; MAC %17s", declined_ip, client_mac);
-        if (parsed_fields == 2) {
-            handle_decline(declined_ip, client_mac);
-        } else {
-            printf("No se pudo extraer la IP o la MAC del cliente en DHCPDECLINE.\n");
-            log_message("ERROR", "No se pudo extraer la IP o la MAC del cliente en DHCPDECLINE.");
+    }
+    metrics_write_header(out, "dhcp_server_pool_in_use",
+                         "Direcciones de cada pool con lease, oferta, reserva o en cuarentena.", "gauge");
+    for (uint32_t i = 0; i < pools; ++i) {
+        uint32_t size, available;
+        if (lease_pool_usage(i, &size, &available) == 0) {
+            metrics_write_sample(out, "dhcp_server_pool_in_use", pool_labels[i], size - available);
         }
-    } else {
-        printf("Mensaje no reconocido: %s\n", buffer);
     }
+}
 
-    free(request);  // Liberar la memoria asignada para la solicitud
-    pthread_exit(NULL);  // Terminar el hilo
+// Grupos de sockets cuyas colas se publican en las métricas
+static socket_group* metric_groups = NULL;
+static int metric_group_count = 0;
+
+// Profundidad y descartes de la cola de cada grupo (toma el mutex de la cola
+// al leer, no al recibir)
+static void collect_queue_metrics(FILE* out, void* arg) {
+    (void)arg;
+    queue_stats stats[MAX_SERVER_SOCKETS];
+    char labels[MAX_SERVER_SOCKETS][32];
+    for (int g = 0; g < metric_group_count; ++g) {
+        request_queue_get_stats(&metric_groups[g].queue, &stats[g]);
+        snprintf(labels[g], sizeof(labels[g]), "socket=\"%d\"", g);
+    }
+    metrics_write_header(out, "dhcp_server_queue_depth", "Solicitudes esperando un worker.", "gauge");
+    for (int g = 0; g < metric_group_count; ++g) {
+        metrics_write_sample(out, "dhcp_server_queue_depth", labels[g], stats[g].depth);
+    }
+    metrics_write_header(out, "dhcp_server_queue_capacity", "Slots de la cola de solicitudes.", "gauge");
+    for (int g = 0; g < metric_group_count; ++g) {
+        metrics_write_sample(out, "dhcp_server_queue_capacity", labels[g], stats[g].capacity);
+    }
+    metrics_write_header(out, "dhcp_server_queue_high_watermark", "Profundidad máxima alcanzada por la cola.", "gauge");
+    for (int g = 0; g < metric_group_count; ++g) {
+        metrics_write_sample(out, "dhcp_server_queue_high_watermark", labels[g], stats[g].high_watermark);
+    }
+    metrics_write_header(out, "dhcp_server_queue_dropped_total", "Datagramas descartados por cola llena.", "counter");
+    for (int g = 0; g < metric_group_count; ++g) {
+        metrics_write_sample(out, "dhcp_server_queue_dropped_total", labels[g], stats[g].dropped);
+    }
+}
+
+void print_usage(const char* program) {
+    printf("Uso: %s [-w hilos] [-q tamaño_cola] [-p drop|block] [-n máximo_por_pool] [-s shards] [-j ruta_leases|none] [-m archivo_tabla] [-b lote] [-r sockets [-a]] [-P puerto] [-M socket_métricas] <IP inicio> <IP fin> <archivo de configuración>\n", program);
 }
 
 int main(int argc, char *argv[]) {
-    if (argc != 4) {
-        printf("Uso: %s <IP inicio> <IP fin> <archivo de configuración>\n", argv[0]);
+    // Las señales se bloquean antes de crear cualquier hilo, así que solo las
+    // recibe el hilo principal (se desbloquean al entrar en el bucle de recepción)
+    sigset_t handled_signals;
+    sigemptyset(&handled_signals);
+    sigaddset(&handled_signals, SIGHUP);
+    sigaddset(&handled_signals, SIGINT);
+    sigaddset(&handled_signals, SIGTERM);
+    sigaddset(&handled_signals, SIGUSR1);
+    sigset_t original_mask;
+    pthread_sigmask(SIG_BLOCK, &handled_signals, &original_mask);
+
+    dhcp_log_init(LOG_FILE, 0);
+    if (server_metrics_init() != 0) {
+        printf("No se pudieron crear los contadores de métricas.\n");
+        return EXIT_FAILURE;
+    }
+
+    int num_workers = DEFAULT_WORKERS;
+    int queue_size = DEFAULT_QUEUE_SIZE;
+    queue_policy policy = QUEUE_POLICY_DROP;
+    long max_pool_size = 0;  // 0 = cada pool con todo su rango
+    int num_shards = 0;  // 0 = un shard por CPU
+    const char* lease_db = LEASE_DB_FILE;
+    const char* lease_map = NULL;
+    int reuse_port = 0;    // -r: un socket SO_REUSEPORT por núcleo
+    int num_sockets = 1;   // Con -r, 0 = uno por CPU
+    int mac_affinity = 0;  // -a: repartir entre sockets por hash de la MAC
+    long server_port = DHCP_SERVER_PORT;  // -P: otro puerto, p. ej. sin privilegios en pruebas
+    const char* metrics_path = NULL;      // -M: socket Unix donde se publican las métricas
+
+    int opt;
+    while ((opt = getopt(argc, argv, "w:q:p:n:s:j:m:b:r:aP:M:")) != -1) {
+        switch (opt) {
+            case 'w':
+                num_workers = atoi(optarg);
+                break;
+            case 'q':
+                queue_size = atoi(optarg);
+                break;
+            case 'p':
+                if (strcmp(optarg, "drop") == 0) {
+                    policy = QUEUE_POLICY_DROP;
+                } else if (strcmp(optarg, "block") == 0) {
+                    policy = QUEUE_POLICY_BLOCK;
+                } else {
+                    print_usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'n':
+                max_pool_size = atol(optarg);
+                break;
+            case 's':
+                num_shards = atoi(optarg);
+                break;
+            case 'j':
+                lease_db = optarg;
+                break;
+            case 'm':
+                lease_map = optarg;
+                break;
+            case 'b':
+                io_batch = atoi(optarg);
+                break;
+            case 'r':
+                reuse_port = 1;
+                num_sockets = atoi(optarg);
+                break;
+            case 'a':
+                mac_affinity = 1;
+                break;
+            case 'P':
+                server_port = atol(optarg);
+                break;
+            case 'M':
+                metrics_path = optarg;
+                break;
+            default:
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (argc - optind != 3) {
+        print_usage(argv[0]);
         log_message("ERROR", "Uso incorrecto del servidor DHCP. Se requieren las IP de inicio, fin y el archivo de configuración.");
         return EXIT_FAILURE;
     }
+    if (num_workers <= 0 || queue_size <= 0) {
+        printf("El número de hilos y el tamaño de la cola deben ser mayores que 0.\n");
+        log_message("ERROR", "Número de hilos o tamaño de cola inválido.");
+        return EXIT_FAILURE;
+    }
+    if (max_pool_size < 0 || max_pool_size > (long)MAX_POOL_SIZE) {
+        printf("El tamaño máximo de cada pool debe estar entre 0 (sin límite) y %u.\n", MAX_POOL_SIZE);
+        log_message("ERROR", "Tamaño máximo del pool inválido.");
+        return EXIT_FAILURE;
+    }
+    if (io_batch <= 0 || io_batch > MAX_IO_BATCH) {
+        printf("El tamaño del lote de E/S debe estar entre 1 y %d.\n", MAX_IO_BATCH);
+        log_message("ERROR", "Tamaño del lote de E/S inválido.");
+        return EXIT_FAILURE;
+    }
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) {
+        cpus = 1;
+    }
+    if (reuse_port && num_sockets == 0) {
+        num_sockets = cpus < MAX_SERVER_SOCKETS ? (int)cpus : MAX_SERVER_SOCKETS;
+    }
+    if (num_sockets <= 0 || num_sockets > MAX_SERVER_SOCKETS) {
+        printf("El número de sockets debe estar entre 0 (uno por CPU) y %d.\n", MAX_SERVER_SOCKETS);
+        log_message("ERROR", "Número de sockets SO_REUSEPORT inválido.");
+        return EXIT_FAILURE;
+    }
+    if (mac_affinity && !reuse_port) {
+        printf("La afinidad por MAC (-a) requiere varios sockets (-r).\n");
+        log_message("ERROR", "La opción -a requiere -r.");
+        return EXIT_FAILURE;
+    }
+    if (server_port < 1 || server_port > 65535) {
+        printf("El puerto del servidor debe estar entre 1 y 65535.\n");
+        log_message("ERROR", "Puerto del servidor inválido.");
+        return EXIT_FAILURE;
+    }
+    if (num_shards < 0 || num_shards > MAX_LEASE_SHARDS) {
+        printf("El número de shards debe estar entre 0 (automático) y %d.\n", MAX_LEASE_SHARDS);
+        log_message("ERROR", "Número de shards inválido.");
+        return EXIT_FAILURE;
+    }
 
-    char subnet_mask[16] = {0};
-    char default_gateway[16] = {0};
-    char dns_server[16] = {0};
-    int lease_time = 3600; // Valor por defecto
+    const char* ip_start = argv[optind];
+    const char* ip_end = argv[optind + 1];
+    const char* config_file = argv[optind + 2];
+    struct in_addr start_addr, end_addr;
+    if (inet_pton(AF_INET, ip_start, &start_addr) <= 0 || inet_pton(AF_INET, ip_end, &end_addr) <= 0) {
+        printf("Las IP de inicio y fin deben ser direcciones IPv4 válidas.\n");
+        log_message("ERROR", "Dirección IP de inicio o fin inválida.");
+        return EXIT_FAILURE;
+    }
 
-    // Cargar la configuración de red
-    if (load_network_config(argv[3], subnet_mask, default_gateway, dns_server, &lease_time) != 0) {
+    // Cargar la configuración de red una sola vez; SIGHUP la vuelve a leer
+    if (config_init(config_file, ntohl(start_addr.s_addr), ntohl(end_addr.s_addr)) != 0) {
         printf("Error al cargar la configuración de red.\n");
         log_message("ERROR", "Error al cargar la configuración de red.");
         return EXIT_FAILURE;
     }
 
-    // Verificar que lease_time no sea 0
-    if (lease_time <= 0) {
-        printf("El tiempo de lease es inválido. Asegúrate de que 'LEASE_TIME' esté definido correctamente en el archivo de configuración.\n");
-        log_message("ERROR", "El tiempo de lease es inválido.");
+    printf("Lease Time cargado: %d segundos\n", config_current()->lease_time);
+
+    // SIGHUP sin SA_RESTART para que recvfrom retorne y la recarga no espere al siguiente paquete
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_sighup;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGHUP, &sa, NULL);
+    sa.sa_handler = handle_shutdown;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    sa.sa_handler = handle_sigusr1;
+    sigaction(SIGUSR1, &sa, NULL);
+
+    if (lease_map != NULL) {
+        set_lease_map_file(lease_map);
+    }
+    // Un pool por subred; el identificador de cada pool es el índice de su subred
+    const network_config* config = config_current();
+    lease_range* ranges = malloc(config->subnet_count * sizeof(lease_range));
+    if (ranges == NULL) {
         return EXIT_FAILURE;
     }
-
-    printf("Lease Time cargado: %d segundos\n", lease_time);
-
-    int pool_size = generate_ip_pool(argv[1], argv[2]);
+    for (uint32_t i = 0; i < config->subnet_count; ++i) {
+        ranges[i].start = config->subnets[i].range_start;
+        ranges[i].end = config->subnets[i].range_end;
+    }
+    int pool_size = generate_ip_pools(ranges, config->subnet_count, (uint32_t)max_pool_size, (uint32_t)num_shards);
+    free(ranges);
     if (pool_size < 0) {
         printf("Error al generar el pool de IPs.\n");
         log_message("ERROR", "Error al generar el pool de IPs.");
         return EXIT_FAILURE;
     }
 
-    printf("Servidor DHCP inicializado con el rango de IPs de %s a %s\n", argv[1], argv[2]);
+    // Recuperar los leases del snapshot y el journal, y seguir registrando en el journal
+    if (strcmp(lease_db, "none") != 0) {
+        lease_journal_configure(lease_db);
+        // Una tabla mapeada cerrada limpiamente ya tiene el estado final del journal
+        long recovered = lease_table_resumed() ? 0 : recover_leases();
+        if (recovered < 0) {
+            printf("No se pudieron recuperar los leases guardados.\n");
+            log_message("ERROR", "No se pudieron recuperar los leases guardados.");
+            return EXIT_FAILURE;
+        }
+        if (lease_journal_start(write_lease_snapshot, NULL) != 0) {
+            printf("No se pudo abrir el journal de leases; los leases solo se guardarán en memoria.\n");
+            log_message("WARNING", "No se pudo abrir el journal de leases; los leases solo se guardarán en memoria.");
+        } else if (recovered > 0) {
+            // Empezar con un snapshot al día y un journal vacío
+            lease_journal_request_compaction();
+        }
+    }
 
-    struct sockaddr_in server_addr;
+    // Las direcciones reservadas salen del conjunto de libres antes de atender solicitudes
+    update_lease_reservations(NULL, 0, config->reservations.addresses, config->reservations.count);
+    if (config->reservations.count > 0) {
+        printf("Reservas estáticas cargadas: %u\n", config->reservations.count);
+    }
 
-    // Configuración del servidor
-    memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_port = htons(67);  // Puerto DHCP para el servidor
-    server_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    // Los vencimientos de leases y cuarentenas los procesa un hilo propio
+    if (start_lease_expiry() != 0) {
+        printf("No se pudo iniciar el hilo de expiración de leases.\n");
+        log_message("ERROR", "No se pudo iniciar el hilo de expiración de leases.");
+        return EXIT_FAILURE;
+    }
 
-    // Crear socket
-    int udp_socket = socket(AF_INET, SOCK_DGRAM, 0);
-    if (udp_socket <= 0) {
-        perror("No se pudo crear el socket");
-        log_message("ERROR", "No se pudo crear el socket UDP.");
+    printf("Servidor DHCP inicializado con el rango de IPs de %s a %s, %u subredes y %d direcciones (%u shards)\n",
+           ip_start, ip_end, lease_pool_count(), pool_size, lease_shard_count());
+
+    // Respuestas recientes para contestar las retransmisiones (RETRANSMIT_WINDOW)
+    if (reply_cache_init() != 0) {
+        printf("No se pudo crear la caché de respuestas.\n");
+        log_message("ERROR", "No se pudo crear la caché de respuestas.");
         return EXIT_FAILURE;
     }
 
-    // Bind del socket al puerto 67
-    if (bind(udp_socket, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
-        perror("No se pudo enlazar el socket");
-        log_message("ERROR", "No se pudo enlazar el socket al puerto 67.");
-        close(udp_socket);
+    // Manejadores de cada tipo de mensaje DHCP
+    dispatch_register(DHCPDISCOVER, handle_discover);
+    dispatch_register(DHCPREQUEST, handle_request);
+    dispatch_register(DHCPRELEASE, handle_release);
+    dispatch_register(DHCPDECLINE, handle_decline_message);
+
+    // Un grupo (socket, cola acotada con slots preasignados y workers) por
+    // socket. Con -r los workers se reparten entre los grupos y cada grupo
+    // se fija a una CPU junto con su hilo receptor.
+    socket_group* groups = calloc((size_t)num_sockets, sizeof(socket_group));
+    if (groups == NULL) {
+        printf("No se pudo crear la cola de solicitudes.\n");
+        log_message("ERROR", "No se pudo crear la cola de solicitudes.");
         return EXIT_FAILURE;
     }
+    int workers_per_group = (num_workers + num_sockets - 1) / num_sockets;
+
+    for (int g = 0; g < num_sockets; ++g) {
+        socket_group* group = &groups[g];
+        group->cpu = reuse_port ? (int)(g % cpus) : -1;
+        group->udp_socket = open_server_socket((uint16_t)server_port, reuse_port);
+        if (group->udp_socket < 0) {
+            return EXIT_FAILURE;
+        }
+        if (request_queue_init(&group->queue, queue_size, policy) != 0) {
+            printf("No se pudo crear la cola de solicitudes.\n");
+            log_message("ERROR", "No se pudo crear la cola de solicitudes.");
+            close(group->udp_socket);
+            return EXIT_FAILURE;
+        }
 
-    printf("Servidor DHCP escuchando en el puerto 67...\n");
+        group->workers = calloc((size_t)workers_per_group, sizeof(pthread_t));
+        if (group->workers == NULL) {
+            printf("No se pudo crear la cola de solicitudes.\n");
+            log_message("ERROR", "No se pudo crear la cola de solicitudes.");
+            close(group->udp_socket);
+            return EXIT_FAILURE;
+        }
+        for (int i = 0; i < workers_per_group; ++i) {
+            if (pthread_create(&group->workers[i], NULL, worker_loop, &group->queue) != 0) {
+                perror("No se pudo crear el hilo worker");
+                log_message("ERROR", "No se pudo crear el hilo worker.");
+                close(group->udp_socket);
+                return EXIT_FAILURE;
+            }
+            pin_thread(group->workers[i], group->cpu);
+            group->worker_count++;
+        }
+    }
 
-    // Loop para recibir mensajes de clientes
-    while (1) {
-        check_expired_leases(); // Verificar y liberar leases expirados
+    // El programa BPF se instala en un socket y rige para todo el grupo; el
+    // índice que devuelve es el orden en que se enlazaron los sockets
+    if (mac_affinity) {
+        attach_mac_hash(groups[0].udp_socket, (unsigned int)num_sockets);
+    }
 
-        client_request* request = malloc(sizeof(client_request));
-        if (request == NULL) {
-            perror("No se pudo asignar memoria para la solicitud del cliente");
-            continue;
+    if (metrics_path != NULL) {
+        metric_groups = groups;
+        metric_group_count = num_sockets;
+        if (build_pool_labels(config) != 0 || metrics_add_collector(collect_pool_metrics, NULL) != 0 ||
+            metrics_add_collector(collect_queue_metrics, NULL) != 0 || metrics_start(metrics_path) != 0) {
+            perror("No se pudo abrir el socket de métricas");
+            log_message("ERROR", "No se pudo abrir el socket de métricas.");
+            return EXIT_FAILURE;
         }
+        printf("Métricas disponibles en el socket %s\n", metrics_path);
+    }
 
-        request->udp_socket = udp_socket;
-        request->client_addr_len = sizeof(request->client_addr);
-        int bytes_received = recvfrom(udp_socket, request->buffer, BUFFER_SIZE, 0, (struct sockaddr *)&request->client_addr, &request->client_addr_len);
-
-        if (bytes_received > 0) {
-            request->buffer[bytes_received] = '\0'; // Asegurarse de que el buffer es un string válido
-            printf("Mensaje recibido de %s:%d -- %s\n", inet_ntoa(request->client_addr.sin_addr), ntohs(request->client_addr.sin_port), request->buffer);
-
-            // Crear un hilo para manejar la solicitud del cliente
-            pthread_t thread_id;
-            if (pthread_create(&thread_id, NULL, handle_client, (void*)request) != 0) {
-                perror("No se pudo crear el hilo para manejar la solicitud del cliente");
-                free(request);
-            } else {
-                pthread_detach(thread_id); // Desvincular el hilo para que libere sus recursos al terminar
+    if (reuse_port) {
+        for (int g = 0; g < num_sockets; ++g) {
+            if (pthread_create(&groups[g].receiver, NULL, receiver_loop, &groups[g]) != 0) {
+                perror("No se pudo crear el hilo receptor");
+                log_message("ERROR", "No se pudo crear el hilo receptor.");
+                return EXIT_FAILURE;
             }
-        } else {
-            perror("No se pudo recibir el mensaje");
-            log_message("ERROR", "No se pudo recibir el mensaje del cliente.");
-            free(request);
+            pin_thread(groups[g].receiver, groups[g].cpu);
+        }
+        printf("Servidor DHCP escuchando en el puerto %ld con %d sockets SO_REUSEPORT%s (%d workers por socket, cola de %d, política %s, lotes de %d)...\n",
+               server_port, num_sockets, mac_affinity ? " y afinidad por MAC" : "", workers_per_group, queue_size,
+               policy == QUEUE_POLICY_DROP ? "drop" : "block", io_batch);
+    } else {
+        printf("Servidor DHCP escuchando en el puerto %ld (%d workers, cola de %d, política %s, lotes de %d)...\n",
+               server_port, num_workers, queue_size, policy == QUEUE_POLICY_DROP ? "drop" : "block", io_batch);
+    }
+
+    if (reuse_port) {
+        // Los receptores tienen las señales bloqueadas: el hilo principal solo
+        // espera señales y atiende recargas y estadísticas
+        while (!shutdown_requested) {
+            apply_pending_reload();
+            if (stats_requested) {
+                stats_requested = 0;
+                dispatch_report_stats();
+                report_lease_stats();
+            }
+            if (!shutdown_requested && !reload_requested && !stats_requested) {
+                sigsuspend(&original_mask);
+            }
+        }
+    } else {
+        pthread_sigmask(SIG_UNBLOCK, &handled_signals, NULL);
+
+        // Loop para recibir mensajes de clientes
+        while (!shutdown_requested) {
+            apply_pending_reload();  // Aplicar una recarga pedida con SIGHUP
+            if (stats_requested) {
+                stats_requested = 0;
+                dispatch_report_stats();
+                report_lease_stats();
+            }
+            receive_next(&groups[0]);
         }
     }
 
-    close(udp_socket);
+    // Primero se detienen los receptores (con -r): shutdown despierta al que
+    // espera en recvfrom/recvmmsg. Después se cierran las colas y los workers
+    // terminan lo pendiente; solo entonces se bloquea la tabla y se marca el
+    // archivo mapeado como consistente.
+    printf("Deteniendo el servidor DHCP...\n");
+    if (reuse_port) {
+        atomic_store(&receivers_stopping, 1);
+        for (int g = 0; g < num_sockets; ++g) {
+            shutdown(groups[g].udp_socket, SHUT_RD);
+        }
+        for (int g = 0; g < num_sockets; ++g) {
+            pthread_join(groups[g].receiver, NULL);
+        }
+    }
+    for (int g = 0; g < num_sockets; ++g) {
+        request_queue_close(&groups[g].queue);
+        for (int i = 0; i < groups[g].worker_count; ++i) {
+            pthread_join(groups[g].workers[i], NULL);
+        }
+    }
+    log_message("INFO", "Servidor DHCP detenido.");
+    dispatch_report_stats();
+    report_lease_stats();
+    metrics_stop();
+    close_ip_pool();
+    for (int g = 0; g < num_sockets; ++g) {
+        request_queue_destroy(&groups[g].queue);
+        free(groups[g].workers);
+        close(groups[g].udp_socket);
+    }
+    free(groups);
 
     return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -0,0 +1,10 @@
+#ifndef DHCP_SERVER_H
+#define DHCP_SERVER_H
+
+#define BUFFER_SIZE 1024
+#define LOG_FILE "./server/dhcp_server.log"
+
+// Función para escribir mensajes en el log (definida en dhcp_server.c)
+void log_message(const char* level, const char* message);
+
+#endif
@@ -0,0 +1,118 @@
+#include "expiry_heap.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+int expiry_heap_init(expiry_heap* heap, size_t capacity) {
+    memset(heap, 0, sizeof(*heap));
+    heap->entries = malloc(capacity * sizeof(expiry_entry));
+    heap->slots = malloc(capacity * sizeof(uint32_t));
+    if (heap->entries == NULL || heap->slots == NULL) {
+        expiry_heap_destroy(heap);
+        return -1;
+    }
+    for (size_t i = 0; i < capacity; ++i) {
+        heap->slots[i] = EXPIRY_HEAP_NONE;
+    }
+    heap->capacity = capacity;
+    return 0;
+}
+
+void expiry_heap_destroy(expiry_heap* heap) {
+    free(heap->entries);
+    free(heap->slots);
+    memset(heap, 0, sizeof(*heap));
+}
+
+// Coloca la entrada en el índice 'i' y actualiza su posición en slots
+static inline void place(expiry_heap* heap, size_t i, expiry_entry entry) {
+    heap->entries[i] = entry;
+    heap->slots[entry.position] = (uint32_t)i;
+}
+
+static void sift_up(expiry_heap* heap, size_t i) {
+    expiry_entry entry = heap->entries[i];
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (heap->entries[parent].expiry <= entry.expiry) {
+            break;
+        }
+        place(heap, i, heap->entries[parent]);
+        i = parent;
+    }
+    place(heap, i, entry);
+}
+
+static void sift_down(expiry_heap* heap, size_t i) {
+    expiry_entry entry = heap->entries[i];
+    while (1) {
+        size_t child = 2 * i + 1;
+        if (child >= heap->count) {
+            break;
+        }
+        if (child + 1 < heap->count && heap->entries[child + 1].expiry < heap->entries[child].expiry) {
+            child++;
+        }
+        if (entry.expiry <= heap->entries[child].expiry) {
+            break;
+        }
+        place(heap, i, heap->entries[child]);
+        i = child;
+    }
+    place(heap, i, entry);
+}
+
+void expiry_heap_update(expiry_heap* heap, uint32_t position, uint32_t expiry) {
+    uint32_t slot = heap->slots[position];
+    if (slot == EXPIRY_HEAP_NONE) {
+        place(heap, heap->count, (expiry_entry){expiry, position});
+        sift_up(heap, heap->count++);
+        return;
+    }
+
+    uint32_t previous = heap->entries[slot].expiry;
+    heap->entries[slot].expiry = expiry;
+    if (expiry < previous) {
+        sift_up(heap, slot);
+    } else {
+        sift_down(heap, slot);
+    }
+}
+
+void expiry_heap_remove(expiry_heap* heap, uint32_t position) {
+    uint32_t slot = heap->slots[position];
+    if (slot == EXPIRY_HEAP_NONE) {
+        return;
+    }
+    heap->slots[position] = EXPIRY_HEAP_NONE;
+    heap->count--;
+    if (slot == heap->count) {
+        return;  // Era la última entrada
+    }
+
+    // Mover la última entrada al hueco y restaurar el orden en la dirección que toque
+    expiry_entry last = heap->entries[heap->count];
+    place(heap, slot, last);
+    if (slot > 0 && heap->entries[(slot - 1) / 2].expiry > last.expiry) {
+        sift_up(heap, slot);
+    } else {
+        sift_down(heap, slot);
+    }
+}
+
+int expiry_heap_peek(const expiry_heap* heap, uint32_t* expiry) {
+    if (heap->count == 0) {
+        return -1;
+    }
+    *expiry = heap->entries[0].expiry;
+    return 0;
+}
+
+long expiry_heap_pop_expired(expiry_heap* heap, uint32_t now) {
+    if (heap->count == 0 || heap->entries[0].expiry > now) {
+        return -1;
+    }
+    uint32_t position = heap->entries[0].position;
+    expiry_heap_remove(heap, position);
+    return position;
+}
@@ -0,0 +1,40 @@
+#ifndef EXPIRY_HEAP_H
+#define EXPIRY_HEAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Min-heap indexado de posiciones del pool ordenado por instante de
+// vencimiento (segundos desde epoch). Cada posición está a lo sumo una vez y
+// 'slots' guarda dónde está dentro del heap, así que cambiar o quitar el
+// vencimiento de una posición cuesta O(log n) sin buscarla.
+typedef struct {
+    uint32_t expiry;
+    uint32_t position;
+} expiry_entry;
+
+typedef struct {
+    expiry_entry* entries;
+    uint32_t* slots;   // slots[posición] = índice en entries, o EXPIRY_HEAP_NONE
+    size_t capacity;   // Número de posiciones del pool
+    size_t count;
+} expiry_heap;
+
+#define EXPIRY_HEAP_NONE UINT32_MAX
+
+int expiry_heap_init(expiry_heap* heap, size_t capacity);
+void expiry_heap_destroy(expiry_heap* heap);
+
+// Inserta la posición o cambia su vencimiento si ya estaba en el heap
+void expiry_heap_update(expiry_heap* heap, uint32_t position, uint32_t expiry);
+
+// Quita la posición si está en el heap
+void expiry_heap_remove(expiry_heap* heap, uint32_t position);
+
+// Retorna 0 y escribe el vencimiento más próximo, -1 si el heap está vacío
+int expiry_heap_peek(const expiry_heap* heap, uint32_t* expiry);
+
+// Saca la siguiente posición vencida en 'now'. Retorna -1 si no hay ninguna.
+long expiry_heap_pop_expired(expiry_heap* heap, uint32_t now);
+
+#endif
@@ -0,0 +1,171 @@
+#include "ip_allocator.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+int ip_allocator_init(ip_allocator* allocator, size_t size) {
+    memset(allocator, 0, sizeof(*allocator));
+    if (size == 0) {
+        return -1;
+    }
+
+    // Dimensionar los niveles hasta que el superior quepa en una sola palabra
+    size_t bits = size;
+    do {
+        size_t words = (bits + 63) / 64;
+        if (allocator->depth == IP_ALLOCATOR_MAX_LEVELS) {
+            ip_allocator_destroy(allocator);
+            return -1;
+        }
+        allocator->levels[allocator->depth] = calloc(words, sizeof(uint64_t));
+        if (allocator->levels[allocator->depth] == NULL) {
+            ip_allocator_destroy(allocator);
+            return -1;
+        }
+        allocator->words[allocator->depth] = words;
+        allocator->depth++;
+        bits = words;
+    } while (bits > 1);
+
+    allocator->size = size;
+    for (size_t position = 0; position < size; ++position) {
+        ip_allocator_free(allocator, position);
+    }
+    return 0;
+}
+
+void ip_allocator_destroy(ip_allocator* allocator) {
+    for (int level = 0; level < allocator->depth; ++level) {
+        free(allocator->levels[level]);
+    }
+    memset(allocator, 0, sizeof(*allocator));
+}
+
+// Marca la posición como ocupada y limpia los resúmenes que queden vacíos
+static void clear_bit(ip_allocator* allocator, size_t position) {
+    for (int level = 0; level < allocator->depth; ++level) {
+        uint64_t* word = &allocator->levels[level][position / 64];
+        *word &= ~(1ULL << (position % 64));
+        if (*word != 0) {
+            break;  // La palabra aún tiene libres: los niveles superiores no cambian
+        }
+        position /= 64;
+    }
+}
+
+long ip_allocator_take_first(ip_allocator* allocator) {
+    if (allocator->free_count == 0) {
+        return -1;
+    }
+
+    // Descender desde el nivel superior siguiendo el primer bit en 1 de cada palabra
+    size_t position = 0;
+    for (int level = allocator->depth - 1; level >= 0; --level) {
+        uint64_t word = allocator->levels[level][position];
+        if (word == 0) {
+            return -1;
+        }
+        position = position * 64 + (size_t)__builtin_ctzll(word);
+    }
+
+    clear_bit(allocator, position);
+    allocator->free_count--;
+    return (long)position;
+}
+
+// Primera posición libre a partir de 'from': se sube de nivel mientras el
+// resto de la palabra esté vacío y se baja por el primer bit en 1
+static long find_free_from(const ip_allocator* allocator, size_t from) {
+    if (from >= allocator->size) {
+        return -1;
+    }
+    size_t position = from;
+    int level = 0;
+    while (1) {
+        size_t word_index = position / 64;
+        if (word_index >= allocator->words[level]) {
+            return -1;
+        }
+        uint64_t word = allocator->levels[level][word_index] & (~0ULL << (position % 64));
+        if (word != 0) {
+            position = word_index * 64 + (size_t)__builtin_ctzll(word);
+            break;
+        }
+        if (level == allocator->depth - 1) {
+            return -1;
+        }
+        position = word_index + 1;  // Siguiente palabra, vista desde el nivel superior
+        level++;
+    }
+    while (level > 0) {
+        level--;
+        position = position * 64 + (size_t)__builtin_ctzll(allocator->levels[level][position]);
+    }
+    return (long)position;
+}
+
+long ip_allocator_take_first_in(ip_allocator* allocator, size_t low, size_t high) {
+    if (allocator->free_count == 0) {
+        return -1;
+    }
+    long position = find_free_from(allocator, low);
+    if (position < 0 || (size_t)position >= high) {
+        return -1;
+    }
+    clear_bit(allocator, (size_t)position);
+    allocator->free_count--;
+    return position;
+}
+
+int ip_allocator_is_free(const ip_allocator* allocator, size_t position) {
+    if (position >= allocator->size) {
+        return 0;
+    }
+    return (allocator->levels[0][position / 64] >> (position % 64)) & 1;
+}
+
+int ip_allocator_take(ip_allocator* allocator, size_t position) {
+    if (!ip_allocator_is_free(allocator, position)) {
+        return -1;
+    }
+    clear_bit(allocator, position);
+    allocator->free_count--;
+    return 0;
+}
+
+void ip_allocator_free(ip_allocator* allocator, size_t position) {
+    if (position >= allocator->size || ip_allocator_is_free(allocator, position)) {
+        return;
+    }
+    for (int level = 0; level < allocator->depth; ++level) {
+        uint64_t* word = &allocator->levels[level][position / 64];
+        int was_empty = (*word == 0);
+        *word |= 1ULL << (position % 64);
+        if (!was_empty) {
+            break;  // El resumen del nivel superior ya estaba en 1
+        }
+        position /= 64;
+    }
+    allocator->free_count++;
+}
+
+size_t ip_allocator_count_free_in(const ip_allocator* allocator, size_t low, size_t high) {
+    if (high > allocator->size) {
+        high = allocator->size;
+    }
+    if (low == 0 && high == allocator->size) {
+        return allocator->free_count;
+    }
+    size_t count = 0;
+    while (low < high) {
+        // Bits [low, min(high, fin de la palabra)) de la palabra de 'low'
+        size_t end = (low / 64 + 1) * 64 < high ? (low / 64 + 1) * 64 : high;
+        uint64_t word = allocator->levels[0][low / 64] >> (low % 64);
+        if (end - low < 64) {
+            word &= (1ULL << (end - low)) - 1;
+        }
+        count += (size_t)__builtin_popcountll(word);
+        low = end;
+    }
+    return count;
+}
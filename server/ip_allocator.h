@@ -0,0 +1,43 @@
+#ifndef IP_ALLOCATOR_H
+#define IP_ALLOCATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define IP_ALLOCATOR_MAX_LEVELS 6  // 64^6 posiciones, más que suficiente para IPv4
+
+// Conjunto de posiciones libres del pool como bitmap jerárquico de 64 vías:
+// en el nivel 0 cada bit es una dirección (1 = libre) y en cada nivel superior
+// un bit indica que la palabra correspondiente del nivel inferior tiene algún
+// bit en 1. Encontrar la primera dirección libre cuesta una búsqueda de bit
+// (ctz) por nivel, O(log64 n), a partir de cualquier posición.
+typedef struct {
+    uint64_t* levels[IP_ALLOCATOR_MAX_LEVELS];
+    size_t words[IP_ALLOCATOR_MAX_LEVELS];
+    int depth;
+    size_t size;
+    size_t free_count;
+} ip_allocator;
+
+// Crea el conjunto con 'size' posiciones, todas libres
+int ip_allocator_init(ip_allocator* allocator, size_t size);
+void ip_allocator_destroy(ip_allocator* allocator);
+
+// Toma la posición libre más baja. Retorna -1 si no hay ninguna.
+long ip_allocator_take_first(ip_allocator* allocator);
+
+// Toma la posición libre más baja dentro de [low, high). Retorna -1 si no hay ninguna.
+long ip_allocator_take_first_in(ip_allocator* allocator, size_t low, size_t high);
+
+// Toma una posición concreta. Retorna -1 si no estaba libre.
+int ip_allocator_take(ip_allocator* allocator, size_t position);
+
+// Devuelve una posición al conjunto de libres
+void ip_allocator_free(ip_allocator* allocator, size_t position);
+
+int ip_allocator_is_free(const ip_allocator* allocator, size_t position);
+
+// Posiciones libres dentro de [low, high): una cuenta de bits por palabra
+size_t ip_allocator_count_free_in(const ip_allocator* allocator, size_t low, size_t high);
+
+#endif
@@ -0,0 +1,97 @@
+#include "lease_history.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+int lease_history_init(lease_history* history, uint32_t capacity) {
+    memset(history, 0, sizeof(*history));
+    if (capacity == 0) {
+        capacity = 1;
+    }
+    history->entries = malloc((size_t)capacity * sizeof(lease_history_entry));
+    if (history->entries == NULL || lease_index_init(&history->slots, capacity) != 0) {
+        free(history->entries);
+        history->entries = NULL;
+        return -1;
+    }
+    history->capacity = capacity;
+    history->newest = LEASE_HISTORY_NONE;
+    history->oldest = LEASE_HISTORY_NONE;
+    // Todas las entradas empiezan en la lista de libres
+    for (uint32_t i = 0; i < capacity; ++i) {
+        history->entries[i].older = i + 1 < capacity ? i + 1 : LEASE_HISTORY_NONE;
+    }
+    history->free_list = 0;
+    return 0;
+}
+
+void lease_history_destroy(lease_history* history) {
+    lease_index_destroy(&history->slots);
+    free(history->entries);
+    memset(history, 0, sizeof(*history));
+}
+
+static void unlink_entry(lease_history* history, uint32_t slot) {
+    lease_history_entry* entry = &history->entries[slot];
+    if (entry->newer != LEASE_HISTORY_NONE) {
+        history->entries[entry->newer].older = entry->older;
+    } else {
+        history->newest = entry->older;
+    }
+    if (entry->older != LEASE_HISTORY_NONE) {
+        history->entries[entry->older].newer = entry->newer;
+    } else {
+        history->oldest = entry->newer;
+    }
+}
+
+static void link_newest(lease_history* history, uint32_t slot) {
+    lease_history_entry* entry = &history->entries[slot];
+    entry->newer = LEASE_HISTORY_NONE;
+    entry->older = history->newest;
+    if (history->newest != LEASE_HISTORY_NONE) {
+        history->entries[history->newest].newer = slot;
+    } else {
+        history->oldest = slot;
+    }
+    history->newest = slot;
+}
+
+void lease_history_put(lease_history* history, uint64_t key, uint32_t position) {
+    uint32_t slot;
+    if (lease_index_get(&history->slots, key, &slot) == 0) {
+        history->entries[slot].position = position;
+        unlink_entry(history, slot);
+        link_newest(history, slot);
+        return;
+    }
+
+    if (history->free_list != LEASE_HISTORY_NONE) {
+        slot = history->free_list;
+        history->free_list = history->entries[slot].older;
+        history->count++;
+    } else {
+        // Lleno: se reutiliza la entrada más antigua
+        slot = history->oldest;
+        unlink_entry(history, slot);
+        lease_index_remove(&history->slots, history->entries[slot].key);
+    }
+    history->entries[slot].key = key;
+    history->entries[slot].position = position;
+    link_newest(history, slot);
+    lease_index_put(&history->slots, key, slot);
+}
+
+int lease_history_take(lease_history* history, uint64_t key, uint32_t* position) {
+    uint32_t slot;
+    if (lease_index_get(&history->slots, key, &slot) != 0) {
+        return -1;
+    }
+    *position = history->entries[slot].position;
+    unlink_entry(history, slot);
+    lease_index_remove(&history->slots, key);
+    history->entries[slot].older = history->free_list;
+    history->free_list = slot;
+    history->count--;
+    return 0;
+}
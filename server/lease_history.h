@@ -0,0 +1,43 @@
+#ifndef LEASE_HISTORY_H
+#define LEASE_HISTORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lease_index.h"
+
+// Historial acotado de las últimas direcciones liberadas o vencidas: clave
+// del cliente (MAC y pool) -> posición en lease_table. Cuando está lleno se
+// descarta la entrada usada hace más tiempo (LRU). Las entradas forman una
+// lista doblemente enlazada sobre un arreglo fijo y se encuentran con un
+// lease_index, así que insertar, buscar y desalojar cuestan O(1). No toma
+// ningún mutex: lo protege quien lo usa.
+typedef struct {
+    uint64_t key;
+    uint32_t position;
+    uint32_t newer;  // Hacia la más reciente (LEASE_HISTORY_NONE en la cabeza)
+    uint32_t older;  // Hacia la más antigua (LEASE_HISTORY_NONE en la cola)
+} lease_history_entry;
+
+typedef struct {
+    lease_history_entry* entries;
+    lease_index slots;  // Clave -> índice en 'entries'
+    uint32_t capacity;
+    uint32_t count;
+    uint32_t newest;
+    uint32_t oldest;
+    uint32_t free_list;  // Entradas quitadas con lease_history_take, enlazadas por 'older'
+} lease_history;
+
+#define LEASE_HISTORY_NONE UINT32_MAX
+
+int lease_history_init(lease_history* history, uint32_t capacity);
+void lease_history_destroy(lease_history* history);
+
+// Recuerda la posición de la clave como la más reciente (reemplaza la anterior de la misma clave)
+void lease_history_put(lease_history* history, uint64_t key, uint32_t position);
+
+// Retorna 0, escribe la posición recordada para la clave y la olvida; -1 si no estaba
+int lease_history_take(lease_history* history, uint64_t key, uint32_t* position);
+
+#endif
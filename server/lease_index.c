@@ -0,0 +1,128 @@
+#include "lease_index.h"
+
+#include <stdlib.h>
+
+// Mezcla de bits (finalizador de splitmix64) para repartir claves consecutivas
+static inline size_t hash_key(uint64_t key) {
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebULL;
+    key ^= key >> 31;
+    return (size_t)key;
+}
+
+int lease_index_init(lease_index* index, size_t expected) {
+    size_t capacity = 16;
+    while (capacity < expected * 2) {
+        capacity <<= 1;
+    }
+
+    index->keys = malloc(capacity * sizeof(uint64_t));
+    index->values = malloc(capacity * sizeof(uint32_t));
+    if (index->keys == NULL || index->values == NULL) {
+        free(index->keys);
+        free(index->values);
+        index->keys = NULL;
+        index->values = NULL;
+        return -1;
+    }
+    index->capacity = capacity;
+    lease_index_clear(index);
+    return 0;
+}
+
+void lease_index_destroy(lease_index* index) {
+    free(index->keys);
+    free(index->values);
+    index->keys = NULL;
+    index->values = NULL;
+    index->capacity = 0;
+    index->count = 0;
+}
+
+void lease_index_clear(lease_index* index) {
+    for (size_t i = 0; i < index->capacity; ++i) {
+        index->keys[i] = LEASE_INDEX_EMPTY;
+    }
+    index->count = 0;
+}
+
+int lease_index_put(lease_index* index, uint64_t key, uint32_t value) {
+    size_t mask = index->capacity - 1;
+    size_t slot = hash_key(key) & mask;
+
+    while (index->keys[slot] != LEASE_INDEX_EMPTY) {
+        if (index->keys[slot] == key) {
+            index->values[slot] = value;
+            return 0;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    // Mantener siempre al menos la mitad de las celdas vacías
+    if ((index->count + 1) * 2 > index->capacity) {
+        return -1;
+    }
+    index->keys[slot] = key;
+    index->values[slot] = value;
+    index->count++;
+    return 0;
+}
+
+int lease_index_get(const lease_index* index, uint64_t key, uint32_t* value) {
+    size_t mask = index->capacity - 1;
+    size_t slot = hash_key(key) & mask;
+
+    while (index->keys[slot] != LEASE_INDEX_EMPTY) {
+        if (index->keys[slot] == key) {
+            *value = index->values[slot];
+            return 0;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+void lease_index_remove(lease_index* index, uint64_t key) {
+    size_t mask = index->capacity - 1;
+    size_t slot = hash_key(key) & mask;
+
+    while (index->keys[slot] != key) {
+        if (index->keys[slot] == LEASE_INDEX_EMPTY) {
+            return;  // La clave no está en el índice
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    // Desplazar hacia atrás las claves siguientes del mismo grupo para no dejar huecos
+    size_t hole = slot;
+    size_t next = (hole + 1) & mask;
+    while (index->keys[next] != LEASE_INDEX_EMPTY) {
+        size_t home = hash_key(index->keys[next]) & mask;
+        // Mover la clave si su posición ideal no está entre el hueco y su posición actual
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            index->keys[hole] = index->keys[next];
+            index->values[hole] = index->values[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+    index->keys[hole] = LEASE_INDEX_EMPTY;
+    index->count--;
+}
+
+uint64_t mac_bytes_to_key(const uint8_t mac[6]) {
+    uint64_t value = 0;
+    for (int i = 0; i < 6; ++i) {
+        value = (value << 8) | mac[i];
+    }
+    return value;
+}
+
+void mac_key_to_bytes(uint64_t key, uint8_t mac[6]) {
+    for (int i = 5; i >= 0; --i) {
+        mac[i] = key & 0xff;
+        key >>= 8;
+    }
+}
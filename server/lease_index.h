@@ -0,0 +1,39 @@
+#ifndef LEASE_INDEX_H
+#define LEASE_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Índice hash (direccionamiento abierto con sondeo lineal) de una clave
+// binaria de 64 bits a la posición del lease en lease_table. Las claves son
+// MAC de 48 bits (con el pool en los bits altos), así que UINT64_MAX nunca es
+// una clave válida y marca las celdas vacías.
+typedef struct {
+    uint64_t* keys;
+    uint32_t* values;
+    size_t capacity;  // Potencia de 2
+    size_t count;
+} lease_index;
+
+#define LEASE_INDEX_EMPTY UINT64_MAX
+
+// Reserva espacio para 'expected' claves con factor de carga <= 0.5
+int lease_index_init(lease_index* index, size_t expected);
+void lease_index_destroy(lease_index* index);
+
+// Inserta o actualiza la clave. Retorna -1 si el índice está lleno.
+int lease_index_put(lease_index* index, uint64_t key, uint32_t value);
+
+// Retorna 0 y escribe el valor si la clave existe, -1 si no
+int lease_index_get(const lease_index* index, uint64_t key, uint32_t* value);
+
+// Elimina la clave si existe (borrado con desplazamiento hacia atrás, sin lápidas)
+void lease_index_remove(lease_index* index, uint64_t key);
+
+void lease_index_clear(lease_index* index);
+
+// Conversión entre la MAC en bytes (como se guarda en lease_record) y su clave
+uint64_t mac_bytes_to_key(const uint8_t mac[6]);
+void mac_key_to_bytes(uint64_t key, uint8_t mac[6]);
+
+#endif
@@ -0,0 +1,417 @@
+#include "lease_journal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "dhcp_server.h"
+
+#define JOURNAL_MAGIC 0x444c4a52u    // "DLJR"
+#define SNAPSHOT_MAGIC 0x444c534eu   // "DLSN"
+#define JOURNAL_VERSION 1
+#define RECOVERY_CHUNK 4096          // Registros leídos por read() al recuperar
+
+_Static_assert(sizeof(journal_record) == 16, "journal_record debe ocupar 16 bytes");
+
+static char snapshot_path[PATH_MAX];
+static char journal_path[PATH_MAX];
+static char journal_old_path[PATH_MAX];
+
+static atomic_int enabled = 0;
+static int journal_fd = -1;
+
+// Eventos pendientes de escribir. Los productores añaden a 'pending'; el
+// escritor lo intercambia por 'writing' y escribe el lote sin el mutex.
+static pthread_mutex_t journal_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_ready = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t durable_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t compaction_cond = PTHREAD_COND_INITIALIZER;
+static journal_record* pending = NULL;
+static size_t pending_count = 0;
+static size_t pending_capacity = 0;
+static journal_record* writing = NULL;
+static size_t writing_capacity = 0;
+
+static uint64_t appended_sequence = 0;  // Último evento encolado
+static uint64_t durable_sequence = 0;   // Último evento sincronizado en disco
+static size_t journal_records = 0;      // Registros en el journal actual
+static int compaction_requested = 0;
+static int compaction_running = 0;
+
+static journal_snapshot_fn snapshot_source = NULL;
+static void* snapshot_context = NULL;
+
+static uint8_t record_checksum(const journal_record* record) {
+    const uint8_t* bytes = (const uint8_t*)record;
+    uint8_t sum = 0x5a;
+    for (size_t i = 0; i < sizeof(journal_record); ++i) {
+        if (i != offsetof(journal_record, checksum)) {
+            sum = (uint8_t)(((sum << 1) | (sum >> 7)) ^ bytes[i]);
+        }
+    }
+    return sum;
+}
+
+void lease_journal_make_record(journal_record* record, uint8_t type, uint32_t ip, const uint8_t mac[6], uint32_t expiry) {
+    memset(record, 0, sizeof(*record));
+    record->type = type;
+    if (mac != NULL) {
+        memcpy(record->mac, mac, sizeof(record->mac));
+    }
+    record->ip = ip;
+    record->expiry = expiry;
+    record->checksum = record_checksum(record);
+}
+
+int lease_journal_write_records(int fd, const journal_record* records, size_t count) {
+    const char* data = (const char*)records;
+    size_t remaining = count * sizeof(journal_record);
+    while (remaining > 0) {
+        ssize_t written = write(fd, data, remaining);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        data += written;
+        remaining -= (size_t)written;
+    }
+    return 0;
+}
+
+void lease_journal_configure(const char* base_path) {
+    snprintf(snapshot_path, sizeof(snapshot_path), "%s.snapshot", base_path);
+    snprintf(journal_path, sizeof(journal_path), "%s.journal", base_path);
+    snprintf(journal_old_path, sizeof(journal_old_path), "%s.journal.old", base_path);
+}
+
+int lease_journal_enabled(void) {
+    return atomic_load(&enabled);
+}
+
+// Reproduce un archivo hasta el final o hasta el primer registro inválido
+// (una escritura cortada por una caída). Retorna los registros aplicados.
+static long replay_file(const char* path, uint32_t magic, journal_apply_fn apply, void* context) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return errno == ENOENT ? 0 : -1;
+    }
+
+    journal_record* chunk = malloc(RECOVERY_CHUNK * sizeof(journal_record));
+    if (chunk == NULL) {
+        close(fd);
+        return -1;
+    }
+
+    long applied = 0;
+    int header_seen = 0;
+    int stop = 0;
+    while (!stop) {
+        ssize_t bytes = read(fd, chunk, RECOVERY_CHUNK * sizeof(journal_record));
+        if (bytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes <= 0) {
+            break;
+        }
+        size_t count = (size_t)bytes / sizeof(journal_record);
+        for (size_t i = 0; i < count; ++i) {
+            if (chunk[i].checksum != record_checksum(&chunk[i])) {
+                stop = 1;
+                break;
+            }
+            if (!header_seen) {
+                if (chunk[i].type != JOURNAL_HEADER || chunk[i].ip != magic || chunk[i].expiry != JOURNAL_VERSION) {
+                    stop = 1;
+                    break;
+                }
+                header_seen = 1;
+                continue;
+            }
+            apply(&chunk[i], context);
+            applied++;
+        }
+        if ((size_t)bytes % sizeof(journal_record) != 0) {
+            break;  // Registro final incompleto
+        }
+    }
+
+    if (stop) {
+        char log_entry[BUFFER_SIZE];
+        snprintf(log_entry, BUFFER_SIZE, "Registro inválido en %s; se ignoran los registros siguientes.", path);
+        log_message("WARNING", log_entry);
+    }
+    free(chunk);
+    close(fd);
+    return applied;
+}
+
+long lease_journal_recover(journal_apply_fn apply, void* context) {
+    const char* paths[] = {snapshot_path, journal_old_path, journal_path};
+    const uint32_t magics[] = {SNAPSHOT_MAGIC, JOURNAL_MAGIC, JOURNAL_MAGIC};
+    long total = 0;
+
+    for (int i = 0; i < 3; ++i) {
+        long applied = replay_file(paths[i], magics[i], apply, context);
+        if (applied < 0) {
+            char log_entry[BUFFER_SIZE];
+            snprintf(log_entry, BUFFER_SIZE, "No se pudo leer %s: %s", paths[i], strerror(errno));
+            log_message("ERROR", log_entry);
+            return -1;
+        }
+        total += applied;
+    }
+    return total;
+}
+
+// Abre el journal para añadir. Descarta un registro final incompleto y
+// escribe la cabecera si el archivo es nuevo.
+static int open_journal(void) {
+    int fd = open(journal_path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+    off_t whole = st.st_size - st.st_size % (off_t)sizeof(journal_record);
+    if (whole != st.st_size && ftruncate(fd, whole) != 0) {
+        close(fd);
+        return -1;
+    }
+    if (whole == 0) {
+        journal_record header;
+        lease_journal_make_record(&header, JOURNAL_HEADER, JOURNAL_MAGIC, NULL, JOURNAL_VERSION);
+        if (lease_journal_write_records(fd, &header, 1) != 0) {
+            close(fd);
+            return -1;
+        }
+    }
+    journal_records = (size_t)(whole / (off_t)sizeof(journal_record));
+    journal_fd = fd;
+    return 0;
+}
+
+// Deja el journal actual como journal.old y empieza uno vacío (requiere el
+// mutex tomado y que el lote anterior ya esté en disco). Si quedó un
+// journal.old de una compactación fallida se sigue usando el actual.
+static void rotate_journal(void) {
+    if (access(journal_old_path, F_OK) == 0) {
+        return;
+    }
+    if (rename(journal_path, journal_old_path) != 0) {
+        perror("No se pudo rotar el journal de leases");
+        return;
+    }
+    int old_fd = journal_fd;
+    if (open_journal() != 0) {
+        // Seguir escribiendo en el archivo ya renombrado; la recuperación también lo lee
+        perror("No se pudo abrir el journal de leases");
+        journal_fd = old_fd;
+        return;
+    }
+    close(old_fd);
+}
+
+static void* writer_loop(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&journal_mutex);
+    while (1) {
+        while (pending_count == 0) {
+            pthread_cond_wait(&work_ready, &journal_mutex);
+        }
+
+        // Tomar el lote completo: todos los eventos encolados hasta ahora
+        journal_record* batch = pending;
+        size_t batch_count = pending_count;
+        uint64_t batch_end = appended_sequence;
+        size_t batch_capacity = pending_capacity;
+        pending = writing;
+        pending_capacity = writing_capacity;
+        writing = batch;
+        writing_capacity = batch_capacity;
+        pending_count = 0;
+        pthread_mutex_unlock(&journal_mutex);
+
+        int failed = lease_journal_write_records(journal_fd, batch, batch_count) != 0 || fdatasync(journal_fd) != 0;
+
+        pthread_mutex_lock(&journal_mutex);
+        if (failed) {
+            // Sin journal fiable se sigue atendiendo a los clientes, solo en memoria
+            perror("No se pudo escribir el journal de leases");
+            log_message("ERROR", "No se pudo escribir el journal de leases; se desactiva la persistencia.");
+            atomic_store(&enabled, 0);
+        }
+        durable_sequence = batch_end;
+        journal_records += batch_count;
+        pthread_cond_broadcast(&durable_cond);
+
+        if (journal_records >= JOURNAL_COMPACT_RECORDS) {
+            compaction_requested = 1;
+        }
+        if (!failed && compaction_requested && !compaction_running) {
+            compaction_requested = 0;
+            compaction_running = 1;
+            rotate_journal();
+            pthread_cond_signal(&compaction_cond);
+        }
+    }
+    return NULL;
+}
+
+// Escribe un snapshot nuevo a partir de la tabla y borra el journal rotado
+static void compact(void) {
+    char temp_path[PATH_MAX + 4];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", snapshot_path);
+
+    int fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        perror("No se pudo crear el snapshot de leases");
+        log_message("ERROR", "No se pudo crear el snapshot de leases.");
+        return;
+    }
+    journal_record header;
+    lease_journal_make_record(&header, JOURNAL_HEADER, SNAPSHOT_MAGIC, NULL, JOURNAL_VERSION);
+    int written = -1;
+    if (lease_journal_write_records(fd, &header, 1) == 0) {
+        written = snapshot_source(fd, snapshot_context);
+    }
+    if (written < 0 || fdatasync(fd) != 0) {
+        close(fd);
+        unlink(temp_path);
+        log_message("ERROR", "No se pudo escribir el snapshot de leases.");
+        return;
+    }
+    close(fd);
+    if (rename(temp_path, snapshot_path) != 0) {
+        unlink(temp_path);
+        log_message("ERROR", "No se pudo reemplazar el snapshot de leases.");
+        return;
+    }
+
+    // Sincronizar el directorio para que el rename sobreviva a una caída
+    char directory[PATH_MAX];
+    snprintf(directory, sizeof(directory), "%s", snapshot_path);
+    char* slash = strrchr(directory, '/');
+    if (slash != NULL) {
+        *slash = '\0';
+    } else {
+        snprintf(directory, sizeof(directory), ".");
+    }
+    int dir_fd = open(directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd >= 0) {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+    unlink(journal_old_path);
+
+    char log_entry[BUFFER_SIZE];
+    snprintf(log_entry, BUFFER_SIZE, "Journal de leases compactado: snapshot con %d registros.", written);
+    log_message("INFO", log_entry);
+}
+
+static void* compaction_loop(void* arg) {
+    (void)arg;
+    while (1) {
+        pthread_mutex_lock(&journal_mutex);
+        while (!compaction_running) {
+            pthread_cond_wait(&compaction_cond, &journal_mutex);
+        }
+        pthread_mutex_unlock(&journal_mutex);
+
+        compact();
+
+        pthread_mutex_lock(&journal_mutex);
+        compaction_running = 0;
+        pthread_mutex_unlock(&journal_mutex);
+    }
+    return NULL;
+}
+
+int lease_journal_start(journal_snapshot_fn snapshot, void* context) {
+    snapshot_source = snapshot;
+    snapshot_context = context;
+
+    pending_capacity = writing_capacity = 1024;
+    pending = malloc(pending_capacity * sizeof(journal_record));
+    writing = malloc(writing_capacity * sizeof(journal_record));
+    if (pending == NULL || writing == NULL || open_journal() != 0) {
+        perror("No se pudo abrir el journal de leases");
+        return -1;
+    }
+
+    pthread_t writer, compactor;
+    if (pthread_create(&writer, NULL, writer_loop, NULL) != 0 ||
+        pthread_create(&compactor, NULL, compaction_loop, NULL) != 0) {
+        return -1;
+    }
+    pthread_detach(writer);
+    pthread_detach(compactor);
+    atomic_store(&enabled, 1);
+    return 0;
+}
+
+uint64_t lease_journal_append(uint8_t type, uint32_t ip, const uint8_t mac[6], uint32_t expiry) {
+    if (!atomic_load_explicit(&enabled, memory_order_relaxed)) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&journal_mutex);
+    if (pending_count == pending_capacity) {
+        journal_record* grown = realloc(pending, pending_capacity * 2 * sizeof(journal_record));
+        if (grown == NULL) {
+            pthread_mutex_unlock(&journal_mutex);
+            log_message("ERROR", "Sin memoria para el journal de leases; se pierde un evento.");
+            return 0;
+        }
+        pending = grown;
+        pending_capacity *= 2;
+    }
+    lease_journal_make_record(&pending[pending_count++], type, ip, mac, expiry);
+    uint64_t sequence = ++appended_sequence;
+    if (pending_count == 1) {
+        pthread_cond_signal(&work_ready);
+    }
+    pthread_mutex_unlock(&journal_mutex);
+    return sequence;
+}
+
+void lease_journal_wait(uint64_t sequence) {
+    if (sequence == 0) {
+        return;
+    }
+    pthread_mutex_lock(&journal_mutex);
+    while (durable_sequence < sequence) {
+        pthread_cond_wait(&durable_cond, &journal_mutex);
+    }
+    pthread_mutex_unlock(&journal_mutex);
+}
+
+void lease_journal_request_compaction(void) {
+    if (!atomic_load(&enabled)) {
+        return;
+    }
+    pthread_mutex_lock(&journal_mutex);
+    if (!compaction_running) {
+        // Rotar ahora si no hay un lote en curso; si lo hay, lo hará el escritor al terminarlo
+        if (durable_sequence == appended_sequence) {
+            compaction_running = 1;
+            rotate_journal();
+            pthread_cond_signal(&compaction_cond);
+        } else {
+            compaction_requested = 1;
+        }
+    }
+    pthread_mutex_unlock(&journal_mutex);
+}
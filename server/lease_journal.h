@@ -0,0 +1,68 @@
+#ifndef LEASE_JOURNAL_H
+#define LEASE_JOURNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define LEASE_DB_FILE "./server/dhcp_leases"  // Ruta base por defecto (opción -j)
+#define JOURNAL_COMPACT_RECORDS (1u << 20)    // Registros en el journal que disparan una compactación
+
+// Eventos del journal. Cada registro describe el estado de una IP tras el
+// evento, así que al reproducirlos en orden gana el último de cada IP.
+enum {
+    JOURNAL_HEADER = 0x7f,  // Primer registro de cada archivo (ip = magic, expiry = versión)
+    JOURNAL_BIND = 1,       // Lease registrado o renovado hasta 'expiry'
+    JOURNAL_RELEASE = 2,    // DHCPRELEASE
+    JOURNAL_DECLINE = 3,    // DHCPDECLINE, en cuarentena hasta 'expiry'
+    JOURNAL_EXPIRE = 4      // Lease o cuarentena vencidos
+};
+
+// Registro binario de 16 bytes, igual en el journal y en el snapshot
+typedef struct {
+    uint8_t type;
+    uint8_t mac[6];
+    uint8_t checksum;   // Detecta registros corruptos o escritos a medias
+    uint32_t ip;        // Orden de host
+    uint32_t expiry;
+} journal_record;
+
+// Llamada por cada registro válido durante la recuperación
+typedef void (*journal_apply_fn)(const journal_record* record, void* context);
+
+// Escribe el estado actual completo en 'fd' (registros JOURNAL_BIND y
+// JOURNAL_DECLINE) usando lease_journal_write_records. Retorna el número de
+// registros escritos o -1 si falla.
+typedef int (*journal_snapshot_fn)(int fd, void* context);
+
+// Fija la ruta base: <base>.snapshot, <base>.journal y <base>.journal.old
+void lease_journal_configure(const char* base_path);
+
+// Reproduce snapshot + journal.old + journal en ese orden. Retorna el número
+// de registros aplicados o -1 si un archivo existe pero no se puede leer.
+long lease_journal_recover(journal_apply_fn apply, void* context);
+
+// Abre el journal para añadir registros y arranca los hilos de escritura
+// (group commit) y de compactación
+int lease_journal_start(journal_snapshot_fn snapshot, void* context);
+
+int lease_journal_enabled(void);
+
+// Encola un evento y retorna su número de secuencia (0 si el journal está
+// desactivado). Se llama con el mutex del shard tomado para que el orden del
+// journal coincida con el de la tabla.
+uint64_t lease_journal_append(uint8_t type, uint32_t ip, const uint8_t mac[6], uint32_t expiry);
+
+// Espera a que el evento 'sequence' esté en disco (fdatasync). Los eventos
+// que llegan mientras se sincroniza un lote se escriben juntos en el siguiente.
+void lease_journal_wait(uint64_t sequence);
+
+// Pide una compactación (snapshot nuevo y journal vacío) al hilo de compactación
+void lease_journal_request_compaction(void);
+
+// Prepara un registro con su checksum
+void lease_journal_make_record(journal_record* record, uint8_t type, uint32_t ip, const uint8_t mac[6], uint32_t expiry);
+
+// Escribe 'count' registros completos en 'fd'. Retorna -1 si falla.
+int lease_journal_write_records(int fd, const journal_record* records, size_t count);
+
+#endif
@@ -0,0 +1,1435 @@
+#include "lease_table.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "dhcp_server.h"
+#include "expiry_heap.h"
+#include "ip_allocator.h"
+#include "lease_history.h"
+#include "lease_index.h"
+#include "lease_journal.h"
+#include "server_metrics.h"
+
+// Partición del pool: un rango contiguo de posiciones de lease_table con su
+// propio mutex, conjunto de libres, índice por MAC y heap de vencimientos.
+// Las operaciones sobre una IP solo toman el mutex de su shard. Alineado a
+// la línea de caché para que los mutex de shards vecinos no la compartan.
+typedef struct {
+    pthread_mutex_t mutex;
+    uint32_t first;              // Primera posición de lease_table del shard
+    uint32_t count;              // Posiciones del shard
+    lease_index mac_index;       // MAC -> posición global (leases del shard)
+    ip_allocator free_ips;       // Posiciones locales libres
+    expiry_heap expiries;        // Posiciones locales asignadas o en cuarentena
+    int timer;                   // timerfd armado en el vencimiento más próximo
+    uint32_t armed_expiry;       // 0 = temporizador desarmado
+    uint32_t next_free;          // Posición local donde empieza la próxima búsqueda (Next Fit)
+    // Últimas direcciones de los clientes cuyo shard de afinidad es este.
+    // Tiene su propio mutex, que se toma con o sin el del shard pero nunca
+    // antes que el de otro shard.
+    pthread_mutex_t history_mutex;
+    lease_history history;
+    // Serializa la búsqueda de dirección de los clientes cuyo shard de
+    // afinidad es este: dos solicitudes de la misma MAC no pueden tomar cada
+    // una una dirección en shards distintos. Se toma antes que cualquier otro
+    // mutex de shard y nunca con uno de ellos tomado.
+    pthread_mutex_t allocation_mutex;
+} __attribute__((aligned(64))) lease_shard;
+
+// Pool de una subred: un rango de IPs que ocupa posiciones consecutivas de
+// lease_table. Los pools se guardan ordenados por IP, que es también el
+// orden de sus posiciones, así que de una IP o de una posición se llega a su
+// pool con una búsqueda binaria.
+typedef struct {
+    uint32_t start;        // Primera IP (orden de host)
+    uint32_t count;        // Direcciones del pool
+    uint32_t first;        // Posición de 'start' en lease_table
+    uint32_t id;           // Índice del rango en generate_ip_pools
+    uint32_t shard_first;  // Shards que cubren sus posiciones
+    uint32_t shard_count;
+} lease_pool;
+
+// Tabla de leases de todos los pools, dimensionada al generarlos
+static lease_record* lease_table = NULL;
+static uint32_t table_size = 0;  // Entradas válidas de lease_table
+
+static lease_pool* pools = NULL;          // Ordenados por IP
+static uint32_t* pool_by_id = NULL;       // Identificador -> índice en 'pools'
+static uint32_t pool_total = 0;
+
+static lease_shard* shards = NULL;
+static uint32_t shard_count = 0;
+static uint32_t shard_span = 0;  // Posiciones por shard (el último puede tener menos)
+
+// Leases asignados fuera del shard de afinidad de su MAC porque éste estaba
+// lleno. Mientras sea 0, buscar una MAC solo requiere consultar ese shard.
+static atomic_uint spilled_leases = 0;
+
+// Cabecera del archivo mapeado de la tabla (opción -m). Los registros
+// lease_record empiezan justo después, en el mismo orden que lease_table.
+#define LEASE_MAP_MAGIC 0x444c4d50u  // "DLMP"
+#define LEASE_MAP_VERSION 2
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+    uint32_t pool_start;        // Primera IP del primer pool
+    uint32_t pool_count;        // Registros de la tabla (todos los pools)
+    uint32_t clean;             // 1 si el servidor se detuvo limpiamente
+    uint32_t pools;             // Número de pools
+    uint64_t layout_checksum;   // De los rangos (inicio y tamaño) de todos los pools
+    uint64_t table_checksum;    // De los registros; solo es válido si clean == 1
+    uint64_t header_checksum;   // De los campos anteriores
+    uint8_t padding[16];
+} lease_map_header;
+
+_Static_assert(sizeof(lease_map_header) == 64, "lease_map_header debe ocupar 64 bytes");
+
+static const char* map_path = NULL;
+static lease_map_header* map_header = NULL;  // NULL si la tabla está en memoria anónima
+static size_t map_size = 0;
+static int map_resumed = 0;
+
+// Salida por consola de cada operación (los benchmarks la desactivan)
+static int console_output = 1;
+
+void set_lease_console_output(int enabled) {
+    console_output = enabled;
+}
+
+const char* lease_address_string(uint32_t ip, char* buffer) {
+    struct in_addr addr;
+    addr.s_addr = htonl(ip);
+    return inet_ntop(AF_INET, &addr, buffer, INET_ADDRSTRLEN);
+}
+
+const char* lease_ip_string(const lease_record* lease, char* buffer) {
+    return lease_address_string(lease->ip, buffer);
+}
+
+const char* lease_mac_string(const uint8_t mac[6], char* buffer) {
+    snprintf(buffer, LEASE_MAC_STRLEN, "%02x:%02x:%02x:%02x:%02x:%02x",
+             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    return buffer;
+}
+
+// Clave del índice por MAC: la MAC (48 bits) con el identificador del pool
+// encima, así un cliente puede tener un lease en cada subred
+static inline uint64_t lease_key(uint64_t mac_key, uint32_t pool_id) {
+    return mac_key | ((uint64_t)pool_id << 48);
+}
+
+// Shard de afinidad de una clave entre los que cubren su pool: las búsquedas
+// de un mismo cliente van siempre al mismo shard y las MAC consecutivas se
+// reparten entre todos
+static inline uint32_t home_shard(const lease_pool* pool, uint64_t key) {
+    return pool->shard_first + (uint32_t)(((key * 0x9e3779b97f4a7c15ULL) >> 32) % pool->shard_count);
+}
+
+// Pool que contiene la IP, o NULL
+static const lease_pool* pool_of_ip(uint32_t ip) {
+    uint32_t low = 0, high = pool_total;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (pools[middle].start <= ip) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low == 0 || ip - pools[low - 1].start >= pools[low - 1].count) {
+        return NULL;
+    }
+    return &pools[low - 1];
+}
+
+// Pool que ocupa la posición (siempre existe para posiciones válidas)
+static const lease_pool* pool_of_position(uint32_t position) {
+    uint32_t low = 0, high = pool_total;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (pools[middle].first <= position) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return &pools[low - 1];
+}
+
+static const lease_pool* pool_with_id(uint32_t id) {
+    return id < pool_total ? &pools[pool_by_id[id]] : NULL;
+}
+
+// Busca el shard y la posición global de una IP. Retorna NULL si no es de ningún pool.
+static lease_shard* shard_of_ip(uint32_t ip, uint32_t* position, const lease_pool** pool) {
+    const lease_pool* found = pool_of_ip(ip);
+    if (found == NULL) {
+        return NULL;
+    }
+    *position = found->first + (ip - found->start);
+    if (pool != NULL) {
+        *pool = found;
+    }
+    return &shards[*position / shard_span];
+}
+
+// Reprograma el temporizador del shard si cambió su vencimiento más próximo
+// (requiere el mutex del shard tomado)
+static void rearm_expiry_timer(lease_shard* shard) {
+    if (shard->timer < 0) {
+        return;  // El hilo de expiración aún no arrancó
+    }
+    uint32_t next;
+    if (expiry_heap_peek(&shard->expiries, &next) != 0) {
+        next = 0;
+    }
+    if (next == shard->armed_expiry) {
+        return;
+    }
+
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.it_value.tv_sec = next;  // Un valor 0 desarma el temporizador
+    if (timerfd_settime(shard->timer, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET, &spec, NULL) != 0) {
+        perror("timerfd_settime");
+        return;
+    }
+    shard->armed_expiry = next;
+}
+
+// Deja la entrada libre y la quita del índice por MAC y del heap
+// (requiere el mutex del shard tomado)
+static void clear_binding(lease_shard* shard, uint32_t position) {
+    lease_record* lease = &lease_table[position];
+    if (lease->state == LEASE_BOUND || lease->state == LEASE_OFFERED) {
+        const lease_pool* pool = pool_of_position(position);
+        uint64_t key = lease_key(mac_bytes_to_key(lease->mac), pool->id);
+        // Solo si el índice apunta a esta posición: nunca se borra la entrada
+        // de otra dirección viva de la misma MAC
+        uint32_t indexed;
+        if (lease_index_get(&shard->mac_index, key, &indexed) == 0 && indexed == position) {
+            lease_index_remove(&shard->mac_index, key);
+        }
+        if (&shards[home_shard(pool, key)] != shard) {
+            atomic_fetch_sub(&spilled_leases, 1);
+        }
+    }
+    expiry_heap_remove(&shard->expiries, position - shard->first);
+    lease->state = LEASE_FREE;
+    lease->expiry = 0;
+    memset(lease->mac, 0, sizeof(lease->mac));
+}
+
+// Recuerda la dirección que deja un cliente para volver a dársela si regresa
+// (requiere el mutex del shard de la dirección; toma el del historial)
+static void remember_address(uint32_t position) {
+    const lease_record* lease = &lease_table[position];
+    if (lease->state != LEASE_BOUND) {
+        return;  // Las direcciones rechazadas no se vuelven a ofrecer al mismo cliente
+    }
+    const lease_pool* pool = pool_of_position(position);
+    uint64_t key = lease_key(mac_bytes_to_key(lease->mac), pool->id);
+    lease_shard* home = &shards[home_shard(pool, key)];
+    pthread_mutex_lock(&home->history_mutex);
+    lease_history_put(&home->history, key, position);
+    pthread_mutex_unlock(&home->history_mutex);
+}
+
+// Devuelve una dirección que acaba de quedar libre al conjunto de libres,
+// salvo si está reservada (requiere el mutex del shard tomado)
+static void return_address(lease_shard* shard, uint32_t position) {
+    if (!(lease_table[position].flags & LEASE_FLAG_RESERVED)) {
+        ip_allocator_free(&shard->free_ips, position - shard->first);
+    }
+}
+
+// Suma de verificación de 'bytes' (múltiplo de 8) palabra a palabra
+static uint64_t checksum_words(const void* data, size_t bytes) {
+    const uint64_t* words = (const uint64_t*)data;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < bytes / sizeof(uint64_t); ++i) {
+        hash = (hash ^ words[i]) * 0x100000001b3ULL;
+        hash ^= hash >> 29;
+    }
+    return hash;
+}
+
+static void seal_map_header(void) {
+    map_header->header_checksum = checksum_words(map_header, offsetof(lease_map_header, header_checksum));
+}
+
+void set_lease_map_file(const char* path) {
+    map_path = path;
+}
+
+int lease_table_resumed(void) {
+    return map_resumed;
+}
+
+// Suma de los rangos de todos los pools: la tabla mapeada solo se retoma con los mismos pools
+static uint64_t pools_checksum(void) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (uint32_t i = 0; i < pool_total; ++i) {
+        uint64_t word = ((uint64_t)pools[i].start << 32) | pools[i].count;
+        hash = (hash ^ word) * 0x100000001b3ULL;
+        hash ^= hash >> 29;
+    }
+    return hash;
+}
+
+// Deja todos los registros libres, cada uno con la IP de su posición
+static void reset_records(lease_record* records) {
+    for (uint32_t p = 0; p < pool_total; ++p) {
+        for (uint32_t i = 0; i < pools[p].count; ++i) {
+            lease_record* record = &records[pools[p].first + i];
+            memset(record, 0, sizeof(*record));
+            record->ip = pools[p].start + i;
+            record->state = LEASE_FREE;
+        }
+    }
+}
+
+// Mapea el archivo de la tabla. Si ya existe con la misma versión, pools y
+// cabecera válida, se reutilizan sus registros tal cual y 'reused' vale 1;
+// si además el servidor se detuvo limpiamente y la suma de los registros
+// coincide, vale 2. En otro caso se inicializa de nuevo.
+static lease_record* map_lease_table(int* reused) {
+    uint32_t start = pools[0].start;
+    uint32_t count = table_size;
+    uint64_t layout = pools_checksum();
+    int fd = open(map_path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        perror("No se pudo abrir el archivo de la tabla de leases");
+        return NULL;
+    }
+    size_t wanted = sizeof(lease_map_header) + (size_t)count * sizeof(lease_record);
+    struct stat st;
+    int compatible = fstat(fd, &st) == 0 && (size_t)st.st_size == wanted;
+    if (!compatible && (ftruncate(fd, 0) != 0 || ftruncate(fd, wanted) != 0)) {
+        perror("No se pudo dimensionar el archivo de la tabla de leases");
+        close(fd);
+        return NULL;
+    }
+
+    void* base = mmap(NULL, wanted, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("No se pudo mapear el archivo de la tabla de leases");
+        return NULL;
+    }
+    lease_map_header* header = (lease_map_header*)base;
+    lease_record* records = (lease_record*)(header + 1);
+
+    compatible = compatible &&
+                 header->magic == LEASE_MAP_MAGIC &&
+                 header->version == LEASE_MAP_VERSION &&
+                 header->record_size == sizeof(lease_record) &&
+                 header->pool_start == start &&
+                 header->pool_count == count &&
+                 header->pools == pool_total &&
+                 header->layout_checksum == layout &&
+                 header->header_checksum == checksum_words(header, offsetof(lease_map_header, header_checksum));
+
+    *reused = 0;
+    if (compatible) {
+        *reused = (header->clean == 1 &&
+                   header->table_checksum == checksum_words(records, (size_t)count * sizeof(lease_record))) ? 2 : 1;
+    } else {
+        memset(header, 0, sizeof(*header));
+        header->magic = LEASE_MAP_MAGIC;
+        header->version = LEASE_MAP_VERSION;
+        header->record_size = sizeof(lease_record);
+        header->pool_start = start;
+        header->pool_count = count;
+        header->pools = pool_total;
+        header->layout_checksum = layout;
+        reset_records(records);
+    }
+
+    // Desde aquí la tabla se modifica: solo un cierre limpio vuelve a marcarla
+    map_header = header;
+    map_size = wanted;
+    header->clean = 0;
+    seal_map_header();
+    msync(header, sizeof(*header), MS_SYNC);
+    return records;
+}
+
+typedef struct {
+    unsigned long bound;
+    unsigned long conflicted;
+    unsigned long expired;
+    unsigned long invalid;
+} rebuild_counts;
+
+// Reconstruye libres, índice por MAC y heap de cada shard a partir del
+// estado de lease_table. Descarta los vencidos y los registros que no son
+// coherentes con su posición.
+static void rebuild_shards(rebuild_counts* counts) {
+    uint32_t now = (uint32_t)time(NULL);
+    memset(counts, 0, sizeof(*counts));
+    atomic_store(&spilled_leases, 0);
+
+    for (uint32_t s = 0; s < shard_count; ++s) {
+        lease_shard* shard = &shards[s];
+        pthread_mutex_lock(&shard->mutex);
+        lease_index_clear(&shard->mac_index);
+        ip_allocator_destroy(&shard->free_ips);
+        expiry_heap_destroy(&shard->expiries);
+        ip_allocator_init(&shard->free_ips, shard->count);
+        expiry_heap_init(&shard->expiries, shard->count);
+        shard->next_free = 0;
+
+        // Las posiciones del shard se recorren en orden: el pool solo avanza
+        const lease_pool* pool = pool_of_position(shard->first);
+        for (uint32_t local = 0; local < shard->count; ++local) {
+            uint32_t position = shard->first + local;
+            if (position - pool->first >= pool->count) {
+                pool++;
+            }
+            uint32_t ip = pool->start + (position - pool->first);
+            lease_record* lease = &lease_table[position];
+            lease->flags = 0;  // Las reservas se aplican después con update_lease_reservations
+            if (lease->ip != ip || lease->state > LEASE_OFFERED) {
+                memset(lease, 0, sizeof(*lease));
+                lease->ip = ip;
+                counts->invalid++;
+                continue;
+            }
+            if (lease->state == LEASE_FREE) {
+                continue;
+            }
+            // Las ofertas no están en el journal: tras un reinicio se descartan
+            if (lease->state == LEASE_OFFERED || lease->expiry <= now) {
+                lease->state = LEASE_FREE;
+                memset(lease->mac, 0, sizeof(lease->mac));
+                lease->expiry = 0;
+                counts->expired++;
+                continue;
+            }
+            ip_allocator_take(&shard->free_ips, local);
+            expiry_heap_update(&shard->expiries, local, lease->expiry);
+            if (lease->state == LEASE_BOUND) {
+                uint64_t key = lease_key(mac_bytes_to_key(lease->mac), pool->id);
+                lease_index_put(&shard->mac_index, key, position);
+                if (&shards[home_shard(pool, key)] != shard) {
+                    atomic_fetch_add(&spilled_leases, 1);
+                }
+                counts->bound++;
+            } else {
+                counts->conflicted++;
+            }
+        }
+        pthread_mutex_unlock(&shard->mutex);
+    }
+}
+
+static int compare_pools(const void* left, const void* right) {
+    const lease_pool* a = left;
+    const lease_pool* b = right;
+    return (a->start > b->start) - (a->start < b->start);
+}
+
+// Ordena los rangos por IP y les asigna posiciones consecutivas en lease_table
+static int layout_pools(const lease_range* ranges, uint32_t range_count, uint32_t max_size) {
+    if (range_count == 0 || range_count > MAX_LEASE_POOLS) {
+        log_message("ERROR", "Número de pools inválido.");
+        return -1;
+    }
+    pools = calloc(range_count, sizeof(lease_pool));
+    pool_by_id = calloc(range_count, sizeof(uint32_t));
+    if (pools == NULL || pool_by_id == NULL) {
+        log_message("ERROR", "No se pudo reservar memoria para los pools.");
+        return -1;
+    }
+    for (uint32_t i = 0; i < range_count; ++i) {
+        if (ranges[i].end < ranges[i].start) {
+            log_message("ERROR", "La IP de fin es menor que la IP de inicio.");
+            return -1;
+        }
+        uint64_t count = (uint64_t)ranges[i].end - ranges[i].start + 1;
+        if (max_size != 0 && count > max_size) {
+            count = max_size;
+        }
+        pools[i].start = ranges[i].start;
+        pools[i].count = (uint32_t)count;
+        pools[i].id = i;
+    }
+    qsort(pools, range_count, sizeof(lease_pool), compare_pools);
+
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < range_count; ++i) {
+        if (i > 0 && (uint64_t)pools[i - 1].start + pools[i - 1].count > pools[i].start) {
+            log_message("ERROR", "Los rangos de dos pools se solapan.");
+            return -1;
+        }
+        pools[i].first = (uint32_t)total;
+        pool_by_id[pools[i].id] = i;
+        total += pools[i].count;
+        if (total > MAX_POOL_SIZE) {
+            log_message("ERROR", "Los pools superan el máximo de direcciones.");
+            return -1;
+        }
+    }
+    pool_total = range_count;
+    table_size = (uint32_t)total;
+    return 0;
+}
+
+// Función para generar los pools de IPs
+int generate_ip_pools(const lease_range* ranges, uint32_t range_count, uint32_t max_size, uint32_t requested_shards) {
+    if (layout_pools(ranges, range_count, max_size) != 0) {
+        return -1;
+    }
+    uint64_t count = table_size;
+
+    // Por defecto un shard por CPU, sin bajar de LEASE_SHARD_MIN_SIZE direcciones por shard
+    uint64_t wanted = requested_shards;
+    if (wanted == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        wanted = cpus > 0 ? (uint64_t)cpus : 1;
+        if (wanted > count / LEASE_SHARD_MIN_SIZE) {
+            wanted = count / LEASE_SHARD_MIN_SIZE;
+        }
+    }
+    if (wanted > MAX_LEASE_SHARDS) {
+        wanted = MAX_LEASE_SHARDS;
+    }
+    if (wanted > count) {
+        wanted = count;
+    }
+    if (wanted == 0) {
+        wanted = 1;
+    }
+
+    // Con -m la tabla vive en un archivo mapeado y se retoma si es compatible
+    int reused = 0;
+    if (map_path != NULL) {
+        lease_table = map_lease_table(&reused);
+    } else {
+        lease_table = calloc(count, sizeof(lease_record));
+        if (lease_table != NULL) {
+            reset_records(lease_table);
+        }
+    }
+    if (lease_table == NULL || posix_memalign((void**)&shards, 64, wanted * sizeof(lease_shard)) != 0) {
+        log_message("ERROR", "No se pudo reservar memoria para la tabla de leases.");
+        return -1;
+    }
+    memset(shards, 0, wanted * sizeof(lease_shard));
+    shard_span = (uint32_t)((count + wanted - 1) / wanted);
+    shard_count = (uint32_t)((count + shard_span - 1) / shard_span);
+
+    for (uint32_t i = 0; i < shard_count; ++i) {
+        lease_shard* shard = &shards[i];
+        shard->first = i * shard_span;
+        shard->count = (i == shard_count - 1) ? table_size - shard->first : shard_span;
+        shard->timer = -1;
+        pthread_mutex_init(&shard->mutex, NULL);
+        pthread_mutex_init(&shard->history_mutex, NULL);
+        pthread_mutex_init(&shard->allocation_mutex, NULL);
+        uint32_t remembered = shard->count < LEASE_HISTORY_PER_SHARD ? shard->count : LEASE_HISTORY_PER_SHARD;
+        if (lease_index_init(&shard->mac_index, shard->count) != 0 ||
+            lease_history_init(&shard->history, remembered) != 0 ||
+            ip_allocator_init(&shard->free_ips, shard->count) != 0 ||
+            expiry_heap_init(&shard->expiries, shard->count) != 0) {
+            log_message("ERROR", "No se pudo crear el conjunto de direcciones libres.");
+            return -1;
+        }
+    }
+    for (uint32_t i = 0; i < pool_total; ++i) {
+        pools[i].shard_first = pools[i].first / shard_span;
+        pools[i].shard_count = (pools[i].first + pools[i].count - 1) / shard_span - pools[i].shard_first + 1;
+    }
+    atomic_store(&spilled_leases, 0);
+
+    map_resumed = (reused == 2);
+    if (reused) {
+        rebuild_counts counts;
+        rebuild_shards(&counts);
+        char log_entry[BUFFER_SIZE];
+        snprintf(log_entry, BUFFER_SIZE,
+                 "Tabla de leases retomada de %s (%s): %lu leases activos, %lu en cuarentena, %lu vencidos, %lu registros inválidos",
+                 map_path, map_resumed ? "cierre limpio" : "sin cierre limpio",
+                 counts.bound, counts.conflicted, counts.expired, counts.invalid);
+        log_message(map_resumed ? "INFO" : "WARNING", log_entry);
+        if (console_output) {
+            printf("%s\n", log_entry);
+        }
+    }
+    return (int)count;  // Retorna el número de direcciones generadas
+}
+
+int generate_ip_pool(const char* ip_start, const char* ip_end, uint32_t max_size, uint32_t shards) {
+    struct in_addr start_addr, end_addr;
+    if (inet_pton(AF_INET, ip_start, &start_addr) <= 0) {
+        perror("Invalid start IP address");
+        log_message("ERROR", "Dirección IP de inicio inválida.");
+        return -1;
+    }
+    if (inet_pton(AF_INET, ip_end, &end_addr) <= 0) {
+        perror("Invalid end IP address");
+        log_message("ERROR", "Dirección IP de fin inválida.");
+        return -1;
+    }
+    lease_range range = {ntohl(start_addr.s_addr), ntohl(end_addr.s_addr)};
+    return generate_ip_pools(&range, 1, max_size, shards);
+}
+
+void close_ip_pool(void) {
+    // Tomar todos los shards (en orden) para que nadie modifique la tabla después
+    for (uint32_t i = 0; i < shard_count; ++i) {
+        pthread_mutex_lock(&shards[i].mutex);
+    }
+    if (map_header != NULL) {
+        map_header->table_checksum = checksum_words(lease_table, (size_t)table_size * sizeof(lease_record));
+        map_header->clean = 1;
+        seal_map_header();
+        msync(map_header, map_size, MS_SYNC);
+    }
+}
+
+void destroy_ip_pool(void) {
+    for (uint32_t i = 0; i < shard_count; ++i) {
+        lease_index_destroy(&shards[i].mac_index);
+        ip_allocator_destroy(&shards[i].free_ips);
+        expiry_heap_destroy(&shards[i].expiries);
+        lease_history_destroy(&shards[i].history);
+        pthread_mutex_destroy(&shards[i].mutex);
+        pthread_mutex_destroy(&shards[i].history_mutex);
+        pthread_mutex_destroy(&shards[i].allocation_mutex);
+    }
+    free(shards);
+    free(pools);
+    free(pool_by_id);
+    if (map_header != NULL) {
+        munmap(map_header, map_size);
+        map_header = NULL;
+    } else {
+        free(lease_table);
+    }
+    shards = NULL;
+    lease_table = NULL;
+    pools = NULL;
+    pool_by_id = NULL;
+    shard_count = 0;
+    pool_total = 0;
+    table_size = 0;
+}
+
+uint32_t lease_shard_count(void) {
+    return shard_count;
+}
+
+uint32_t lease_pool_count(void) {
+    return pool_total;
+}
+
+int lease_pool_usage(uint32_t pool_id, uint32_t* size, uint32_t* available) {
+    const lease_pool* pool = pool_with_id(pool_id);
+    if (pool == NULL) {
+        return -1;
+    }
+    // Cada shard cuenta sus libres dentro del pool con su mutex tomado
+    uint32_t free_total = 0;
+    for (uint32_t i = 0; i < pool->shard_count; ++i) {
+        lease_shard* shard = &shards[pool->shard_first + i];
+        uint32_t low = pool->first > shard->first ? pool->first - shard->first : 0;
+        uint32_t high = pool->first + pool->count - shard->first;
+        pthread_mutex_lock(&shard->mutex);
+        free_total += (uint32_t)ip_allocator_count_free_in(&shard->free_ips, low, high);
+        pthread_mutex_unlock(&shard->mutex);
+    }
+    *size = pool->count;
+    *available = free_total;
+    return 0;
+}
+
+void get_lease_reoffer_stats(lease_reoffer_stats* stats) {
+    stats->hits = metrics_read_counter(SERVER_METRIC_REOFFER_HIT);
+    stats->taken = metrics_read_counter(SERVER_METRIC_REOFFER_TAKEN);
+    stats->unknown = metrics_read_counter(SERVER_METRIC_REOFFER_UNKNOWN);
+}
+
+void report_lease_stats(void) {
+    lease_reoffer_stats stats;
+    get_lease_reoffer_stats(&stats);
+    unsigned long total = stats.hits + stats.taken + stats.unknown;
+    char log_entry[BUFFER_SIZE];
+    snprintf(log_entry, BUFFER_SIZE,
+             "Direcciones anteriores: %lu reasignadas, %lu ocupadas, %lu sin historial (%.1f%% de aciertos)",
+             stats.hits, stats.taken, stats.unknown, total > 0 ? 100.0 * stats.hits / total : 0.0);
+    log_message("INFO", log_entry);
+    printf("%s\n", log_entry);
+}
+
+// Función para registrar un lease o una oferta ('state' LEASE_BOUND o
+// LEASE_OFFERED) hasta dentro de 'duration' segundos (requiere el mutex del
+// shard tomado). Retorna la secuencia del evento en el journal, o 0 para
+// una oferta, que solo vive en memoria.
+static uint64_t register_lease(lease_shard* shard, uint32_t position, uint64_t key, const uint8_t mac[6],
+                               time_t duration, uint8_t state) {
+    lease_record* lease = &lease_table[position];
+    lease->state = state;
+    lease->expiry = (uint32_t)(time(NULL) + duration);
+    memcpy(lease->mac, mac, sizeof(lease->mac));
+    lease_index_put(&shard->mac_index, key, position);
+    expiry_heap_update(&shard->expiries, position - shard->first, lease->expiry);
+    rearm_expiry_timer(shard);
+    if (state == LEASE_OFFERED) {
+        return 0;
+    }
+    return lease_journal_append(JOURNAL_BIND, lease->ip, lease->mac, lease->expiry);
+}
+
+// Vuelve a dar a la MAC la dirección que ya tenga en el shard dentro del
+// pool de 'key'. Una oferta no acorta un lease vigente: se copia tal cual.
+// Retorna -1 si no tiene ninguna (requiere el mutex del shard tomado).
+static int reoffer_locked(lease_shard* shard, uint64_t key, const uint8_t mac[6], time_t duration,
+                          uint8_t state, lease_record* lease, uint64_t* sequence) {
+    uint32_t position;
+    if (lease_index_get(&shard->mac_index, key, &position) != 0) {
+        return -1;
+    }
+    if (state == LEASE_OFFERED && lease_table[position].state == LEASE_BOUND) {
+        *sequence = 0;
+    } else {
+        *sequence = register_lease(shard, position, key, mac, duration, state);
+    }
+    *lease = lease_table[position];
+    return 0;
+}
+
+static int reoffer_in_shard(lease_shard* shard, uint64_t key, const uint8_t mac[6], time_t duration,
+                            uint8_t state, lease_record* lease, uint64_t* sequence) {
+    pthread_mutex_lock(&shard->mutex);
+    int result = reoffer_locked(shard, key, mac, duration, state, lease, sequence);
+    pthread_mutex_unlock(&shard->mutex);
+    return result;
+}
+
+// Asigna la siguiente dirección libre del pool dentro del shard a partir de la
+// última asignada, volviendo al principio al llegar al final. Retorna 0 si
+// registró una dirección nueva, 1 si la MAC ya tenía una en el shard (otra
+// solicitud suya la registró después de la búsqueda inicial) y -1 si no quedan.
+static int allocate_in_shard(lease_shard* shard, const lease_pool* pool, uint64_t key, const uint8_t mac[6],
+                             time_t duration, uint8_t state, lease_record* lease, uint64_t* sequence) {
+    // Parte del shard que ocupa el pool (posiciones locales)
+    uint32_t low = pool->first > shard->first ? pool->first - shard->first : 0;
+    uint32_t high = pool->first + pool->count - shard->first;
+    if (high > shard->count) {
+        high = shard->count;
+    }
+    pthread_mutex_lock(&shard->mutex);
+    // La búsqueda de search_shards soltó el mutex: se repite antes de
+    // tomar otra dirección, o la MAC quedaría con dos y una sin índice
+    if (reoffer_locked(shard, key, mac, duration, state, lease, sequence) == 0) {
+        pthread_mutex_unlock(&shard->mutex);
+        return 1;
+    }
+    // Next Fit: una dirección liberada no se vuelve a entregar hasta que el
+    // cursor da la vuelta, así su antiguo dueño la recupera si vuelve antes
+    uint32_t cursor = shard->next_free > low ? shard->next_free : low;
+    long local = cursor < high ? ip_allocator_take_first_in(&shard->free_ips, cursor, high) : -1;
+    if (local < 0) {
+        local = ip_allocator_take_first_in(&shard->free_ips, low, cursor < high ? cursor : high);
+    }
+    if (local < 0) {
+        pthread_mutex_unlock(&shard->mutex);
+        return -1;
+    }
+    shard->next_free = (uint32_t)local + 1;
+    uint32_t position = shard->first + (uint32_t)local;
+    *sequence = register_lease(shard, position, key, mac, duration, state);
+    *lease = lease_table[position];
+    pthread_mutex_unlock(&shard->mutex);
+    return 0;
+}
+
+// Vuelve a asignar al cliente la última dirección que tuvo en el pool si
+// sigue libre. Retorna -1 si no la recuerda o ya no está disponible.
+static int reuse_previous_address(const lease_pool* pool, uint64_t key, const uint8_t mac[6], time_t duration,
+                                  uint8_t state, lease_record* lease, uint64_t* sequence) {
+    lease_shard* home = &shards[home_shard(pool, key)];
+    uint32_t position;
+    pthread_mutex_lock(&home->history_mutex);
+    int remembered = lease_history_take(&home->history, key, &position) == 0;
+    pthread_mutex_unlock(&home->history_mutex);
+    if (!remembered) {
+        metrics_add(SERVER_METRIC_REOFFER_UNKNOWN, 1);
+        return -1;
+    }
+
+    lease_shard* shard = &shards[position / shard_span];
+    pthread_mutex_lock(&shard->mutex);
+    // Otra solicitud de la misma MAC pudo registrarle una dirección en este shard
+    if (reoffer_locked(shard, key, mac, duration, state, lease, sequence) == 0) {
+        pthread_mutex_unlock(&shard->mutex);
+        return 0;
+    }
+    // Libre y sin reserva: entonces está en el conjunto de libres y se puede tomar
+    if (lease_table[position].state != LEASE_FREE || (lease_table[position].flags & LEASE_FLAG_RESERVED) ||
+        ip_allocator_take(&shard->free_ips, position - shard->first) != 0) {
+        pthread_mutex_unlock(&shard->mutex);
+        metrics_add(SERVER_METRIC_REOFFER_TAKEN, 1);
+        return -1;
+    }
+    if (shard != home) {
+        atomic_fetch_add(&spilled_leases, 1);
+    }
+    *sequence = register_lease(shard, position, key, mac, duration, state);
+    *lease = lease_table[position];
+    pthread_mutex_unlock(&shard->mutex);
+    metrics_add(SERVER_METRIC_REOFFER_HIT, 1);
+    return 0;
+}
+
+// Solo se recorren los shards que cubren el pool, empezando por el de afinidad
+// (requiere el allocation_mutex del shard de afinidad tomado)
+static int search_shards(const lease_pool* pool, uint64_t key, const uint8_t mac[6], time_t duration,
+                            uint8_t state, lease_record* lease, uint64_t* sequence) {
+    uint32_t home = home_shard(pool, key) - pool->shard_first;
+    uint32_t span = pool->shard_count;
+
+    // Si el cliente ya tiene un lease, se le ofrece de nuevo la misma dirección.
+    // Normalmente está en su shard; solo si hay leases desbordados se miran los demás.
+    if (reoffer_in_shard(&shards[pool->shard_first + home], key, mac, duration, state, lease, sequence) == 0) {
+        return 0;
+    }
+    if (atomic_load(&spilled_leases) > 0) {
+        for (uint32_t i = 1; i < span; ++i) {
+            lease_shard* shard = &shards[pool->shard_first + (home + i) % span];
+            if (reoffer_in_shard(shard, key, mac, duration, state, lease, sequence) == 0) {
+                return 0;
+            }
+        }
+    }
+
+    // Sin lease vigente: la dirección que tuvo antes, si sigue libre, y si no la primera libre
+    if (reuse_previous_address(pool, key, mac, duration, state, lease, sequence) == 0 ||
+        allocate_in_shard(&shards[pool->shard_first + home], pool, key, mac, duration, state, lease, sequence) >= 0) {
+        return 0;
+    }
+    // Shard de afinidad lleno: desbordar al siguiente con direcciones libres
+    for (uint32_t i = 1; i < span; ++i) {
+        lease_shard* shard = &shards[pool->shard_first + (home + i) % span];
+        int allocated = allocate_in_shard(shard, pool, key, mac, duration, state, lease, sequence);
+        if (allocated >= 0) {
+            if (allocated == 0) {
+                atomic_fetch_add(&spilled_leases, 1);
+            }
+            return 0;
+        }
+    }
+    return -1;  // No hay direcciones disponibles
+}
+
+static int assign_in_shards(const lease_pool* pool, uint64_t key, const uint8_t mac[6], time_t duration,
+                            uint8_t state, lease_record* lease, uint64_t* sequence) {
+    lease_shard* home = &shards[home_shard(pool, key)];
+    pthread_mutex_lock(&home->allocation_mutex);
+    int result = search_shards(pool, key, mac, duration, state, lease, sequence);
+    pthread_mutex_unlock(&home->allocation_mutex);
+    return result;
+}
+
+// Función para asignar una IP disponible del pool indicado
+int assign_ip(uint32_t pool_id, const uint8_t mac[6], time_t lease_duration, lease_record* lease) {
+    const lease_pool* pool = pool_with_id(pool_id);
+    uint64_t sequence;
+    if (pool == NULL ||
+        assign_in_shards(pool, lease_key(mac_bytes_to_key(mac), pool_id), mac, lease_duration, LEASE_BOUND,
+                         lease, &sequence) != 0) {
+        return -1;
+    }
+    lease_journal_wait(sequence);  // El lease debe estar en disco antes de responder
+
+    char ip_str[INET_ADDRSTRLEN];
+    char client_mac[LEASE_MAC_STRLEN];
+    lease_ip_string(lease, ip_str);
+    lease_mac_string(mac, client_mac);
+    if (console_output) {
+        // Mejorar el formato de la salida en consola
+        printf("\n**** LEASE REGISTRADO ****\n");
+        printf("IP Asignada: %s\n", ip_str);
+        printf("MAC Cliente: %s\n", client_mac);
+        printf("Duración Lease: %ld segundos\n", lease_duration);
+        printf("**************************\n\n");
+    }
+
+    char log_entry[BUFFER_SIZE];
+    snprintf(log_entry, BUFFER_SIZE, "Lease registrado para la IP %s con MAC %s por %ld segundos", ip_str, client_mac, lease_duration);
+    log_message("INFO", log_entry);
+    return 0;
+}
+
+// Reserva una dirección para el DHCPOFFER sin registrar el lease completo:
+// un cliente que nunca envía DHCPREQUEST solo la retiene 'hold_time' segundos
+int offer_ip(uint32_t pool_id, const uint8_t mac[6], time_t hold_time, lease_record* lease) {
+    const lease_pool* pool = pool_with_id(pool_id);
+    uint64_t sequence;
+    if (pool == NULL ||
+        assign_in_shards(pool, lease_key(mac_bytes_to_key(mac), pool_id), mac, hold_time, LEASE_OFFERED,
+                         lease, &sequence) != 0) {
+        return -1;
+    }
+    lease_journal_wait(sequence);  // Solo espera si era una reasignación de un lease vigente
+
+    char ip_str[INET_ADDRSTRLEN];
+    char client_mac[LEASE_MAC_STRLEN];
+    char log_entry[BUFFER_SIZE];
+    if (lease->state == LEASE_OFFERED) {
+        snprintf(log_entry, BUFFER_SIZE, "IP %s ofrecida a la MAC %s y retenida %ld segundos",
+                 lease_ip_string(lease, ip_str), lease_mac_string(mac, client_mac), hold_time);
+    } else {
+        snprintf(log_entry, BUFFER_SIZE, "IP %s ofrecida de nuevo a la MAC %s, que ya tiene su lease",
+                 lease_ip_string(lease, ip_str), lease_mac_string(mac, client_mac));
+    }
+    log_message("INFO", log_entry);
+    return 0;
+}
+
+int cancel_offer(uint32_t pool_id, const uint8_t mac[6]) {
+    const lease_pool* pool = pool_with_id(pool_id);
+    if (pool == NULL) {
+        return -1;
+    }
+    uint64_t key = lease_key(mac_bytes_to_key(mac), pool_id);
+    uint32_t home = home_shard(pool, key) - pool->shard_first;
+    uint32_t span = atomic_load(&spilled_leases) > 0 ? pool->shard_count : 1;
+    for (uint32_t i = 0; i < span; ++i) {
+        lease_shard* shard = &shards[pool->shard_first + (home + i) % pool->shard_count];
+        uint32_t position;
+        pthread_mutex_lock(&shard->mutex);
+        if (lease_index_get(&shard->mac_index, key, &position) != 0) {
+            pthread_mutex_unlock(&shard->mutex);
+            continue;
+        }
+        int cancelled = lease_table[position].state == LEASE_OFFERED;
+        uint32_t ip = lease_table[position].ip;
+        if (cancelled) {
+            clear_binding(shard, position);
+            return_address(shard, position);
+            rearm_expiry_timer(shard);
+        }
+        pthread_mutex_unlock(&shard->mutex);
+
+        if (cancelled) {
+            metrics_add(SERVER_METRIC_OFFER_CANCELLED, 1);
+            char ip_str[INET_ADDRSTRLEN];
+            char client_mac[LEASE_MAC_STRLEN];
+            char log_entry[BUFFER_SIZE];
+            snprintf(log_entry, BUFFER_SIZE, "Oferta de la IP %s retirada: la MAC %s eligió otro servidor",
+                     lease_address_string(ip, ip_str), lease_mac_string(mac, client_mac));
+            log_message("INFO", log_entry);
+        }
+        return cancelled ? 0 : -1;
+    }
+    return -1;
+}
+
+// Deja libre la dirección que tenía la MAC y la devuelve al conjunto de
+// libres (requiere el mutex del shard tomado). Retorna la secuencia del
+// journal, o 0 si era una oferta, que no está en el journal.
+static uint64_t drop_binding_locked(lease_shard* shard, uint32_t position) {
+    int bound = lease_table[position].state == LEASE_BOUND;
+    clear_binding(shard, position);
+    return_address(shard, position);
+    rearm_expiry_timer(shard);
+    return bound ? lease_journal_append(JOURNAL_RELEASE, lease_table[position].ip, NULL, 0) : 0;
+}
+
+// Libera el lease que la clave tenga en el pool fuera de 'keep' (la posición reservada)
+static void drop_other_binding(const lease_pool* pool, uint64_t key, uint32_t keep) {
+    uint32_t home = home_shard(pool, key) - pool->shard_first;
+    uint32_t span = atomic_load(&spilled_leases) > 0 ? pool->shard_count : 1;
+    for (uint32_t i = 0; i < span; ++i) {
+        lease_shard* shard = &shards[pool->shard_first + (home + i) % pool->shard_count];
+        uint32_t position;
+        uint64_t sequence = 0;
+        pthread_mutex_lock(&shard->mutex);
+        // En el shard de la reserva el índice ya apunta a 'keep': seguir buscando
+        int found = lease_index_get(&shard->mac_index, key, &position) == 0 && position != keep;
+        if (found) {
+            sequence = drop_binding_locked(shard, position);
+        }
+        pthread_mutex_unlock(&shard->mutex);
+        lease_journal_wait(sequence);
+        if (found) {
+            return;
+        }
+    }
+}
+
+int offer_reserved_ip(uint32_t pool_id, uint32_t ip, const uint8_t mac[6], time_t hold_time,
+                      lease_record* lease) {
+    uint32_t position;
+    const lease_pool* pool;
+    lease_shard* shard = shard_of_ip(ip, &position, &pool);
+    if (shard == NULL || pool->id != pool_id) {
+        return -1;  // La reserva es de otra subred o quedó fuera del pool (-n)
+    }
+    uint64_t mac_key = mac_bytes_to_key(mac);
+    uint64_t key = lease_key(mac_key, pool_id);
+
+    // Primero se confirma y se toma la reserva; la dirección que la MAC tenía
+    // antes solo se suelta si la reserva se pudo usar
+    lease_shard* home = &shards[home_shard(pool, key)];
+    pthread_mutex_lock(&home->allocation_mutex);
+    pthread_mutex_lock(&shard->mutex);
+    lease_record* current = &lease_table[position];
+    int rebinding = (current->state == LEASE_BOUND || current->state == LEASE_OFFERED) &&
+                    mac_bytes_to_key(current->mac) == mac_key;
+    if (!rebinding && current->state != LEASE_FREE) {
+        // La usa otro cliente (la reserva es posterior a su lease) o está en cuarentena
+        pthread_mutex_unlock(&shard->mutex);
+        pthread_mutex_unlock(&home->allocation_mutex);
+        return -1;
+    }
+    uint64_t sequence = 0;
+    if (!rebinding) {
+        // Si la dirección anterior está en este mismo shard se suelta aquí:
+        // register_lease reemplaza su entrada del índice por la reservada
+        uint32_t previous;
+        if (lease_index_get(&shard->mac_index, key, &previous) == 0) {
+            sequence = drop_binding_locked(shard, previous);
+        }
+        ip_allocator_take(&shard->free_ips, position - shard->first);  // Ya tomada si está marcada
+        if (home != shard) {
+            atomic_fetch_add(&spilled_leases, 1);
+        }
+    }
+    // Un lease vigente de la misma MAC se conserva; si no, la dirección queda ofrecida
+    if (current->state != LEASE_BOUND) {
+        register_lease(shard, position, key, mac, hold_time, LEASE_OFFERED);
+    }
+    *lease = *current;
+    pthread_mutex_unlock(&shard->mutex);
+    lease_journal_wait(sequence);
+    if (!rebinding) {
+        drop_other_binding(pool, key, position);  // Dirección anterior en otro shard
+    }
+    pthread_mutex_unlock(&home->allocation_mutex);
+
+    char ip_str[INET_ADDRSTRLEN];
+    char client_mac[LEASE_MAC_STRLEN];
+    char log_entry[BUFFER_SIZE];
+    snprintf(log_entry, BUFFER_SIZE, "IP reservada %s ofrecida a la MAC %s",
+             lease_ip_string(lease, ip_str), lease_mac_string(mac, client_mac));
+    log_message("INFO", log_entry);
+    if (console_output) {
+        printf("%s\n", log_entry);
+    }
+    return 0;
+}
+
+// Marca o desmarca la reserva de una IP y ajusta el conjunto de libres
+static void set_reserved(uint32_t ip, int reserved) {
+    uint32_t position;
+    lease_shard* shard = shard_of_ip(ip, &position, NULL);
+    if (shard == NULL) {
+        return;  // Fuera de los pools cargados (-n)
+    }
+    pthread_mutex_lock(&shard->mutex);
+    lease_record* lease = &lease_table[position];
+    uint32_t local = position - shard->first;
+    if (reserved) {
+        lease->flags |= LEASE_FLAG_RESERVED;
+        if (lease->state == LEASE_FREE) {
+            ip_allocator_take(&shard->free_ips, local);
+        }
+    } else if (lease->flags & LEASE_FLAG_RESERVED) {
+        lease->flags &= (uint8_t)~LEASE_FLAG_RESERVED;
+        if (lease->state == LEASE_FREE) {
+            ip_allocator_free(&shard->free_ips, local);
+        }
+    }
+    pthread_mutex_unlock(&shard->mutex);
+}
+
+void update_lease_reservations(const uint32_t* previous, uint32_t previous_count,
+                               const uint32_t* current, uint32_t current_count) {
+    // Mezcla de las dos listas ordenadas: solo se tocan las IPs que cambian
+    uint32_t i = 0, j = 0;
+    while (i < previous_count || j < current_count) {
+        if (j == current_count || (i < previous_count && previous[i] < current[j])) {
+            set_reserved(previous[i++], 0);
+        } else if (i == previous_count || current[j] < previous[i]) {
+            set_reserved(current[j++], 1);
+        } else {
+            i++;
+            j++;
+        }
+    }
+}
+
+// Función para renovar un lease
+int renew_assigned_lease(uint32_t pool_id, uint32_t ip, const uint8_t mac[6], time_t lease_duration,
+                         lease_record* lease) {
+    uint64_t mac_key = mac_bytes_to_key(mac);
+    uint32_t position;
+    const lease_pool* pool;
+    lease_shard* shard = shard_of_ip(ip, &position, &pool);
+    if (shard == NULL || pool->id != pool_id) {
+        return -1;  // La IP no es de la subred por la que llegó la solicitud
+    }
+
+    pthread_mutex_lock(&shard->mutex);
+    lease_record* current = &lease_table[position];
+    if ((current->state != LEASE_BOUND && current->state != LEASE_OFFERED) ||
+        mac_bytes_to_key(current->mac) != mac_key) {
+        pthread_mutex_unlock(&shard->mutex);
+        return -1;
+    }
+    // La oferta se convierte en lease: sigue en el índice por MAC y en el heap
+    int confirmed = current->state == LEASE_OFFERED;
+    current->state = LEASE_BOUND;
+    current->expiry = (uint32_t)(time(NULL) + lease_duration);
+    expiry_heap_update(&shard->expiries, position - shard->first, current->expiry);
+    rearm_expiry_timer(shard);
+    uint64_t sequence = lease_journal_append(JOURNAL_BIND, current->ip, current->mac, current->expiry);
+    *lease = *current;
+    pthread_mutex_unlock(&shard->mutex);
+    lease_journal_wait(sequence);
+
+    char ip_str[INET_ADDRSTRLEN];
+    char mac_address[LEASE_MAC_STRLEN];
+    lease_ip_string(lease, ip_str);
+    lease_mac_string(mac, mac_address);
+    if (confirmed) {
+        metrics_add(SERVER_METRIC_OFFER_CONFIRMED, 1);
+        if (console_output) {
+            printf("\n**** LEASE REGISTRADO ****\n");
+            printf("IP Asignada: %s\n", ip_str);
+            printf("MAC Cliente: %s\n", mac_address);
+            printf("Duración Lease: %ld segundos\n", lease_duration);
+            printf("**************************\n\n");
+        }
+        char log_entry[BUFFER_SIZE];
+        snprintf(log_entry, BUFFER_SIZE, "Lease registrado para la IP %s con MAC %s por %ld segundos", ip_str, mac_address, lease_duration);
+        log_message("INFO", log_entry);
+        return 0;
+    }
+    if (console_output) {
+        // Mejorar el formato de la salida en consola
+        printf("\n---- LEASE RENOVADO ----\n");
+        printf("IP Renovada: %s\n", ip_str);
+        printf("MAC Cliente: %s\n", mac_address);
+        printf("Nueva Duración: %ld segundos\n", lease_duration);
+        printf("------------------------\n\n");
+    }
+
+    char log_entry[BUFFER_SIZE];
+    snprintf(log_entry, BUFFER_SIZE, "Lease renovado para la IP %s con MAC %s por %ld segundos", ip_str, mac_address, lease_duration);
+    log_message("INFO", log_entry);
+    return 0;
+}
+
+// Función para liberar una IP
+int release_ip(uint32_t ip, const uint8_t mac[6]) {
+    uint64_t mac_key = mac_bytes_to_key(mac);
+    uint32_t position;
+    lease_shard* shard = shard_of_ip(ip, &position, NULL);
+    if (shard == NULL) {
+        log_message("WARNING", "DHCPRELEASE de una IP fuera del pool.");
+        return -1;
+    }
+
+    pthread_mutex_lock(&shard->mutex);
+    lease_record* lease = &lease_table[position];
+    int released = 0;
+    uint64_t sequence = 0;
+    if (lease->state == LEASE_BOUND && mac_bytes_to_key(lease->mac) == mac_key) {
+        remember_address(position);
+        clear_binding(shard, position);
+        return_address(shard, position);
+        rearm_expiry_timer(shard);
+        sequence = lease_journal_append(JOURNAL_RELEASE, lease->ip, NULL, 0);
+        released = 1;
+    }
+    pthread_mutex_unlock(&shard->mutex);
+    lease_journal_wait(sequence);
+
+    char ip_str[INET_ADDRSTRLEN];
+    char mac_address[LEASE_MAC_STRLEN];
+    lease_address_string(ip, ip_str);
+    lease_mac_string(mac, mac_address);
+    if (released) {
+        if (console_output) {
+            printf("\n---- IP LIBERADA ----\n");
+            printf("IP: %s\n", ip_str);
+            printf("MAC Cliente: %s\n", mac_address);
+            printf("---------------------\n\n");
+        }
+
+        char log_entry[BUFFER_SIZE];
+        snprintf(log_entry, BUFFER_SIZE, "IP %s liberada y disponible para nuevos clientes", ip_str);
+        log_message("INFO", log_entry);
+    } else {
+        if (console_output) {
+            printf("La MAC %s no coincide con el registro para la IP %s\n", mac_address, ip_str);
+        }
+        log_message("WARNING", "Intento de liberar una IP con una MAC que no coincide.");
+    }
+    return released ? 0 : -1;
+}
+
+// Procesa los vencimientos de un shard. Cada entrada se saca con el mutex
+// tomado y se informa después de soltarlo.
+static void expire_shard(lease_shard* shard) {
+    uint32_t current_time = (uint32_t)time(NULL);
+    char ip_str[INET_ADDRSTRLEN];
+    char log_entry[BUFFER_SIZE];
+
+    while (1) {
+        pthread_mutex_lock(&shard->mutex);
+        long local = expiry_heap_pop_expired(&shard->expiries, current_time);
+        if (local < 0) {
+            // Forzar la reprogramación: el temporizador ya disparó (o el reloj cambió)
+            shard->armed_expiry = EXPIRY_HEAP_NONE;
+            rearm_expiry_timer(shard);
+            pthread_mutex_unlock(&shard->mutex);
+            return;
+        }
+        uint32_t position = shard->first + (uint32_t)local;
+        lease_record* lease = &lease_table[position];
+        uint8_t state = lease->state;
+        lease_ip_string(lease, ip_str);
+        remember_address(position);
+        clear_binding(shard, position);
+        return_address(shard, position);
+        if (state != LEASE_OFFERED) {
+            // Sin esperar al disco: si se pierde, la recuperación lo vuelve a dar por vencido
+            lease_journal_append(JOURNAL_EXPIRE, lease->ip, NULL, 0);
+        }
+        pthread_mutex_unlock(&shard->mutex);
+
+        if (state == LEASE_CONFLICT) {
+            metrics_add(SERVER_METRIC_QUARANTINE_ENDED, 1);
+            snprintf(log_entry, BUFFER_SIZE, "IP %s en conflicto ahora está disponible.", ip_str);
+        } else if (state == LEASE_OFFERED) {
+            // Frecuente en una tormenta de DHCPDISCOVER: solo en el log de depuración
+            metrics_add(SERVER_METRIC_OFFER_EXPIRED, 1);
+            snprintf(log_entry, BUFFER_SIZE, "Oferta sin DHCPREQUEST para la IP %s. Liberando la dirección.", ip_str);
+            log_message("DEBUG", log_entry);
+            continue;
+        } else {
+            metrics_add(SERVER_METRIC_EXPIRED, 1);
+            snprintf(log_entry, BUFFER_SIZE, "Lease expirado para la IP %s. Liberando la dirección.", ip_str);
+        }
+        log_message("INFO", log_entry);
+        if (console_output) {
+            printf("%s\n", log_entry);
+        }
+    }
+}
+
+// Libera los leases y ofertas vencidos y devuelve al pool las direcciones
+// cuya cuarentena por conflicto terminó. Solo recorre las entradas vencidas.
+void check_expired_leases(void) {
+    for (uint32_t i = 0; i < shard_count; ++i) {
+        expire_shard(&shards[i]);
+    }
+}
+
+// Aplica un registro del journal directamente sobre lease_table; los índices
+// se reconstruyen al final de la recuperación
+static void apply_journal_record(const journal_record* record, void* context) {
+    unsigned long* ignored = (unsigned long*)context;
+    const lease_pool* pool = pool_of_ip(record->ip);
+    if (pool == NULL) {
+        (*ignored)++;  // La IP ya no está en ningún pool configurado
+        return;
+    }
+    lease_record* lease = &lease_table[pool->first + (record->ip - pool->start)];
+    switch (record->type) {
+        case JOURNAL_BIND:
+            lease->state = LEASE_BOUND;
+            memcpy(lease->mac, record->mac, sizeof(lease->mac));
+            lease->expiry = record->expiry;
+            break;
+        case JOURNAL_DECLINE:
+            lease->state = LEASE_CONFLICT;
+            memset(lease->mac, 0, sizeof(lease->mac));
+            lease->expiry = record->expiry;
+            break;
+        default:  // JOURNAL_RELEASE y JOURNAL_EXPIRE
+            lease->state = LEASE_FREE;
+            memset(lease->mac, 0, sizeof(lease->mac));
+            lease->expiry = 0;
+            break;
+    }
+}
+
+long recover_leases(void) {
+    unsigned long ignored = 0;
+    long applied = lease_journal_recover(apply_journal_record, &ignored);
+    if (applied < 0) {
+        return -1;
+    }
+
+    rebuild_counts counts;
+    rebuild_shards(&counts);
+
+    if (applied > 0) {
+        char log_entry[BUFFER_SIZE];
+        snprintf(log_entry, BUFFER_SIZE,
+                 "Recuperados %ld registros del journal: %lu leases activos, %lu en cuarentena, %lu vencidos, %lu fuera del pool",
+                 applied, counts.bound, counts.conflicted, counts.expired, ignored);
+        log_message("INFO", log_entry);
+        if (console_output) {
+            printf("%s\n", log_entry);
+        }
+    }
+    return applied;
+}
+
+int write_lease_snapshot(int fd, void* context) {
+    (void)context;
+    journal_record* records = malloc((size_t)shard_span * sizeof(journal_record));
+    if (records == NULL) {
+        return -1;
+    }
+
+    // Cada shard se copia con su mutex y se escribe sin él. Los cambios
+    // posteriores a la rotación del journal también están en el journal nuevo.
+    int total = 0;
+    for (uint32_t s = 0; s < shard_count; ++s) {
+        lease_shard* shard = &shards[s];
+        size_t count = 0;
+        pthread_mutex_lock(&shard->mutex);
+        for (uint32_t local = 0; local < shard->count; ++local) {
+            const lease_record* lease = &lease_table[shard->first + local];
+            if (lease->state == LEASE_BOUND) {
+                lease_journal_make_record(&records[count++], JOURNAL_BIND, lease->ip, lease->mac, lease->expiry);
+            } else if (lease->state == LEASE_CONFLICT) {
+                lease_journal_make_record(&records[count++], JOURNAL_DECLINE, lease->ip, NULL, lease->expiry);
+            }
+        }
+        pthread_mutex_unlock(&shard->mutex);
+
+        if (lease_journal_write_records(fd, records, count) != 0) {
+            free(records);
+            return -1;
+        }
+        total += (int)count;
+    }
+    free(records);
+    return total;
+}
+
+// Hilo de expiración: espera a los temporizadores de los shards y procesa
+// los vencimientos del shard que disparó
+static void* expiry_loop(void* arg) {
+    int epoll_fd = (int)(intptr_t)arg;
+    struct epoll_event events[MAX_LEASE_SHARDS];
+    uint64_t expirations;
+
+    while (1) {
+        int ready = epoll_wait(epoll_fd, events, MAX_LEASE_SHARDS, -1);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("No se pudo esperar a los temporizadores de expiración");
+            log_message("ERROR", "No se pudo esperar a los temporizadores de expiración de leases.");
+            return NULL;
+        }
+        for (int i = 0; i < ready; ++i) {
+            lease_shard* shard = &shards[events[i].data.u32];
+            // ECANCELED indica que el reloj del sistema cambió: se revisa y se reprograma igual
+            if (read(shard->timer, &expirations, sizeof(expirations)) < 0 && errno != ECANCELED && errno != EAGAIN) {
+                perror("No se pudo leer el temporizador de expiración");
+            }
+            expire_shard(shard);
+        }
+    }
+    return NULL;
+}
+
+int start_lease_expiry(void) {
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        perror("epoll_create1");
+        return -1;
+    }
+
+    // Un temporizador por shard, todos atendidos por el mismo hilo
+    for (uint32_t i = 0; i < shard_count; ++i) {
+        int timer = timerfd_create(CLOCK_REALTIME, TFD_CLOEXEC | TFD_NONBLOCK);
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.u32 = i;
+        if (timer < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer, &event) != 0) {
+            perror("timerfd_create");
+            return -1;
+        }
+        pthread_mutex_lock(&shards[i].mutex);
+        shards[i].timer = timer;
+        rearm_expiry_timer(&shards[i]);
+        pthread_mutex_unlock(&shards[i].mutex);
+    }
+
+    pthread_t thread_id;
+    if (pthread_create(&thread_id, NULL, expiry_loop, (void*)(intptr_t)epoll_fd) != 0) {
+        return -1;
+    }
+    pthread_detach(thread_id);
+    return 0;
+}
+
+// Función para manejar el mensaje DHCPDECLINE enviado por el cliente
+int handle_decline(uint32_t ip, const uint8_t mac[6]) {
+    uint64_t mac_key = mac_bytes_to_key(mac);
+    uint32_t position;
+    lease_shard* shard = shard_of_ip(ip, &position, NULL);
+    if (shard == NULL) {
+        log_message("WARNING", "DHCPDECLINE de una IP fuera del pool.");
+        return -1;
+    }
+
+    pthread_mutex_lock(&shard->mutex);
+    lease_record* lease = &lease_table[position];
+    int declined = 0;
+    uint64_t sequence = 0;
+    if (lease->state == LEASE_BOUND && mac_bytes_to_key(lease->mac) == mac_key) {
+        clear_binding(shard, position);
+        lease->state = LEASE_CONFLICT;
+        lease->expiry = (uint32_t)(time(NULL) + CONFLICT_QUARANTINE);  // Fin de la cuarentena
+        expiry_heap_update(&shard->expiries, position - shard->first, lease->expiry);
+        rearm_expiry_timer(shard);
+        sequence = lease_journal_append(JOURNAL_DECLINE, lease->ip, NULL, lease->expiry);
+        declined = 1;
+    }
+    pthread_mutex_unlock(&shard->mutex);
+    lease_journal_wait(sequence);
+
+    if (declined) {
+        char ip_str[INET_ADDRSTRLEN];
+        char mac_address[LEASE_MAC_STRLEN];
+        char log_entry[BUFFER_SIZE];
+        snprintf(log_entry, BUFFER_SIZE, "IP %s rechazada por el cliente %s y liberada.",
+                 lease_address_string(ip, ip_str), lease_mac_string(mac, mac_address));
+        log_message("INFO", log_entry);
+        if (console_output) {
+            printf("%s\n", log_entry);
+        }
+    }
+    return declined ? 0 : -1;
+}
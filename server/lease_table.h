@@ -0,0 +1,151 @@
+#ifndef LEASE_TABLE_H
+#define LEASE_TABLE_H
+
+#include <stdint.h>
+#include <time.h>
+
+#define MAX_POOL_SIZE (1u << 24)     // Direcciones de todos los pools juntos (y límite para -n)
+#define MAX_LEASE_POOLS 16384        // Pools (uno por subred)
+#define CONFLICT_QUARANTINE 300      // Segundos que una IP rechazada queda fuera del pool
+#define MAX_LEASE_SHARDS 64          // Límite para -s
+#define LEASE_SHARD_MIN_SIZE 64      // Direcciones mínimas por shard al elegir el número automáticamente
+#define LEASE_HISTORY_PER_SHARD 65536 // Direcciones anteriores recordadas por shard (LRU)
+
+// Estado de una dirección del pool
+enum {
+    LEASE_FREE = 0,      // Disponible para asignar
+    LEASE_BOUND = 1,     // Asignada a una MAC hasta 'expiry'
+    LEASE_CONFLICT = 2,  // Rechazada con DHCPDECLINE, en cuarentena hasta 'expiry'
+    LEASE_OFFERED = 3    // Ofrecida a una MAC con DHCPOFFER, reservada hasta 'expiry'
+};
+
+// Registro de arrendamiento compacto (16 bytes). Los parámetros de red
+// (máscara, gateway, DNS) no se copian en cada registro: son comunes a la
+// subred y se toman de la configuración compartida al construir la respuesta.
+typedef struct {
+    uint32_t ip;         // Dirección IP (orden de host)
+    uint32_t expiry;     // Fin del lease, de la oferta o de la cuarentena (segundos desde epoch)
+    uint8_t mac[6];      // MAC del cliente (ceros si está libre)
+    uint8_t state;       // LEASE_FREE, LEASE_BOUND, LEASE_CONFLICT o LEASE_OFFERED
+    uint8_t flags;       // LEASE_FLAG_RESERVED
+} lease_record;
+
+// La dirección tiene una reserva estática: nunca vuelve al conjunto de libres
+#define LEASE_FLAG_RESERVED 0x01
+
+// Rango de direcciones de un pool (orden de host, ambos extremos incluidos)
+typedef struct {
+    uint32_t start;
+    uint32_t end;
+} lease_range;
+
+// Genera un pool por rango; el identificador de cada pool es su índice en
+// 'ranges'. Cada pool tiene como máximo 'max_size' direcciones (0 = sin
+// límite) y los rangos no pueden solaparse. Todos los pools comparten una
+// tabla que se parte en 'shards' rangos contiguos de posiciones, cada uno con
+// su propio mutex; con 0 se usa un shard por CPU. Cada (MAC, pool) tiene un
+// shard de afinidad entre los que cubren su pool, donde se le asigna
+// dirección mientras haya libres. Retorna el total de direcciones o -1.
+int generate_ip_pools(const lease_range* ranges, uint32_t range_count, uint32_t max_size, uint32_t shards);
+
+// Un solo pool (identificador 0) de 'ip_start' a 'ip_end'
+int generate_ip_pool(const char* ip_start, const char* ip_end, uint32_t max_size, uint32_t shards);
+void destroy_ip_pool(void);
+
+// Guarda lease_table en un archivo mapeado (llamar antes de generate_ip_pool).
+// Si el archivo ya tiene una tabla compatible (misma versión y mismos pools,
+// cabecera válida) generate_ip_pool la retoma sin reconstruirla.
+void set_lease_map_file(const char* path);
+
+// 1 si generate_ip_pool retomó una tabla mapeada cerrada limpiamente
+// (suma de verificación correcta): no hace falta reproducir el journal
+int lease_table_resumed(void);
+
+// Cierre limpio: bloquea todos los shards y marca el archivo mapeado como consistente
+void close_ip_pool(void);
+uint32_t lease_shard_count(void);
+uint32_t lease_pool_count(void);
+
+// Direcciones del pool 'pool_id' y cuántas siguen libres (sin lease, reserva
+// ni cuarentena). Retorna -1 si el pool no existe.
+int lease_pool_usage(uint32_t pool_id, uint32_t* size, uint32_t* available);
+
+// Clientes sin lease vigente: cuántos recibieron su dirección anterior, cuántos
+// la encontraron ocupada y cuántos no estaban en el historial
+typedef struct {
+    unsigned long hits;
+    unsigned long taken;
+    unsigned long unknown;
+} lease_reoffer_stats;
+
+void get_lease_reoffer_stats(lease_reoffer_stats* stats);
+
+// Escribe en consola y en el log los contadores anteriores
+void report_lease_stats(void);
+
+// Las operaciones reciben la MAC en bytes y la IP en orden de host, tal como
+// salen del mensaje DHCP; el texto solo se genera para la consola y el log.
+
+// Asigna al cliente una IP del pool 'pool' y registra el lease por
+// 'lease_duration' segundos. Si la MAC ya tiene un lease u oferta en ese
+// pool, se le vuelve a dar la misma dirección; si lo liberó o venció hace
+// poco y la dirección sigue libre, se le da esa misma. Copia el registro
+// resultante en 'lease'. Retorna -1 si no hay direcciones.
+int assign_ip(uint32_t pool, const uint8_t mac[6], time_t lease_duration, lease_record* lease);
+
+// Como assign_ip, pero para un DHCPDISCOVER: la dirección queda en
+// LEASE_OFFERED durante 'hold_time' segundos, sin pasar por el journal, y
+// solo se convierte en lease con el DHCPREQUEST (renew_assigned_lease). Si
+// la MAC ya tiene un lease vigente en el pool se copia sin modificarlo.
+int offer_ip(uint32_t pool, const uint8_t mac[6], time_t hold_time, lease_record* lease);
+
+// Ofrece a la MAC su IP reservada 'ip' si es del pool 'pool' y no la tiene
+// otro cliente. Si la MAC tenía otra dirección del pool, la libera. Retorna
+// -1 si la reserva no se puede usar (el llamador ofrece entonces con offer_ip).
+int offer_reserved_ip(uint32_t pool, uint32_t ip, const uint8_t mac[6], time_t hold_time, lease_record* lease);
+
+// Libera la oferta pendiente de la MAC en el pool (el cliente eligió otro
+// servidor). Retorna -1 si no tenía ninguna.
+int cancel_offer(uint32_t pool, const uint8_t mac[6]);
+
+// Aplica un cambio de reservas: 'previous' y 'current' son las IPs reservadas
+// antes y después, en orden creciente. Las nuevas dejan de estar libres y las
+// que se quitan vuelven al conjunto de libres en cuanto nadie las usa.
+// Solo toma el mutex del shard de cada IP que cambia.
+void update_lease_reservations(const uint32_t* previous, uint32_t previous_count,
+                               const uint32_t* current, uint32_t current_count);
+
+// Renueva el lease de 'ip' si es del pool 'pool' y está asignado a 'mac', o
+// lo registra si 'ip' estaba ofrecida a 'mac'. Retorna -1 si no.
+int renew_assigned_lease(uint32_t pool, uint32_t ip, const uint8_t mac[6], time_t lease_duration, lease_record* lease);
+
+// Liberan o ponen en cuarentena 'ip' si está asignada a 'mac'. Retornan -1 si no lo está.
+int release_ip(uint32_t ip, const uint8_t mac[6]);
+int handle_decline(uint32_t ip, const uint8_t mac[6]);
+
+// Libera los leases, ofertas y cuarentenas vencidos. La llama el hilo de expiración.
+void check_expired_leases(void);
+
+// Crea el temporizador (timerfd) y el hilo que procesa los vencimientos
+int start_lease_expiry(void);
+
+// Reconstruye la tabla desde el snapshot y el journal (lease_journal_configure
+// debe llamarse antes). Retorna los registros aplicados o -1 si falla la lectura.
+long recover_leases(void);
+
+// Fuente del snapshot para la compactación del journal (journal_snapshot_fn)
+int write_lease_snapshot(int fd, void* context);
+
+// Activa o desactiva los mensajes por consola de cada operación (activos por defecto)
+void set_lease_console_output(int enabled);
+
+#define LEASE_MAC_STRLEN 18  // "aa:bb:cc:dd:ee:ff" + '\0'
+
+// Convierten una IP (orden de host) o la IP de un registro a texto (buffer de al menos 16 bytes)
+const char* lease_address_string(uint32_t ip, char* buffer);
+const char* lease_ip_string(const lease_record* lease, char* buffer);
+
+// Convierte una MAC en bytes a texto (buffer de LEASE_MAC_STRLEN bytes)
+const char* lease_mac_string(const uint8_t mac[6], char* buffer);
+
+#endif
@@ -0,0 +1,105 @@
+#include "reply_cache.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lease_index.h"
+
+#define SLOTS_PER_STRIPE (REPLY_CACHE_SLOTS / REPLY_CACHE_STRIPES)
+
+// Respuesta guardada: la clave de la solicitud y los bytes enviados
+typedef struct {
+    uint64_t key;         // MAC (48 bits) con el tipo de mensaje encima
+    uint32_t xid;
+    uint32_t giaddr;
+    uint64_t stored_ms;   // Cuándo se envió (CLOCK_MONOTONIC)
+    uint16_t length;      // 0 si el slot está vacío
+    uint8_t reply[DHCP_MAX_PACKET_SIZE];
+} reply_cache_entry;
+
+// Franja de slots consecutivos con su mutex, alineada a la línea de caché
+// para que los mutex de franjas vecinas no la compartan
+typedef struct {
+    pthread_mutex_t mutex;
+} __attribute__((aligned(64))) reply_cache_stripe;
+
+static reply_cache_entry* entries = NULL;
+static reply_cache_stripe stripes[REPLY_CACHE_STRIPES];
+
+_Static_assert((REPLY_CACHE_SLOTS & (REPLY_CACHE_SLOTS - 1)) == 0, "REPLY_CACHE_SLOTS debe ser potencia de 2");
+_Static_assert(REPLY_CACHE_SLOTS % REPLY_CACHE_STRIPES == 0, "Cada franja debe tener los mismos slots");
+
+int reply_cache_init(void) {
+    entries = calloc(REPLY_CACHE_SLOTS, sizeof(reply_cache_entry));
+    if (entries == NULL) {
+        return -1;
+    }
+    for (int i = 0; i < REPLY_CACHE_STRIPES; ++i) {
+        pthread_mutex_init(&stripes[i].mutex, NULL);
+    }
+    return 0;
+}
+
+void reply_cache_destroy(void) {
+    for (int i = 0; i < REPLY_CACHE_STRIPES; ++i) {
+        pthread_mutex_destroy(&stripes[i].mutex);
+    }
+    free(entries);
+    entries = NULL;
+}
+
+static uint64_t now_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+}
+
+static inline uint64_t request_key(const dhcp_packet_view* packet) {
+    return mac_bytes_to_key(packet->chaddr) | ((uint64_t)packet->message_type << 48);
+}
+
+// Slot de la solicitud: mezcla de la clave, el xid y el giaddr
+static inline uint32_t slot_of(uint64_t key, uint32_t xid, uint32_t giaddr) {
+    uint64_t hash = (key ^ ((uint64_t)xid << 16) ^ ((uint64_t)giaddr << 32)) * 0x9e3779b97f4a7c15ULL;
+    return (uint32_t)(hash >> 32) & (REPLY_CACHE_SLOTS - 1);
+}
+
+size_t reply_cache_lookup(const dhcp_packet_view* packet, uint32_t window_ms, uint8_t* reply, size_t size) {
+    uint64_t key = request_key(packet);
+    uint32_t slot = slot_of(key, packet->xid, packet->giaddr);
+    reply_cache_stripe* stripe = &stripes[slot / SLOTS_PER_STRIPE];
+    const reply_cache_entry* entry = &entries[slot];
+    uint64_t now = now_ms();
+
+    size_t length = 0;
+    pthread_mutex_lock(&stripe->mutex);
+    if (entry->length != 0 && entry->key == key && entry->xid == packet->xid && entry->giaddr == packet->giaddr &&
+        now - entry->stored_ms < window_ms && entry->length <= size) {
+        length = entry->length;
+        memcpy(reply, entry->reply, length);
+    }
+    pthread_mutex_unlock(&stripe->mutex);
+    return length;
+}
+
+void reply_cache_store(const dhcp_packet_view* packet, const uint8_t* reply, size_t length) {
+    if (length == 0 || length > DHCP_MAX_PACKET_SIZE) {
+        return;
+    }
+    uint64_t key = request_key(packet);
+    uint32_t slot = slot_of(key, packet->xid, packet->giaddr);
+    reply_cache_stripe* stripe = &stripes[slot / SLOTS_PER_STRIPE];
+    reply_cache_entry* entry = &entries[slot];
+    uint64_t now = now_ms();
+
+    pthread_mutex_lock(&stripe->mutex);
+    entry->key = key;
+    entry->xid = packet->xid;
+    entry->giaddr = packet->giaddr;
+    entry->stored_ms = now;
+    entry->length = (uint16_t)length;
+    memcpy(entry->reply, reply, length);
+    pthread_mutex_unlock(&stripe->mutex);
+}
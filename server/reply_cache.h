@@ -0,0 +1,30 @@
+#ifndef REPLY_CACHE_H
+#define REPLY_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "dhcp_wire.h"
+
+#define REPLY_CACHE_SLOTS 8192   // Respuestas recordadas (potencia de 2)
+#define REPLY_CACHE_STRIPES 64   // Mutex entre los que se reparten los slots
+
+// Caché de las últimas respuestas enviadas, para contestar las
+// retransmisiones sin volver a pasar por la tabla de leases. Una solicitud
+// se identifica por la MAC, el xid, el tipo de mensaje y el giaddr: un
+// cliente que retransmite conserva el xid y uno que empieza de nuevo elige
+// otro. Cada slot guarda una sola respuesta (la más reciente que cae en él)
+// y los slots se reparten entre REPLY_CACHE_STRIPES mutex, así que dos
+// workers solo compiten si sus clientes caen en la misma franja.
+
+int reply_cache_init(void);
+void reply_cache_destroy(void);
+
+// Copia en 'reply' la respuesta guardada para la misma solicitud hace menos
+// de 'window_ms' milisegundos. Retorna su longitud, o 0 si no hay ninguna.
+size_t reply_cache_lookup(const dhcp_packet_view* packet, uint32_t window_ms, uint8_t* reply, size_t size);
+
+// Guarda la respuesta enviada a 'packet', reemplazando la que ocupaba su slot
+void reply_cache_store(const dhcp_packet_view* packet, const uint8_t* reply, size_t length);
+
+#endif
@@ -0,0 +1,187 @@
+#include "request_queue.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Inicializa la cola con 'capacity' slots preasignados, todos libres
+int request_queue_init(request_queue* queue, size_t capacity, queue_policy policy) {
+    memset(queue, 0, sizeof(*queue));
+    if (capacity == 0) {
+        return -1;
+    }
+
+    queue->slots = calloc(capacity, sizeof(client_request));
+    queue->free_ring = calloc(capacity, sizeof(client_request*));
+    queue->ready_ring = calloc(capacity, sizeof(client_request*));
+    if (queue->slots == NULL || queue->free_ring == NULL || queue->ready_ring == NULL) {
+        request_queue_destroy(queue);
+        return -1;
+    }
+
+    for (size_t i = 0; i < capacity; ++i) {
+        queue->free_ring[i] = &queue->slots[i];
+    }
+    queue->capacity = capacity;
+    queue->free_count = capacity;
+    queue->policy = policy;
+    queue->stats.capacity = capacity;
+
+    pthread_mutex_init(&queue->mutex, NULL);
+    pthread_cond_init(&queue->not_empty, NULL);
+    pthread_cond_init(&queue->slot_free, NULL);
+    return 0;
+}
+
+void request_queue_destroy(request_queue* queue) {
+    free(queue->slots);
+    free(queue->free_ring);
+    free(queue->ready_ring);
+    if (queue->capacity > 0) {
+        pthread_mutex_destroy(&queue->mutex);
+        pthread_cond_destroy(&queue->not_empty);
+        pthread_cond_destroy(&queue->slot_free);
+    }
+    memset(queue, 0, sizeof(*queue));
+}
+
+// Saca un slot del anillo de libres (requiere el mutex tomado)
+static client_request* take_free_slot(request_queue* queue) {
+    client_request* request = queue->free_ring[queue->free_head];
+    queue->free_head = (queue->free_head + 1) % queue->capacity;
+    queue->free_count--;
+    return request;
+}
+
+// Devuelve un slot al anillo de libres (requiere el mutex tomado)
+static void put_free_slot(request_queue* queue, client_request* request) {
+    size_t tail = (queue->free_head + queue->free_count) % queue->capacity;
+    queue->free_ring[tail] = request;
+    queue->free_count++;
+    pthread_cond_signal(&queue->slot_free);
+}
+
+client_request* request_queue_acquire(request_queue* queue) {
+    client_request* request = NULL;
+
+    pthread_mutex_lock(&queue->mutex);
+    if (queue->policy == QUEUE_POLICY_BLOCK) {
+        while (queue->free_count == 0 && !queue->closed) {
+            pthread_cond_wait(&queue->slot_free, &queue->mutex);
+        }
+    }
+    if (queue->free_count > 0) {
+        request = take_free_slot(queue);
+    }
+    pthread_mutex_unlock(&queue->mutex);
+
+    return request;
+}
+
+void request_queue_push(request_queue* queue, client_request* request) {
+    pthread_mutex_lock(&queue->mutex);
+    size_t tail = (queue->ready_head + queue->ready_count) % queue->capacity;
+    queue->ready_ring[tail] = request;
+    queue->ready_count++;
+
+    queue->stats.enqueued++;
+    if (queue->ready_count > queue->stats.high_watermark) {
+        queue->stats.high_watermark = queue->ready_count;
+    }
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+void request_queue_release(request_queue* queue, client_request* request) {
+    pthread_mutex_lock(&queue->mutex);
+    put_free_slot(queue, request);
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+size_t request_queue_acquire_batch(request_queue* queue, client_request** requests, size_t max) {
+    size_t count = 0;
+
+    pthread_mutex_lock(&queue->mutex);
+    if (queue->policy == QUEUE_POLICY_BLOCK) {
+        while (queue->free_count == 0 && !queue->closed) {
+            pthread_cond_wait(&queue->slot_free, &queue->mutex);
+        }
+    }
+    while (count < max && queue->free_count > 0) {
+        requests[count++] = take_free_slot(queue);
+    }
+    pthread_mutex_unlock(&queue->mutex);
+
+    return count;
+}
+
+void request_queue_push_batch(request_queue* queue, client_request** requests, size_t count) {
+    if (count == 0) {
+        return;
+    }
+    pthread_mutex_lock(&queue->mutex);
+    for (size_t i = 0; i < count; ++i) {
+        size_t tail = (queue->ready_head + queue->ready_count) % queue->capacity;
+        queue->ready_ring[tail] = requests[i];
+        queue->ready_count++;
+    }
+
+    queue->stats.enqueued += count;
+    if (queue->ready_count > queue->stats.high_watermark) {
+        queue->stats.high_watermark = queue->ready_count;
+    }
+    // Despertar a todos si el lote puede repartirse entre varios workers
+    if (count > 1) {
+        pthread_cond_broadcast(&queue->not_empty);
+    } else {
+        pthread_cond_signal(&queue->not_empty);
+    }
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+void request_queue_release_batch(request_queue* queue, client_request** requests, size_t count) {
+    if (count == 0) {
+        return;
+    }
+    pthread_mutex_lock(&queue->mutex);
+    for (size_t i = 0; i < count; ++i) {
+        put_free_slot(queue, requests[i]);
+    }
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+size_t request_queue_pop_batch(request_queue* queue, client_request** requests, size_t max) {
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->ready_count == 0 && !queue->closed) {
+        pthread_cond_wait(&queue->not_empty, &queue->mutex);
+    }
+    size_t count = 0;
+    while (count < max && queue->ready_count > 0) {
+        requests[count++] = queue->ready_ring[queue->ready_head];
+        queue->ready_head = (queue->ready_head + 1) % queue->capacity;
+        queue->ready_count--;
+    }
+    pthread_mutex_unlock(&queue->mutex);
+
+    return count;
+}
+
+void request_queue_close(request_queue* queue) {
+    pthread_mutex_lock(&queue->mutex);
+    queue->closed = 1;
+    pthread_cond_broadcast(&queue->not_empty);
+    pthread_cond_broadcast(&queue->slot_free);
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+void request_queue_count_drop(request_queue* queue) {
+    pthread_mutex_lock(&queue->mutex);
+    queue->stats.dropped++;
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+void request_queue_get_stats(request_queue* queue, queue_stats* stats) {
+    pthread_mutex_lock(&queue->mutex);
+    *stats = queue->stats;
+    stats->depth = queue->ready_count;
+    pthread_mutex_unlock(&queue->mutex);
+}
@@ -0,0 +1,88 @@
+#ifndef REQUEST_QUEUE_H
+#define REQUEST_QUEUE_H
+
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include "dhcp_server.h"
+#include "dhcp_wire.h"
+
+// Estructura con un datagrama recibido, pendiente de ser procesado por un worker
+typedef struct {
+    int udp_socket;
+    uint8_t buffer[BUFFER_SIZE];   // Mensaje DHCP binario tal como llegó
+    size_t length;                 // Bytes recibidos
+    uint8_t reply[DHCP_MAX_PACKET_SIZE];  // Respuesta construida por el manejador
+    size_t reply_length;                  // 0 si no hay nada que enviar
+    struct sockaddr_in client_addr;
+    socklen_t client_addr_len;
+} client_request;
+
+// Política cuando no quedan slots libres en la cola
+typedef enum {
+    QUEUE_POLICY_DROP,   // Descartar el datagrama y contarlo como perdido
+    QUEUE_POLICY_BLOCK   // Bloquear el receptor hasta que un worker libere un slot
+} queue_policy;
+
+// Contadores de la cola (copia consistente tomada bajo el mutex)
+typedef struct {
+    size_t capacity;
+    size_t depth;            // Solicitudes pendientes en este momento
+    size_t high_watermark;   // Máxima profundidad observada
+    unsigned long enqueued;  // Solicitudes encoladas en total
+    unsigned long dropped;   // Datagramas descartados por cola llena
+} queue_stats;
+
+// Cola acotada MPMC con slots preasignados. Los slots circulan entre dos
+// anillos: el de libres (receptor -> toma slot) y el de listos (worker -> procesa).
+typedef struct {
+    client_request* slots;      // Almacenamiento de todos los slots
+    client_request** free_ring; // Slots disponibles para recibir
+    client_request** ready_ring;// Slots con datagramas pendientes
+    size_t capacity;
+    size_t free_head, free_count;
+    size_t ready_head, ready_count;
+    queue_policy policy;
+    int closed;                 // request_queue_close: no se espera más
+    queue_stats stats;
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;   // Hay solicitudes listas
+    pthread_cond_t slot_free;   // Hay slots libres (política BLOCK)
+} request_queue;
+
+int request_queue_init(request_queue* queue, size_t capacity, queue_policy policy);
+void request_queue_destroy(request_queue* queue);
+
+// Obtiene un slot libre para recibir. Con política DROP retorna NULL si la
+// cola está llena; con BLOCK espera a que se libere uno.
+client_request* request_queue_acquire(request_queue* queue);
+
+// Publica un slot con un datagrama recibido para que lo procese un worker
+void request_queue_push(request_queue* queue, client_request* request);
+
+// Devuelve un slot sin usar (por ejemplo, si recvfrom falló)
+void request_queue_release(request_queue* queue, client_request* request);
+
+// Variantes por lotes para la E/S con recvmmsg/sendmmsg (opción -b): toman o
+// devuelven hasta 'max' slots con una sola toma del mutex.
+// acquire_batch retorna 0 con política DROP si la cola está llena (con BLOCK
+// espera a que haya al menos un slot libre); pop_batch espera al menos una
+// solicitud y solo retorna 0 si la cola se cerró y ya no quedan pendientes.
+size_t request_queue_acquire_batch(request_queue* queue, client_request** requests, size_t max);
+void request_queue_push_batch(request_queue* queue, client_request** requests, size_t count);
+void request_queue_release_batch(request_queue* queue, client_request** requests, size_t count);
+size_t request_queue_pop_batch(request_queue* queue, client_request** requests, size_t max);
+
+// Cierra la cola para detener el servidor: despierta a los workers, que
+// terminan las solicitudes pendientes, y a los receptores bloqueados
+void request_queue_close(request_queue* queue);
+
+// Registra un datagrama descartado por falta de slots
+void request_queue_count_drop(request_queue* queue);
+
+void request_queue_get_stats(request_queue* queue, queue_stats* stats);
+
+#endif
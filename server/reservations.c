@@ -0,0 +1,137 @@
+#include "reservations.h"
+
+#include <arpa/inet.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dhcp_server.h"
+
+typedef struct {
+    uint64_t mac_key;
+    uint32_t ip;
+} reservation_line;
+
+static int compare_addresses(const void* left, const void* right) {
+    uint32_t a = *(const uint32_t*)left;
+    uint32_t b = *(const uint32_t*)right;
+    return (a > b) - (a < b);
+}
+
+// Convierte "aa:bb:cc:dd:ee:ff a.b.c.d" en clave de MAC e IP (orden de host)
+static int parse_line(const char* line, reservation_line* parsed) {
+    unsigned int bytes[6];
+    char address[INET_ADDRSTRLEN];
+    char extra[2];
+    if (sscanf(line, "%2x:%2x:%2x:%2x:%2x:%2x %15s %1s", &bytes[0], &bytes[1], &bytes[2], &bytes[3],
+               &bytes[4], &bytes[5], address, extra) != 7) {
+        return -1;
+    }
+    struct in_addr addr;
+    if (inet_pton(AF_INET, address, &addr) != 1) {
+        return -1;
+    }
+    uint8_t mac[6];
+    for (int i = 0; i < 6; ++i) {
+        mac[i] = (uint8_t)bytes[i];
+    }
+    parsed->mac_key = mac_bytes_to_key(mac);
+    parsed->ip = ntohl(addr.s_addr);
+    return 0;
+}
+
+int reservations_empty(reservation_set* set) {
+    memset(set, 0, sizeof(*set));
+    return lease_index_init(&set->by_mac, 0);
+}
+
+int reservations_load(const char* path, reservation_set* set) {
+    memset(set, 0, sizeof(*set));
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        perror("No se pudo abrir el archivo de reservas");
+        return -1;
+    }
+
+    reservation_line* lines = NULL;
+    uint32_t count = 0, capacity = 0;
+    char line[BUFFER_SIZE];
+    unsigned long line_number = 0;
+    int failed = 0;
+    while (!failed && fgets(line, sizeof(line), file)) {
+        line_number++;
+        char* trimmed_line = line;
+        while (isspace((unsigned char)*trimmed_line)) trimmed_line++;
+        if (*trimmed_line == '\0' || *trimmed_line == '#') {
+            continue;
+        }
+        if (count == MAX_RESERVATIONS) {
+            printf("El archivo de reservas supera el máximo de %u reservas.\n", MAX_RESERVATIONS);
+            failed = 1;
+            break;
+        }
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            reservation_line* grown = realloc(lines, capacity * sizeof(reservation_line));
+            if (grown == NULL) {
+                failed = 1;
+                break;
+            }
+            lines = grown;
+        }
+        if (parse_line(trimmed_line, &lines[count]) != 0) {
+            printf("Reserva inválida en la línea %lu de %s (se esperaba \"MAC IP\")\n", line_number, path);
+            failed = 1;
+            break;
+        }
+        count++;
+    }
+    fclose(file);
+
+    if (!failed) {
+        set->addresses = malloc((count ? count : 1) * sizeof(uint32_t));
+        failed = set->addresses == NULL || lease_index_init(&set->by_mac, count) != 0;
+    }
+    for (uint32_t i = 0; !failed && i < count; ++i) {
+        uint32_t existing;
+        if (lease_index_get(&set->by_mac, lines[i].mac_key, &existing) == 0) {
+            printf("Una MAC tiene dos reservas en %s.\n", path);
+            failed = 1;
+            break;
+        }
+        lease_index_put(&set->by_mac, lines[i].mac_key, lines[i].ip);
+        set->addresses[i] = lines[i].ip;
+    }
+    free(lines);
+    if (!failed) {
+        set->count = count;
+        qsort(set->addresses, count, sizeof(uint32_t), compare_addresses);
+        for (uint32_t i = 1; i < count; ++i) {
+            if (set->addresses[i] == set->addresses[i - 1]) {
+                printf("Una IP está reservada para dos MAC en %s.\n", path);
+                failed = 1;
+                break;
+            }
+        }
+    }
+    if (failed) {
+        log_message("ERROR", "Archivo de reservas inválido.");
+        reservations_free(set);
+        return -1;
+    }
+    return 0;
+}
+
+void reservations_free(reservation_set* set) {
+    lease_index_destroy(&set->by_mac);
+    free(set->addresses);
+    memset(set, 0, sizeof(*set));
+}
+
+int reservation_lookup(const reservation_set* set, const uint8_t mac[6], uint32_t* ip) {
+    if (set->count == 0) {
+        return -1;
+    }
+    return lease_index_get(&set->by_mac, mac_bytes_to_key(mac), ip);
+}
@@ -0,0 +1,35 @@
+#ifndef RESERVATIONS_H
+#define RESERVATIONS_H
+
+#include <stdint.h>
+
+#include "lease_index.h"
+
+#define MAX_RESERVATIONS (1u << 20)  // Líneas del archivo de reservas
+
+// Reservas estáticas MAC -> IP leídas de un archivo con una reserva por línea:
+//
+//   # impresora del piso 2
+//   aa:bb:cc:dd:ee:ff 192.168.1.50
+//
+// La búsqueda por MAC usa el mismo índice hash que la tabla de leases, O(1).
+// Un conjunto cargado no se modifica: forma parte de la instantánea de
+// configuración y una recarga carga un conjunto nuevo.
+typedef struct {
+    lease_index by_mac;   // Clave de la MAC -> IP (orden de host)
+    uint32_t* addresses;  // IPs reservadas en orden creciente
+    uint32_t count;
+} reservation_set;
+
+// Lee el archivo. Rechaza líneas inválidas y MAC o IP repetidas. Retorna -1 si falla.
+int reservations_load(const char* path, reservation_set* set);
+
+// Conjunto vacío (sin archivo de reservas)
+int reservations_empty(reservation_set* set);
+
+void reservations_free(reservation_set* set);
+
+// Retorna 0 y escribe la IP reservada para la MAC, o -1 si no tiene reserva
+int reservation_lookup(const reservation_set* set, const uint8_t mac[6], uint32_t* ip);
+
+#endif
@@ -0,0 +1,471 @@
+#include "server_config.h"
+
+#include <arpa/inet.h>
+#include <ctype.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "dhcp_log.h"
+#include "dhcp_server.h"
+
+// Instantánea publicada; los workers la leen con una carga atómica
+static _Atomic(network_config*) current_config = NULL;
+
+// Periodo de gracia de las recargas. Cada lector anota en su ranura la
+// época vigente al empezar a leer (0 = fuera de una lectura). Una recarga
+// publica la instantánea nueva, avanza la época y solo libera la anterior
+// cuando ninguna ranura sigue en una época previa: quien entró después ya
+// ve la nueva. Las ranuras ocupan líneas de caché propias para que la
+// entrada y salida de un worker no invalide la de los demás.
+typedef struct {
+    atomic_ulong epoch;
+} __attribute__((aligned(64))) config_reader;
+
+static atomic_ulong config_epoch = 1;
+static config_reader readers[CONFIG_MAX_READERS];
+static atomic_uint reader_count = 0;
+static atomic_ulong shared_readers = 0;  // Lecturas en curso de los hilos sin ranura
+static pthread_mutex_t readers_mutex = PTHREAD_MUTEX_INITIALIZER;
+static _Thread_local config_reader* thread_reader = NULL;
+static _Thread_local int thread_registered = 0;
+
+static char config_path[BUFFER_SIZE];
+
+// Rango de la subred local (línea de comandos, orden de host)
+static uint32_t default_range_start = 0;
+static uint32_t default_range_end = 0;
+
+// Serializa las recargas entre sí (los lectores nunca lo toman)
+static pthread_mutex_t reload_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Copia el valor de una línea "CLAVE=valor" sin el salto de línea final
+static void copy_value(char* dest, size_t size, const char* value) {
+    size_t len = strcspn(value, "\r\n");
+    while (len > 0 && isspace((unsigned char)value[len - 1])) len--;
+    if (len >= size) len = size - 1;
+    memcpy(dest, value, len);
+    dest[len] = '\0';
+}
+
+// Convierte una IPv4 en texto a binario (orden de host). Retorna -1 si no es válida.
+static int parse_address(const char* name, const char* value, uint32_t* address) {
+    struct in_addr addr;
+    if (inet_pton(AF_INET, value, &addr) <= 0) {
+        printf("%s inválido: %s\n", name, value);
+        return -1;
+    }
+    *address = ntohl(addr.s_addr);
+    return 0;
+}
+
+// Convierte "a.b.c.d-e.f.g.h" en un rango (orden de host). Retorna -1 si no es válido.
+static int parse_range(const char* value, uint32_t* range_start, uint32_t* range_end) {
+    char first[INET_ADDRSTRLEN];
+    const char* dash = strchr(value, '-');
+    size_t length = dash ? (size_t)(dash - value) : 0;
+    if (length == 0 || length >= sizeof(first)) {
+        printf("RANGE inválido: %s (se esperaba inicio-fin)\n", value);
+        return -1;
+    }
+    memcpy(first, value, length);
+    first[length] = '\0';
+    if (parse_address("RANGE", first, range_start) != 0 || parse_address("RANGE", dash + 1, range_end) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+// Añade una subred vacía al final de config->subnets. Retorna NULL si no cabe.
+static subnet_config* append_subnet(network_config* config) {
+    if (config->subnet_count == MAX_SUBNETS) {
+        printf("Demasiadas subredes en el archivo de configuración (máximo %d).\n", MAX_SUBNETS);
+        return NULL;
+    }
+    subnet_config* subnets = realloc(config->subnets, (config->subnet_count + 1) * sizeof(subnet_config));
+    if (subnets == NULL) {
+        return NULL;
+    }
+    config->subnets = subnets;
+    subnet_config* subnet = &subnets[config->subnet_count++];
+    memset(subnet, 0, sizeof(*subnet));
+    return subnet;
+}
+
+// Interpreta una clave dentro de una sección [SUBNET]
+static int parse_subnet_key(subnet_config* subnet, const char* line) {
+    char value[BUFFER_SIZE];
+    if (strncmp(line, "RANGE=", 6) == 0) {
+        copy_value(value, sizeof(value), line + 6);
+        return parse_range(value, &subnet->range_start, &subnet->range_end);
+    } else if (strncmp(line, "DEFAULT_GATEWAY=", 16) == 0) {
+        copy_value(value, sizeof(value), line + 16);
+        return parse_address("DEFAULT_GATEWAY", value, &subnet->default_gateway_addr);
+    } else if (strncmp(line, "DNS_SERVER=", 11) == 0) {
+        copy_value(value, sizeof(value), line + 11);
+        return parse_address("DNS_SERVER", value, &subnet->dns_server_addr);
+    } else if (strncmp(line, "LEASE_TIME=", 11) == 0) {
+        subnet->lease_time = atoi(line + 11);
+        if (subnet->lease_time <= 0) {
+            printf("LEASE_TIME inválido en una sección [SUBNET].\n");
+            return -1;
+        }
+        return 0;
+    }
+    copy_value(value, sizeof(value), line);
+    printf("Clave no admitida dentro de una sección [SUBNET]: %s\n", value);
+    return -1;
+}
+
+// Completa y valida una subred de una sección: el rango debe estar dentro de
+// la subred y el gateway es obligatorio; DNS_SERVER y LEASE_TIME se heredan
+static int finish_subnet(subnet_config* subnet, const network_config* config) {
+    char network[INET_ADDRSTRLEN];
+    struct in_addr addr;
+    addr.s_addr = htonl(subnet->network);
+    inet_ntop(AF_INET, &addr, network, sizeof(network));
+
+    uint32_t mask = subnet->subnet_mask_addr;
+    if (subnet->range_start == 0 || subnet->range_end < subnet->range_start ||
+        (subnet->range_start & mask) != subnet->network || (subnet->range_end & mask) != subnet->network) {
+        printf("La subred %s/%u necesita un RANGE dentro de la subred.\n", network, subnet->prefix_length);
+        return -1;
+    }
+    if (subnet->default_gateway_addr == 0) {
+        printf("La subred %s/%u necesita DEFAULT_GATEWAY.\n", network, subnet->prefix_length);
+        return -1;
+    }
+    if (subnet->dns_server_addr == 0) {
+        subnet->dns_server_addr = config->dns_server_addr;
+    }
+    if (subnet->lease_time == 0) {
+        subnet->lease_time = config->lease_time;
+    }
+    return 0;
+}
+
+// Carga el archivo de RESERVATIONS: cada IP reservada debe estar en el rango de una subred
+static int load_reservations(network_config* config) {
+    if (config->reservations_file[0] == '\0') {
+        return reservations_empty(&config->reservations);
+    }
+    if (reservations_load(config->reservations_file, &config->reservations) != 0) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < config->reservations.count; ++i) {
+        uint32_t ip = config->reservations.addresses[i];
+        uint32_t index;
+        if (dhcp_subnet_lookup(&config->selector, ip, &index) != 0 ||
+            ip < config->subnets[index].range_start || ip > config->subnets[index].range_end) {
+            struct in_addr addr;
+            addr.s_addr = htonl(ip);
+            printf("La IP reservada %s no está en el rango de ninguna subred.\n", inet_ntoa(addr));
+            log_message("ERROR", "IP reservada fuera de los rangos configurados.");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int read_network_config(const char* filename, network_config* config) {
+    FILE* file = fopen(filename, "r");
+    if (!file) {
+        perror("No se pudo abrir el archivo de configuración");
+        return -1;
+    }
+
+    config->lease_time = DEFAULT_LEASE_TIME;
+    config->offer_hold_time = DEFAULT_OFFER_HOLD_TIME;
+    config->retransmit_window = DEFAULT_RETRANSMIT_WINDOW;
+    config->log_level = -1;
+    // La subred local ocupa la posición 0; se completa con las claves globales
+    if (append_subnet(config) == NULL) {
+        fclose(file);
+        return -1;
+    }
+
+    subnet_config* section = NULL;  // Sección [SUBNET] en curso
+    char line[BUFFER_SIZE];
+    while (fgets(line, sizeof(line), file)) {
+        // Eliminar espacios en blanco al inicio de la línea
+        char* trimmed_line = line;
+        while (isspace((unsigned char)*trimmed_line)) trimmed_line++;
+
+        // Omitir líneas vacías o comentarios
+        if (*trimmed_line == '\0' || *trimmed_line == '#') {
+            continue;
+        }
+
+        if (strncmp(trimmed_line, "[SUBNET ", 8) == 0) {
+            char subnet_text[32];
+            uint32_t address, prefix_length;
+            copy_value(subnet_text, sizeof(subnet_text), trimmed_line + 8);
+            size_t length = strlen(subnet_text);
+            if (length == 0 || subnet_text[length - 1] != ']') {
+                printf("Sección inválida: %s", trimmed_line);
+                fclose(file);
+                return -1;
+            }
+            subnet_text[length - 1] = '\0';
+            if (dhcp_subnet_parse(subnet_text, &address, &prefix_length) != 0) {
+                printf("Subred inválida: %s (se esperaba red/prefijo)\n", subnet_text);
+                fclose(file);
+                return -1;
+            }
+            section = append_subnet(config);
+            if (section == NULL) {
+                fclose(file);
+                return -1;
+            }
+            section->subnet_mask_addr = dhcp_prefix_mask(prefix_length);
+            section->network = address & section->subnet_mask_addr;
+            section->prefix_length = prefix_length;
+            continue;
+        }
+        if (section != NULL) {
+            if (parse_subnet_key(section, trimmed_line) != 0) {
+                fclose(file);
+                return -1;
+            }
+            continue;
+        }
+
+        if (strncmp(trimmed_line, "SUBNET_MASK=", 12) == 0) {
+            copy_value(config->subnet_mask, sizeof(config->subnet_mask), trimmed_line + 12);
+        } else if (strncmp(trimmed_line, "DEFAULT_GATEWAY=", 16) == 0) {
+            copy_value(config->default_gateway, sizeof(config->default_gateway), trimmed_line + 16);
+        } else if (strncmp(trimmed_line, "DNS_SERVER=", 11) == 0) {
+            copy_value(config->dns_server, sizeof(config->dns_server), trimmed_line + 11);
+        } else if (strncmp(trimmed_line, "SERVER_ID=", 10) == 0) {
+            copy_value(config->server_id, sizeof(config->server_id), trimmed_line + 10);
+        } else if (strncmp(trimmed_line, "LEASE_TIME=", 11) == 0) {
+            config->lease_time = atoi(trimmed_line + 11);
+        } else if (strncmp(trimmed_line, "OFFER_HOLD_TIME=", 16) == 0) {
+            config->offer_hold_time = atoi(trimmed_line + 16);
+        } else if (strncmp(trimmed_line, "RETRANSMIT_WINDOW=", 18) == 0) {
+            config->retransmit_window = atoi(trimmed_line + 18);
+        } else if (strncmp(trimmed_line, "RESERVATIONS=", 13) == 0) {
+            copy_value(config->reservations_file, sizeof(config->reservations_file), trimmed_line + 13);
+        } else if (strncmp(trimmed_line, "LOG_LEVEL=", 10) == 0) {
+            char level_name[16];
+            dhcp_log_level level;
+            copy_value(level_name, sizeof(level_name), trimmed_line + 10);
+            if (dhcp_log_parse_level(level_name, &level) == 0) {
+                config->log_level = level;
+            } else {
+                printf("LOG_LEVEL inválido: %s (se esperaba DEBUG, INFO, WARNING o ERROR)\n", level_name);
+            }
+        }
+    }
+
+    fclose(file);
+
+    if (config->subnet_mask[0] == '\0' || config->default_gateway[0] == '\0' || config->dns_server[0] == '\0') {
+        printf("Faltan parámetros de red (SUBNET_MASK, DEFAULT_GATEWAY o DNS_SERVER) en el archivo de configuración.\n");
+        log_message("ERROR", "Faltan parámetros de red en el archivo de configuración.");
+        return -1;
+    }
+
+    if (parse_address("SUBNET_MASK", config->subnet_mask, &config->subnet_mask_addr) != 0 ||
+        parse_address("DEFAULT_GATEWAY", config->default_gateway, &config->default_gateway_addr) != 0 ||
+        parse_address("DNS_SERVER", config->dns_server, &config->dns_server_addr) != 0 ||
+        (config->server_id[0] != '\0' && parse_address("SERVER_ID", config->server_id, &config->server_id_addr) != 0)) {
+        log_message("ERROR", "Dirección inválida en el archivo de configuración.");
+        return -1;
+    }
+
+    // Verificar que lease_time no sea 0
+    if (config->lease_time <= 0) {
+        printf("El tiempo de lease es inválido. Asegúrate de que 'LEASE_TIME' esté definido correctamente en el archivo de configuración.\n");
+        log_message("ERROR", "El tiempo de lease es inválido.");
+        return -1;
+    }
+    if (config->offer_hold_time <= 0) {
+        printf("El tiempo de retención de las ofertas es inválido. Revisa 'OFFER_HOLD_TIME' en el archivo de configuración.\n");
+        log_message("ERROR", "El tiempo de retención de las ofertas es inválido.");
+        return -1;
+    }
+    if (config->retransmit_window < 0) {
+        printf("La ventana de retransmisión es inválida. Revisa 'RETRANSMIT_WINDOW' en el archivo de configuración.\n");
+        log_message("ERROR", "La ventana de retransmisión es inválida.");
+        return -1;
+    }
+
+    // Subred local: rango de la línea de comandos y parámetros globales
+    subnet_config* local = &config->subnets[0];
+    local->subnet_mask_addr = config->subnet_mask_addr;
+    local->prefix_length = (uint32_t)__builtin_popcount(config->subnet_mask_addr);
+    local->network = default_range_start & config->subnet_mask_addr;
+    local->range_start = default_range_start;
+    local->range_end = default_range_end;
+    local->default_gateway_addr = config->default_gateway_addr;
+    local->dns_server_addr = config->dns_server_addr;
+    local->lease_time = config->lease_time;
+
+    for (uint32_t i = 1; i < config->subnet_count; ++i) {
+        if (finish_subnet(&config->subnets[i], config) != 0) {
+            log_message("ERROR", "Sección [SUBNET] inválida en el archivo de configuración.");
+            return -1;
+        }
+    }
+
+    // Selector por giaddr: búsqueda binaria sobre las subredes ordenadas
+    for (uint32_t i = 0; i < config->subnet_count; ++i) {
+        if (dhcp_subnet_table_add(&config->selector, config->subnets[i].network,
+                                  config->subnets[i].prefix_length, i) != 0) {
+            return -1;
+        }
+    }
+    if (dhcp_subnet_table_build(&config->selector) != 0) {
+        printf("Dos subredes del archivo de configuración se solapan.\n");
+        log_message("ERROR", "Subredes solapadas en el archivo de configuración.");
+        return -1;
+    }
+    return load_reservations(config);
+}
+
+// Función para leer los parámetros de red desde el archivo de configuración
+int load_network_config(const char* filename, network_config* config) {
+    memset(config, 0, sizeof(*config));
+    dhcp_subnet_table_init(&config->selector);
+    if (read_network_config(filename, config) != 0) {
+        free_network_config(config);
+        return -1;
+    }
+    return 0;
+}
+
+void free_network_config(network_config* config) {
+    dhcp_subnet_table_destroy(&config->selector);
+    reservations_free(&config->reservations);
+    free(config->subnets);
+    config->subnets = NULL;
+    config->subnet_count = 0;
+}
+
+// 1 si ambas configuraciones tienen las mismas subredes con los mismos rangos
+static int same_subnets(const network_config* left, const network_config* right) {
+    if (left->subnet_count != right->subnet_count) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < left->subnet_count; ++i) {
+        const subnet_config* a = &left->subnets[i];
+        const subnet_config* b = &right->subnets[i];
+        if (a->network != b->network || a->prefix_length != b->prefix_length ||
+            a->range_start != b->range_start || a->range_end != b->range_end) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int config_init(const char* filename, uint32_t range_start, uint32_t range_end) {
+    snprintf(config_path, sizeof(config_path), "%s", filename);
+    default_range_start = range_start;
+    default_range_end = range_end;
+    return config_reload(NULL);
+}
+
+const network_config* config_current(void) {
+    return atomic_load_explicit(&current_config, memory_order_acquire);
+}
+
+// Ranura del hilo; la primera vez se registra. NULL si ya no quedan.
+static config_reader* current_reader(void) {
+    if (thread_registered) {
+        return thread_reader;
+    }
+    pthread_mutex_lock(&readers_mutex);
+    unsigned int count = atomic_load_explicit(&reader_count, memory_order_relaxed);
+    if (count < CONFIG_MAX_READERS) {
+        thread_reader = &readers[count];
+        atomic_store_explicit(&reader_count, count + 1, memory_order_release);
+    }
+    pthread_mutex_unlock(&readers_mutex);
+    thread_registered = 1;
+    return thread_reader;
+}
+
+const network_config* config_acquire(void) {
+    config_reader* reader = current_reader();
+    // La época se anota antes de leer el puntero (ambas operaciones seq_cst):
+    // si la recarga no vio la ranura, esta lectura ya ve la instantánea nueva
+    if (reader != NULL) {
+        atomic_store(&reader->epoch, atomic_load(&config_epoch));
+    } else {
+        atomic_fetch_add(&shared_readers, 1);
+    }
+    return atomic_load(&current_config);
+}
+
+void config_release(void) {
+    if (thread_reader != NULL) {
+        atomic_store_explicit(&thread_reader->epoch, 0, memory_order_release);
+    } else {
+        atomic_fetch_sub_explicit(&shared_readers, 1, memory_order_release);
+    }
+}
+
+// Espera a que ningún lector pueda seguir usando una instantánea publicada
+// antes de la época 'epoch'. Un worker puede estar bloqueado en el journal
+// (fdatasync), así que se duerme entre comprobaciones.
+static void wait_for_readers(unsigned long epoch) {
+    struct timespec pause = {0, 1000000};  // 1 ms
+    unsigned int count = atomic_load_explicit(&reader_count, memory_order_acquire);
+    for (unsigned int i = 0; i < count; ++i) {
+        while (1) {
+            unsigned long seen = atomic_load(&readers[i].epoch);
+            if (seen == 0 || seen >= epoch) {
+                break;
+            }
+            nanosleep(&pause, NULL);
+        }
+    }
+    while (atomic_load(&shared_readers) > 0) {
+        nanosleep(&pause, NULL);
+    }
+}
+
+int config_reload(config_publish_fn before_publish) {
+    network_config* fresh = malloc(sizeof(network_config));
+    if (fresh == NULL) {
+        return -1;
+    }
+    if (load_network_config(config_path, fresh) != 0) {
+        free(fresh);
+        return -1;
+    }
+
+    pthread_mutex_lock(&reload_mutex);
+    network_config* current = atomic_load_explicit(&current_config, memory_order_acquire);
+    if (current != NULL && !same_subnets(current, fresh)) {
+        pthread_mutex_unlock(&reload_mutex);
+        printf("Las subredes o sus rangos cambiaron; solo se aplican al reiniciar el servidor.\n");
+        log_message("WARNING", "Recarga rechazada: las subredes o sus rangos cambiaron.");
+        free_network_config(fresh);
+        free(fresh);
+        return -1;
+    }
+
+    // El nivel de log se puede cambiar en caliente junto con el resto de parámetros
+    if (fresh->log_level >= 0) {
+        dhcp_log_set_level((dhcp_log_level)fresh->log_level);
+    }
+
+    if (before_publish != NULL && current != NULL) {
+        before_publish(current, fresh);
+    }
+
+    network_config* previous = atomic_exchange(&current_config, fresh);
+    if (previous != NULL) {
+        wait_for_readers(atomic_fetch_add(&config_epoch, 1) + 1);
+        free_network_config(previous);
+        free(previous);
+    }
+    pthread_mutex_unlock(&reload_mutex);
+
+    return 0;
+}
@@ -0,0 +1,95 @@
+#ifndef SERVER_CONFIG_H
+#define SERVER_CONFIG_H
+
+#include <stdint.h>
+
+#include "dhcp_subnet.h"
+#include "reservations.h"
+
+#define DEFAULT_LEASE_TIME 3600  // Valor por defecto si LEASE_TIME no aparece en el archivo
+#define DEFAULT_OFFER_HOLD_TIME 30  // Valor por defecto si OFFER_HOLD_TIME no aparece en el archivo
+#define DEFAULT_RETRANSMIT_WINDOW 5 // Valor por defecto si RETRANSMIT_WINDOW no aparece en el archivo
+#define MAX_SUBNETS 4096         // Subred local más las secciones [SUBNET]
+#define BUFFER_PATH_SIZE 256     // Rutas de archivos referenciados por la configuración
+#define CONFIG_MAX_READERS 1024  // Hilos lectores con ranura propia (el resto comparte un contador)
+
+// Subred atendida por el servidor, con su pool y sus opciones (orden de host).
+// La subred 0 es la local: su rango viene de la línea de comandos y sus
+// opciones de las claves globales del archivo. Las demás se declaran con una
+// sección "[SUBNET red/prefijo]" y se eligen por el giaddr del relay:
+//
+//   [SUBNET 10.20.0.0/16]
+//   RANGE=10.20.0.10-10.20.255.250
+//   DEFAULT_GATEWAY=10.20.0.1
+//   DNS_SERVER=10.20.0.2      (opcional, hereda el global)
+//   LEASE_TIME=7200           (opcional, hereda el global)
+typedef struct {
+    uint32_t network;
+    uint32_t prefix_length;
+    uint32_t range_start;          // Pool de la subred (ambos extremos incluidos)
+    uint32_t range_end;
+    uint32_t subnet_mask_addr;
+    uint32_t default_gateway_addr;
+    uint32_t dns_server_addr;
+    int lease_time;
+} subnet_config;
+
+// Parámetros de red leídos de network_config.txt. Una vez publicada, una
+// instantánea es inmutable: los workers la leen sin bloqueo y una recarga
+// publica una instantánea nueva en lugar de modificar la actual.
+typedef struct {
+    char subnet_mask[16];     // Máscara de subred
+    char default_gateway[16]; // Puerta de enlace predeterminada
+    char dns_server[16];      // Servidor DNS
+    char server_id[16];       // Identificador del servidor (opción 54), vacío si no se definió
+    uint32_t subnet_mask_addr;     // Las mismas direcciones en binario (orden de host),
+    uint32_t default_gateway_addr; // listas para copiarlas en las opciones DHCP
+    uint32_t dns_server_addr;
+    uint32_t server_id_addr;       // 0 si no se definió SERVER_ID
+    int lease_time;           // Duración del lease en segundos
+    int offer_hold_time;      // Segundos que una dirección ofrecida espera el DHCPREQUEST
+    int retransmit_window;    // Segundos en que una retransmisión recibe la respuesta guardada (0 = sin caché)
+    int log_level;            // Nivel mínimo de log (LOG_LEVEL), -1 si no se definió
+    subnet_config* subnets;   // subnets[0] es la subred local
+    uint32_t subnet_count;
+    dhcp_subnet_table selector;  // giaddr -> índice en 'subnets'
+    char reservations_file[BUFFER_PATH_SIZE];  // RESERVATIONS, vacío si no se definió
+    reservation_set reservations;  // Reservas estáticas (vacío sin RESERVATIONS)
+} network_config;
+
+// Lee y valida el archivo de configuración en 'config'. La subred local usa
+// el rango de config_init.
+int load_network_config(const char* filename, network_config* config);
+
+// Libera las subredes de una configuración cargada con load_network_config
+void free_network_config(network_config* config);
+
+// Carga la configuración inicial y la publica. Recuerda 'filename' y el rango
+// de la subred local (orden de host) para las recargas.
+int config_init(const char* filename, uint32_t range_start, uint32_t range_end);
+
+// Instantánea vigente para los workers. Entre config_acquire y
+// config_release una recarga puede publicar otra, pero no libera la que el
+// hilo está leyendo: espera a que todos los lectores que podían verla la
+// suelten. El puntero no debe usarse después de config_release ni
+// guardarse entre solicitudes, y las lecturas no se anidan.
+const network_config* config_acquire(void);
+void config_release(void);
+
+// Instantánea vigente sin protección: solo para el hilo que hace las
+// recargas (y para el arranque, antes de crear los workers)
+const network_config* config_current(void);
+
+// Se llama en una recarga con la instantánea vigente y la nueva, antes de
+// publicar la nueva: lo que dependa de ella (p. ej. las reservas en la tabla
+// de leases) queda listo antes de que un worker pueda leerla.
+typedef void (*config_publish_fn)(const network_config* previous, const network_config* next);
+
+// Vuelve a leer el archivo y reemplaza la instantánea de forma atómica,
+// después de llamar a 'before_publish' (puede ser NULL). Si el archivo no
+// es válido se conserva la configuración anterior. Las subredes y sus
+// rangos dimensionan los pools, así que solo cambian al reiniciar: una
+// recarga que los modifique se rechaza.
+int config_reload(config_publish_fn before_publish);
+
+#endif
@@ -0,0 +1,69 @@
+#include "server_metrics.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static metric_descriptor counters[SERVER_COUNTER_COUNT];
+static metric_descriptor histograms[SERVER_HISTOGRAM_COUNT];
+
+// Etiqueta type="DHCPDISCOVER" de cada tipo (vacía si el tipo no existe)
+static char type_labels[SERVER_MESSAGE_TYPES][32];
+
+static void describe(metric_descriptor* metric, const char* name, const char* labels, const char* help) {
+    metric->name = name;
+    metric->labels = labels;
+    metric->help = help;
+    metric->type = METRIC_COUNTER;
+}
+
+int server_metrics_init(void) {
+    // El tipo 0 no existe: sus series no se publican
+    for (int type = 1; type < SERVER_MESSAGE_TYPES; ++type) {
+        snprintf(type_labels[type], sizeof(type_labels[type]), "type=\"%s\"", dhcp_message_name((uint8_t)type));
+        describe(&counters[SERVER_METRIC_RECEIVED + type], "dhcp_server_messages_received_total", type_labels[type],
+                 "Mensajes DHCP atendidos por tipo.");
+        describe(&counters[SERVER_METRIC_REJECTED + type], "dhcp_server_messages_rejected_total", type_labels[type],
+                 "Mensajes DHCP rechazados por tipo (NAK, IP o MAC que no coinciden...).");
+        describe(&histograms[SERVER_METRIC_LATENCY + type], "dhcp_server_dispatch_seconds", type_labels[type],
+                 "Tiempo de procesamiento de cada mensaje por tipo.");
+    }
+    describe(&counters[SERVER_METRIC_MALFORMED], "dhcp_server_malformed_total", NULL,
+             "Datagramas que no son un BOOTREQUEST válido.");
+    describe(&counters[SERVER_METRIC_UNHANDLED], "dhcp_server_unhandled_total", NULL,
+             "Mensajes de un tipo sin manejador.");
+    describe(&counters[SERVER_METRIC_NO_SUBNET], "dhcp_server_no_subnet_total", NULL,
+             "Mensajes con un giaddr fuera de las subredes configuradas.");
+    describe(&counters[SERVER_METRIC_SENT_OFFER], "dhcp_server_replies_sent_total", "type=\"DHCPOFFER\"",
+             "Respuestas enviadas por tipo.");
+    describe(&counters[SERVER_METRIC_SENT_ACK], "dhcp_server_replies_sent_total", "type=\"DHCPACK\"",
+             "Respuestas enviadas por tipo.");
+    describe(&counters[SERVER_METRIC_SENT_NAK], "dhcp_server_replies_sent_total", "type=\"DHCPNAK\"",
+             "Respuestas enviadas por tipo.");
+    describe(&counters[SERVER_METRIC_NO_ADDRESS], "dhcp_server_no_address_total", NULL,
+             "DHCPDISCOVER sin direcciones libres en el pool de la subred.");
+    describe(&counters[SERVER_METRIC_RELEASED], "dhcp_server_leases_released_total", NULL,
+             "Leases liberados con DHCPRELEASE.");
+    describe(&counters[SERVER_METRIC_CONFLICTS], "dhcp_server_conflicts_total", NULL,
+             "Direcciones puestas en cuarentena por DHCPDECLINE.");
+    describe(&counters[SERVER_METRIC_EXPIRED], "dhcp_server_leases_expired_total", NULL,
+             "Leases vencidos sin renovar.");
+    describe(&counters[SERVER_METRIC_QUARANTINE_ENDED], "dhcp_server_quarantines_ended_total", NULL,
+             "Direcciones en conflicto devueltas al pool al terminar la cuarentena.");
+    describe(&counters[SERVER_METRIC_OFFER_CONFIRMED], "dhcp_server_offers_total", "result=\"confirmada\"",
+             "Direcciones ofrecidas según cómo terminó la oferta.");
+    describe(&counters[SERVER_METRIC_OFFER_EXPIRED], "dhcp_server_offers_total", "result=\"vencida\"",
+             "Direcciones ofrecidas según cómo terminó la oferta.");
+    describe(&counters[SERVER_METRIC_OFFER_CANCELLED], "dhcp_server_offers_total", "result=\"retirada\"",
+             "Direcciones ofrecidas según cómo terminó la oferta.");
+    describe(&counters[SERVER_METRIC_REOFFER_HIT], "dhcp_server_previous_address_total", "result=\"reasignada\"",
+             "Clientes sin lease vigente según si recibieron su dirección anterior.");
+    describe(&counters[SERVER_METRIC_REOFFER_TAKEN], "dhcp_server_previous_address_total", "result=\"ocupada\"",
+             "Clientes sin lease vigente según si recibieron su dirección anterior.");
+    describe(&counters[SERVER_METRIC_REOFFER_UNKNOWN], "dhcp_server_previous_address_total", "result=\"sin_historial\"",
+             "Clientes sin lease vigente según si recibieron su dirección anterior.");
+    describe(&counters[SERVER_METRIC_REPLY_CACHE_HIT], "dhcp_server_reply_cache_total", "result=\"acierto\"",
+             "Solicitudes buscadas en la caché de respuestas (las retransmisiones son aciertos).");
+    describe(&counters[SERVER_METRIC_REPLY_CACHE_MISS], "dhcp_server_reply_cache_total", "result=\"fallo\"",
+             "Solicitudes buscadas en la caché de respuestas (las retransmisiones son aciertos).");
+    return metrics_init(counters, SERVER_COUNTER_COUNT, histograms, SERVER_HISTOGRAM_COUNT);
+}
@@ -0,0 +1,46 @@
+#ifndef SERVER_METRICS_H
+#define SERVER_METRICS_H
+
+#include "dhcp_metrics.h"
+#include "dhcp_wire.h"
+
+// Contadores e histogramas del servidor (identificadores para metrics_add y
+// metrics_observe). Los que van por tipo de mensaje se indexan con el valor
+// de la opción 53: SERVER_METRIC_RECEIVED + DHCPDISCOVER, etc.
+
+#define SERVER_MESSAGE_TYPES (DHCPINFORM + 1)
+
+enum {
+    SERVER_METRIC_RECEIVED = 0,                                       // Por tipo
+    SERVER_METRIC_REJECTED = SERVER_METRIC_RECEIVED + SERVER_MESSAGE_TYPES,  // Por tipo
+    SERVER_METRIC_MALFORMED = SERVER_METRIC_REJECTED + SERVER_MESSAGE_TYPES,
+    SERVER_METRIC_UNHANDLED,
+    SERVER_METRIC_NO_SUBNET,
+    SERVER_METRIC_SENT_OFFER,
+    SERVER_METRIC_SENT_ACK,
+    SERVER_METRIC_SENT_NAK,
+    SERVER_METRIC_NO_ADDRESS,      // DHCPDISCOVER sin direcciones libres
+    SERVER_METRIC_RELEASED,
+    SERVER_METRIC_CONFLICTS,       // DHCPDECLINE aceptados
+    SERVER_METRIC_EXPIRED,         // Leases vencidos
+    SERVER_METRIC_QUARANTINE_ENDED,
+    SERVER_METRIC_OFFER_CONFIRMED, // Ofertas convertidas en lease por un DHCPREQUEST
+    SERVER_METRIC_OFFER_EXPIRED,   // Ofertas vencidas sin DHCPREQUEST
+    SERVER_METRIC_OFFER_CANCELLED, // Ofertas retiradas porque el cliente eligió otro servidor
+    SERVER_METRIC_REOFFER_HIT,     // Ver lease_reoffer_stats
+    SERVER_METRIC_REOFFER_TAKEN,
+    SERVER_METRIC_REOFFER_UNKNOWN,
+    SERVER_METRIC_REPLY_CACHE_HIT,  // DHCPDISCOVER/DHCPREQUEST respondidos desde reply_cache
+    SERVER_METRIC_REPLY_CACHE_MISS,
+    SERVER_COUNTER_COUNT
+};
+
+enum {
+    SERVER_METRIC_LATENCY = 0,  // Por tipo: tiempo de despacho de cada mensaje
+    SERVER_HISTOGRAM_COUNT = SERVER_METRIC_LATENCY + SERVER_MESSAGE_TYPES
+};
+
+// Registra las tablas del servidor en dhcp_metrics (antes de crear los hilos)
+int server_metrics_init(void);
+
+#endif